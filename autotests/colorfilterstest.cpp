@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QColor>
+#include <QImage>
+
+#include "../core/colorfilters_p.h"
+
+Q_DECLARE_METATYPE( QImage::Format )
+
+class ColorFiltersTest
+: public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testMapGray_data();
+        void testMapGray();
+        void testMultiply_data();
+        void testMultiply();
+
+    private:
+        static QImage randomImage( int width, int height, QImage::Format format );
+};
+
+// An image with random pixels, some of them fully black or white
+QImage ColorFiltersTest::randomImage( int width, int height, QImage::Format format )
+{
+    qsrand( width * 31 + height );
+    QImage image( width, height, QImage::Format_ARGB32 );
+    for ( int y = 0; y < height; ++y )
+    {
+        QRgb *data = reinterpret_cast< QRgb * >( image.scanLine( y ) );
+        for ( int x = 0; x < width; ++x )
+        {
+            switch ( qrand() % 8 )
+            {
+                case 0:
+                    data[ x ] = qRgba( 0, 0, 0, 255 );
+                    break;
+                case 1:
+                    data[ x ] = qRgba( 255, 255, 255, 255 );
+                    break;
+                case 2:
+                    data[ x ] = qRgba( 0, 0, 0, qrand() % 256 );
+                    break;
+                default:
+                    data[ x ] = qRgba( qrand() % 256, qrand() % 256, qrand() % 256, qrand() % 256 );
+            }
+        }
+    }
+    return image.convertToFormat( format );
+}
+
+void ColorFiltersTest::testMapGray_data()
+{
+    QTest::addColumn<int>( "width" );
+    QTest::addColumn<int>( "height" );
+    QTest::addColumn<QImage::Format>( "format" );
+
+    // the kernels filter four pixels at a time, and the rest one by one
+    for ( int width = 1; width <= 9; ++width )
+        QTest::newRow( qPrintable( QString( "width %1" ).arg( width ) ) ) << width << 3 << QImage::Format_RGB32;
+    QTest::newRow( "width 13" ) << 13 << 5 << QImage::Format_RGB32;
+    QTest::newRow( "premultiplied" ) << 67 << 7 << QImage::Format_ARGB32_Premultiplied;
+    QTest::newRow( "not 32 bit" ) << 21 << 4 << QImage::Format_RGB16;
+    // large enough to be split in bands filtered by several threads
+    QTest::newRow( "bands" ) << 1021 << 1031 << QImage::Format_RGB32;
+}
+
+void ColorFiltersTest::testMapGray()
+{
+    QFETCH( int, width );
+    QFETCH( int, height );
+    QFETCH( QImage::Format, format );
+
+    ColorFilters::GrayTable recolor;
+    ColorFilters::recolorTable( &recolor, QColor( 0x600000 ), QColor( 0xF0F0F0 ) );
+    ColorFilters::GrayTable blackWhite;
+    ColorFilters::blackWhiteTable( &blackWhite, 4, 100 );
+
+    const QImage source = randomImage( width, height, format );
+    for ( int i = 0; i < 2; ++i )
+    {
+        const ColorFilters::GrayTable &table = i == 0 ? recolor : blackWhite;
+
+        QImage image = source;
+        ColorFilters::mapGray( image, table );
+        QImage expected = source;
+        ColorFilters::mapGrayScalar( expected, table );
+
+        QCOMPARE( image.format(), expected.format() );
+        QVERIFY( image == expected );
+    }
+}
+
+void ColorFiltersTest::testMultiply_data()
+{
+    QTest::addColumn<int>( "width" );
+    QTest::addColumn<QRect>( "rect" );
+    QTest::addColumn<bool>( "transparentBlack" );
+
+    for ( int width = 1; width <= 9; ++width )
+    {
+        QTest::newRow( qPrintable( QString( "width %1" ).arg( width ) ) ) << width << QRect( 0, 0, width, 3 ) << false;
+        QTest::newRow( qPrintable( QString( "width %1, transparent black" ).arg( width ) ) ) << width << QRect( 0, 0, width, 3 ) << true;
+    }
+    QTest::newRow( "width 13" ) << 13 << QRect( 0, 0, 13, 3 ) << false;
+    // a rectangle starting at an odd pixel, with a width not a multiple of four
+    QTest::newRow( "inner rect" ) << 29 << QRect( 3, 1, 19, 2 ) << false;
+    QTest::newRow( "inner rect, transparent black" ) << 29 << QRect( 5, 0, 22, 3 ) << true;
+    QTest::newRow( "rect outside of the image" ) << 11 << QRect( 7, -2, 10, 10 ) << true;
+}
+
+void ColorFiltersTest::testMultiply()
+{
+    QFETCH( int, width );
+    QFETCH( QRect, rect );
+    QFETCH( bool, transparentBlack );
+
+    const QImage source = randomImage( width, 3, QImage::Format_ARGB32_Premultiplied );
+    const QColor colors[] = { QColor( 255, 255, 0 ), QColor( 0x30, 0x8c, 0xc6 ), Qt::black, Qt::white };
+    for ( uint i = 0; i < sizeof( colors ) / sizeof( colors[ 0 ] ); ++i )
+    {
+        QImage image = source;
+        ColorFilters::multiply( image, rect, colors[ i ], transparentBlack );
+        QImage expected = source;
+        ColorFilters::multiplyScalar( expected, rect, colors[ i ], transparentBlack );
+
+        QVERIFY( image == expected );
+    }
+}
+
+QTEST_MAIN( ColorFiltersTest )
+#include "colorfilterstest.moc"
@@ -8,15 +8,35 @@
  ***************************************************************************/
 
 #include <QtTest>
+#include <QPainter>
+#include <QTemporaryFile>
 
 #include <threadweaver/queue.h>
 
 #include "../core/document.h"
 #include "../core/generator.h"
 #include "../core/observer.h"
+#include "../core/page.h"
+#include "../core/tile.h"
 #include "../core/rotationjob_p.h"
 #include "../settings_core.h"
 
+// Records the page counts the observer is set up with
+class PageCountObserver : public Okular::DocumentObserver
+{
+    public:
+        void notifySetup( const QVector< Okular::Page * > &pages, int setupFlags ) Q_DECL_OVERRIDE
+        {
+            if ( setupFlags & PagesAdded )
+                addedPageCounts.append( pages.count() );
+            else
+                setupPageCounts.append( pages.count() );
+        }
+
+        QList< int > setupPageCounts;
+        QList< int > addedPageCounts;
+};
+
 class DocumentTest
 : public QObject
 {
@@ -24,6 +44,8 @@ class DocumentTest
 
     private slots:
         void testCloseDuringRotationJob();
+        void testRotatedTiles();
+        void testAppendPages();
 };
 
 // Test that we don't crash if the document is closed while a RotationJob
@@ -59,5 +81,127 @@ void DocumentTest::testCloseDuringRotationJob()
     qApp->processEvents();
 }
 
+// Test that the tiles of a rotated page show the right part of the image
+void DocumentTest::testRotatedTiles()
+{
+    // a square image with a different color in each quadrant
+    QImage image( 100, 100, QImage::Format_RGB32 );
+    QPainter painter( &image );
+    painter.fillRect( 0, 0, 50, 50, Qt::red );
+    painter.fillRect( 50, 0, 50, 50, Qt::green );
+    painter.fillRect( 0, 50, 50, 50, Qt::blue );
+    painter.fillRect( 50, 50, 50, 50, Qt::yellow );
+    painter.end();
+
+    QTemporaryFile tiffFile( QDir::tempPath() + "/okulartest-XXXXXX.tiff" );
+    QVERIFY( tiffFile.open() );
+    tiffFile.close();
+    if ( !image.save( tiffFile.fileName(), "TIFF" ) )
+        QSKIP( "No TIFF image writer available" );
+
+    Okular::SettingsCore::instance( "documenttest" );
+    Okular::Document *m_document = new Okular::Document( 0 );
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( tiffFile.fileName() );
+
+    Okular::DocumentObserver *dummyDocumentObserver = new Okular::DocumentObserver();
+    m_document->addObserver( dummyDocumentObserver );
+
+    QCOMPARE( m_document->openDocument( tiffFile.fileName(), QUrl(), mime ), Okular::Document::OpenSuccess );
+    m_document->setRotation( 1 );
+
+    // big enough for the page to switch to tiles
+    Okular::PixmapRequest *pixmapReq = new Okular::PixmapRequest(
+        dummyDocumentObserver, 0, 3000, 3000, 1, Okular::PixmapRequest::NoFeature );
+    pixmapReq->setNormalizedRect( Okular::NormalizedRect( 0, 0, 1, 1 ) );
+    m_document->requestPixmaps( QLinkedList<Okular::PixmapRequest*>() << pixmapReq );
+
+    // the generated tiles are rotated by a RotationJob
+    ThreadWeaver::Queue::instance()->finish();
+    qApp->processEvents();
+
+    const Okular::Page *page = m_document->page( 0 );
+    QVERIFY( page->hasTilesManager( dummyDocumentObserver ) );
+    const QList<Okular::Tile> tiles = page->tilesAt( dummyDocumentObserver, Okular::NormalizedRect( 0, 0, 1, 1 ) );
+    QVERIFY( !tiles.isEmpty() );
+
+    // rotated by 90 degrees clockwise, the bottom left quadrant of the
+    // image is at the top left of the page, and so on
+    foreach ( const Okular::Tile &tile, tiles )
+    {
+        QVERIFY( tile.isValid() );
+        const Okular::NormalizedRect rect = tile.rect();
+        const double x = ( rect.left + rect.right ) / 2;
+        const double y = ( rect.top + rect.bottom ) / 2;
+        if ( qAbs( x - 0.5 ) < 0.05 || qAbs( y - 0.5 ) < 0.05 )
+            continue;
+
+        QColor expected;
+        if ( y < 0.5 )
+            expected = x < 0.5 ? Qt::blue : Qt::red;
+        else
+            expected = x < 0.5 ? Qt::yellow : Qt::green;
+
+        const QImage tileImage = tile.pixmap()->toImage();
+        QCOMPARE( tileImage.pixel( tileImage.width() / 2, tileImage.height() / 2 ), expected.rgb() );
+    }
+
+    delete m_document;
+    delete dummyDocumentObserver;
+}
+
+// Test that the pages of a large text file are appended as they are indexed
+void DocumentTest::testAppendPages()
+{
+    // large enough for the text generator to index it in the background,
+    // at sixty lines per page
+    const QByteArray line( "the pages of large text files are appended while they are indexed\n" );
+    const int lineCount = 32 * 1024 * 1024 / line.size() + 1000;
+    const int pageCount = ( lineCount + 59 ) / 60;
+
+    QTemporaryFile textFile( QDir::tempPath() + "/okulartest-XXXXXX.txt" );
+    QVERIFY( textFile.open() );
+    QByteArray lines;
+    for ( int i = 0; i < 1000; ++i )
+        lines += line;
+    for ( int i = 0; i < lineCount / 1000; ++i )
+        QCOMPARE( textFile.write( lines ), qint64( lines.size() ) );
+    for ( int i = 0; i < lineCount % 1000; ++i )
+        QCOMPARE( textFile.write( line ), qint64( line.size() ) );
+    textFile.close();
+
+    Okular::SettingsCore::instance( "documenttest" );
+    Okular::Document *m_document = new Okular::Document( 0 );
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForName( "text/plain" );
+
+    PageCountObserver *observer = new PageCountObserver();
+    m_document->addObserver( observer );
+
+    QCOMPARE( m_document->openDocument( textFile.fileName(), QUrl(), mime ), Okular::Document::OpenSuccess );
+    QCOMPARE( observer->setupPageCounts.count(), 1 );
+    QVERIFY( observer->setupPageCounts.first() > 0 );
+
+    QTRY_COMPARE_WITH_TIMEOUT( (int)m_document->pages(), pageCount, 30000 );
+
+    // each notification has more pages than the previous one, and the
+    // last one has them all
+    if ( observer->setupPageCounts.first() < pageCount )
+    {
+        QVERIFY( !observer->addedPageCounts.isEmpty() );
+        int previousPageCount = observer->setupPageCounts.first();
+        foreach ( int count, observer->addedPageCounts )
+        {
+            QVERIFY( count > previousPageCount );
+            previousPageCount = count;
+        }
+        QCOMPARE( observer->addedPageCounts.last(), pageCount );
+    }
+    QCOMPARE( observer->setupPageCounts.count(), 1 );
+
+    delete m_document;
+    delete observer;
+}
+
 QTEST_MAIN( DocumentTest )
 #include "documenttest.moc"
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QImage>
+#include <QPainter>
+
+#include "../core/area.h"
+#include "../core/utils.h"
+
+Q_DECLARE_METATYPE( QImage::Format )
+
+class ImageBoundingBoxTest
+: public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testBoundingBox_data();
+        void testBoundingBox();
+
+    private:
+        static Okular::NormalizedRect pixelBoundingBox( const QImage &image );
+};
+
+// The bounding box as it was found before the rows were scanned as 32 bit
+// pixels, one QImage::pixel() at a time
+Okular::NormalizedRect ImageBoundingBoxTest::pixelBoundingBox( const QImage &image )
+{
+    const int width = image.width();
+    const int height = image.height();
+    int top = -1, bottom = -1, left = width, right = -1;
+    for ( int y = 0; y < height; ++y )
+    {
+        for ( int x = 0; x < width; ++x )
+        {
+            if ( ( image.pixel( x, y ) & 0xFFFFFF ) == 0xFFFFFF )
+                continue;
+            if ( top == -1 )
+                top = y;
+            bottom = y;
+            left = qMin( left, x );
+            right = qMax( right, x );
+        }
+    }
+    if ( top == -1 )
+        return Okular::NormalizedRect( 0, 0, 0, 0 );
+
+    return Okular::NormalizedRect( QRect( left, top, right - left + 1, bottom - top + 1 ), width, height );
+}
+
+void ImageBoundingBoxTest::testBoundingBox_data()
+{
+    QTest::addColumn<QImage::Format>( "format" );
+    QTest::addColumn<QSize>( "size" );
+    QTest::addColumn<QRect>( "contents" );
+    QTest::addColumn<QColor>( "color" );
+
+    const QImage::Format formats[] = { QImage::Format_RGB32, QImage::Format_ARGB32_Premultiplied, QImage::Format_Mono };
+    const char *names[] = { "rgb32", "premultiplied", "mono" };
+    for ( int i = 0; i < 3; ++i )
+    {
+        const QImage::Format format = formats[ i ];
+        const QString name = names[ i ];
+        QTest::newRow( qPrintable( name + " blank" ) ) << format << QSize( 37, 21 ) << QRect() << QColor( Qt::black );
+        QTest::newRow( qPrintable( name + " full" ) ) << format << QSize( 37, 21 ) << QRect( 0, 0, 37, 21 ) << QColor( Qt::black );
+        QTest::newRow( qPrintable( name + " top left pixel" ) ) << format << QSize( 13, 9 ) << QRect( 0, 0, 1, 1 ) << QColor( Qt::black );
+        QTest::newRow( qPrintable( name + " bottom right pixel" ) ) << format << QSize( 13, 9 ) << QRect( 12, 8, 1, 1 ) << QColor( Qt::black );
+        // widths which are not a multiple of the four pixels scanned at once
+        for ( int width = 1; width <= 9; ++width )
+            QTest::newRow( qPrintable( name + QString( " width %1" ).arg( width ) ) ) << format << QSize( width, 5 ) << QRect( width / 2, 1, 1, 3 ) << QColor( Qt::black );
+        QTest::newRow( qPrintable( name + " inner" ) ) << format << QSize( 103, 67 ) << QRect( 11, 7, 61, 45 ) << QColor( Qt::black );
+        // large enough to be scanned by several threads
+        QTest::newRow( qPrintable( name + " bands" ) ) << format << QSize( 1237, 1129 ) << QRect( 301, 677, 513, 311 ) << QColor( Qt::black );
+    }
+    // almost white is not white
+    QTest::newRow( "rgb32 almost white" ) << QImage::Format_RGB32 << QSize( 17, 11 ) << QRect( 3, 2, 5, 4 ) << QColor( 255, 254, 255 );
+    // transparent is not white, but a premultiplied translucent white is
+    QTest::newRow( "premultiplied transparent" ) << QImage::Format_ARGB32_Premultiplied << QSize( 17, 11 ) << QRect( 3, 2, 5, 4 ) << QColor( Qt::transparent );
+    QTest::newRow( "premultiplied translucent white" ) << QImage::Format_ARGB32_Premultiplied << QSize( 17, 11 ) << QRect( 3, 2, 5, 4 ) << QColor( 255, 255, 255, 128 );
+    QTest::newRow( "premultiplied translucent gray" ) << QImage::Format_ARGB32_Premultiplied << QSize( 17, 11 ) << QRect( 3, 2, 5, 4 ) << QColor( 200, 200, 200, 128 );
+}
+
+void ImageBoundingBoxTest::testBoundingBox()
+{
+    QFETCH( QImage::Format, format );
+    QFETCH( QSize, size );
+    QFETCH( QRect, contents );
+    QFETCH( QColor, color );
+
+    QImage image( size, QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+    if ( !contents.isNull() )
+    {
+        QPainter painter( &image );
+        painter.setCompositionMode( QPainter::CompositionMode_Source );
+        painter.fillRect( contents, color );
+        // some noise inside, which does not change the bounding box
+        painter.fillRect( contents.adjusted( contents.width() / 3, contents.height() / 3, -contents.width() / 3, -contents.height() / 3 ), Qt::white );
+    }
+    image = image.convertToFormat( format );
+
+    const Okular::NormalizedRect bbox = Okular::Utils::imageBoundingBox( &image );
+    const Okular::NormalizedRect expected = pixelBoundingBox( image );
+    QVERIFY2( bbox == expected, qPrintable( QString( "(%1, %2, %3, %4) instead of (%5, %6, %7, %8)" )
+                                            .arg( bbox.left ).arg( bbox.top ).arg( bbox.right ).arg( bbox.bottom )
+                                            .arg( expected.left ).arg( expected.top ).arg( expected.right ).arg( expected.bottom ) ) );
+}
+
+QTEST_MAIN( ImageBoundingBoxTest )
+#include "imageboundingboxtest.moc"
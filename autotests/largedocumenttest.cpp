@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryFile>
+
+#include "../generators/txt/largedocument.h"
+
+class LargeDocumentTest
+: public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testLineEnds_data();
+        void testLineEnds();
+        void testPages();
+        void testWrappedLines();
+
+    private:
+        bool open( Txt::LargeDocument *document, QTemporaryFile *file, const QByteArray &contents );
+};
+
+bool LargeDocumentTest::open( Txt::LargeDocument *document, QTemporaryFile *file, const QByteArray &contents )
+{
+    if ( !file->open() || file->write( contents ) != contents.size() )
+        return false;
+    file->close();
+
+    if ( !document->open( file->fileName() ) )
+        return false;
+
+    // wait for the indexing thread
+    document->wait();
+    return document->isIndexed();
+}
+
+void LargeDocumentTest::testLineEnds_data()
+{
+    QTest::addColumn<QByteArray>( "contents" );
+    QTest::addColumn<QStringList>( "lines" );
+
+    QTest::newRow( "lf" ) << QByteArray( "first line\nsecond line\n" ) << ( QStringList() << "first line" << "second line" );
+    QTest::newRow( "crlf" ) << QByteArray( "first line\r\nsecond line\r\n" ) << ( QStringList() << "first line" << "second line" );
+    QTest::newRow( "bom" ) << QByteArray( "\xef\xbb\xbf" "first line\nsecond line\n" ) << ( QStringList() << "first line" << "second line" );
+    QTest::newRow( "no final newline" ) << QByteArray( "first line\nsecond line" ) << ( QStringList() << "first line" << "second line" );
+    QTest::newRow( "empty line" ) << QByteArray( "first line\n\nthird line\n" ) << ( QStringList() << "first line" << QString() << "third line" );
+    QTest::newRow( "tab" ) << QByteArray( "a\tb\n" ) << ( QStringList() << "a       b" );
+    QTest::newRow( "empty file" ) << QByteArray() << QStringList();
+}
+
+void LargeDocumentTest::testLineEnds()
+{
+    QFETCH( QByteArray, contents );
+    QFETCH( QStringList, lines );
+
+    Txt::LargeDocument document;
+    QTemporaryFile file;
+    QVERIFY( open( &document, &file, contents ) );
+
+    QCOMPARE( document.pageCount(), 1 );
+    QCOMPARE( document.pageLines( 0 ), lines );
+}
+
+// Test that the pages have sixty lines each, and no empty page follows
+// the last line
+void LargeDocumentTest::testPages()
+{
+    QByteArray contents;
+    for ( int i = 0; i < 120; ++i )
+        contents += "line " + QByteArray::number( i ) + '\n';
+
+    Txt::LargeDocument document;
+    QTemporaryFile file;
+    QVERIFY( open( &document, &file, contents ) );
+
+    QCOMPARE( document.pageCount(), 2 );
+    const QStringList firstLines = document.pageLines( 0 );
+    QCOMPARE( firstLines.count(), 60 );
+    QCOMPARE( firstLines.first(), QString( "line 0" ) );
+    const QStringList secondLines = document.pageLines( 1 );
+    QCOMPARE( secondLines.count(), 60 );
+    QCOMPARE( secondLines.first(), QString( "line 60" ) );
+    QCOMPARE( secondLines.last(), QString( "line 119" ) );
+}
+
+// Test that long lines are wrapped, also across pages
+void LargeDocumentTest::testWrappedLines()
+{
+    const QByteArray longLine( 200, 'x' );
+    QByteArray contents;
+    for ( int i = 0; i < 59; ++i )
+        contents += "line " + QByteArray::number( i ) + '\n';
+    contents += longLine + "\r\n";
+    contents += "last line\n";
+
+    Txt::LargeDocument document;
+    QTemporaryFile file;
+    QVERIFY( open( &document, &file, contents ) );
+
+    QCOMPARE( document.pageCount(), 2 );
+    const QStringList firstLines = document.pageLines( 0 );
+    QCOMPARE( firstLines.count(), 60 );
+    QCOMPARE( firstLines.last(), QString( 80, QLatin1Char( 'x' ) ) );
+    const QStringList secondLines = document.pageLines( 1 );
+    QCOMPARE( secondLines, QStringList() << QString( 80, QLatin1Char( 'x' ) ) << QString( 40, QLatin1Char( 'x' ) ) << "last line" );
+}
+
+QTEST_MAIN( LargeDocumentTest )
+#include "largedocumenttest.moc"
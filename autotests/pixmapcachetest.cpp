@@ -0,0 +1,323 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "../core/observer.h"
+#include "../core/pixmapcache_p.h"
+
+Q_DECLARE_METATYPE( Okular::PixmapCache::Policy )
+
+// An observer which can't unload the pixmaps of its visible pages
+class TestObserver : public Okular::DocumentObserver
+{
+    public:
+        bool canUnloadPixmap( int page ) const
+        {
+            return !visiblePages.contains( page );
+        }
+
+        QSet< int > visiblePages;
+};
+
+class PixmapCacheTest
+: public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testDistance();
+        void testLeastRecentlyUsed();
+        void testCostAware();
+        void testReplace_data();
+        void testReplace();
+        void testTake_data();
+        void testTake();
+        void testRemoveObserver_data();
+        void testRemoveObserver();
+        void testSetPolicy();
+
+    private:
+        static void addPolicyRows();
+        static AllocatedPixmap *insert( Okular::PixmapCache *cache, TestObserver *observer, int page, qint64 renderTime = 0 );
+        static int lowestPage( const Okular::PixmapCache &cache, int viewportPage = 0, bool unloadableOnly = false, Okular::DocumentObserver *observer = 0 );
+        static int takeLowestPage( Okular::PixmapCache *cache, int viewportPage = 0 );
+};
+
+void PixmapCacheTest::addPolicyRows()
+{
+    QTest::addColumn<Okular::PixmapCache::Policy>( "policy" );
+
+    QTest::newRow( "distance" ) << Okular::PixmapCache::DistancePolicy;
+    QTest::newRow( "least recently used" ) << Okular::PixmapCache::LeastRecentlyUsedPolicy;
+    QTest::newRow( "cost aware" ) << Okular::PixmapCache::CostAwarePolicy;
+}
+
+// Adds a pixmap of one MiB to the cache, as a just rendered pixmap is
+AllocatedPixmap *PixmapCacheTest::insert( Okular::PixmapCache *cache, TestObserver *observer, int page, qint64 renderTime )
+{
+    AllocatedPixmap *pixmap = new AllocatedPixmap( observer, page, 1048576 );
+    pixmap->renderTime = renderTime;
+    cache->insert( pixmap );
+    cache->markUsed( observer, page );
+    return pixmap;
+}
+
+int PixmapCacheTest::lowestPage( const Okular::PixmapCache &cache, int viewportPage, bool unloadableOnly, Okular::DocumentObserver *observer )
+{
+    AllocatedPixmap *pixmap = cache.lowestPriority( viewportPage, unloadableOnly, observer );
+    return pixmap ? pixmap->page : -1;
+}
+
+int PixmapCacheTest::takeLowestPage( Okular::PixmapCache *cache, int viewportPage )
+{
+    AllocatedPixmap *pixmap = cache->takeLowestPriority( viewportPage, false, 0 );
+    if ( !pixmap )
+        return -1;
+
+    const int page = pixmap->page;
+    delete pixmap;
+    return page;
+}
+
+void PixmapCacheTest::testDistance()
+{
+    TestObserver observer;
+    Okular::PixmapCache cache;
+    QCOMPARE( cache.policy(), Okular::PixmapCache::DistancePolicy );
+    for ( int page = 0; page < 10; ++page )
+        insert( &cache, &observer, page );
+
+    // the farthest page from the viewport, on either side
+    QCOMPARE( lowestPage( cache, 3 ), 9 );
+    QCOMPARE( lowestPage( cache, 8 ), 0 );
+    // using a page again doesn't matter
+    cache.markUsed( &observer, 9 );
+    QCOMPARE( lowestPage( cache, 3 ), 9 );
+
+    // the visible pages are skipped
+    observer.visiblePages << 9 << 8;
+    QCOMPARE( lowestPage( cache, 3 ), 9 );
+    QCOMPARE( lowestPage( cache, 3, true ), 7 );
+    observer.visiblePages.clear();
+
+    // the farthest page of all the observers, or of one of them
+    TestObserver other;
+    insert( &cache, &other, 20 );
+    QCOMPARE( lowestPage( cache, 3 ), 20 );
+    QCOMPARE( lowestPage( cache, 3, false, &observer ), 9 );
+
+    QCOMPARE( takeLowestPage( &cache, 3 ), 20 );
+    QCOMPARE( takeLowestPage( &cache, 3 ), 9 );
+    QCOMPARE( takeLowestPage( &cache, 3 ), 8 );
+    QCOMPARE( cache.count(), 8 );
+}
+
+void PixmapCacheTest::testLeastRecentlyUsed()
+{
+    TestObserver observer;
+    Okular::PixmapCache cache;
+    cache.setPolicy( Okular::PixmapCache::LeastRecentlyUsedPolicy );
+    for ( int page = 0; page < 5; ++page )
+        insert( &cache, &observer, page );
+
+    // the viewport doesn't matter
+    QCOMPARE( lowestPage( cache, 0 ), 0 );
+    QCOMPARE( lowestPage( cache, 4 ), 0 );
+
+    // a page used again goes last
+    cache.markUsed( &observer, 0 );
+    QCOMPARE( lowestPage( cache ), 1 );
+    QCOMPARE( takeLowestPage( &cache ), 1 );
+    QCOMPARE( takeLowestPage( &cache ), 2 );
+
+    // the visible pages are skipped
+    observer.visiblePages << 3;
+    QCOMPARE( lowestPage( cache, 0, true ), 4 );
+
+    // a page rendered again goes last too
+    insert( &cache, &observer, 3 );
+    QCOMPARE( lowestPage( cache ), 4 );
+
+    // the least recently used page of all the observers, or of one of them
+    TestObserver other;
+    insert( &cache, &other, 0 );
+    cache.markUsed( &observer, 4 );
+    QCOMPARE( lowestPage( cache ), 0 );
+    QCOMPARE( cache.lowestPriority( 0, false, 0 )->observer, static_cast< Okular::DocumentObserver * >( &observer ) );
+    QCOMPARE( lowestPage( cache, 0, false, &other ), 0 );
+    cache.markUsed( &observer, 0 );
+    QCOMPARE( cache.lowestPriority( 0, false, 0 )->observer, static_cast< Okular::DocumentObserver * >( &observer ) );
+    QCOMPARE( lowestPage( cache ), 3 );
+}
+
+void PixmapCacheTest::testCostAware()
+{
+    TestObserver observer;
+    Okular::PixmapCache cache;
+    cache.setPolicy( Okular::PixmapCache::CostAwarePolicy );
+    insert( &cache, &observer, 0, 10 );
+    insert( &cache, &observer, 1, 100 );
+    insert( &cache, &observer, 2, 50 );
+
+    // the cheapest pixmap to render again goes first
+    QCOMPARE( lowestPage( cache ), 0 );
+    QCOMPARE( takeLowestPage( &cache ), 0 );
+    QCOMPARE( takeLowestPage( &cache ), 2 );
+
+    // a cheap pixmap rendered after the evictions is worth more than the
+    // ones evicted, but still less than the expensive one
+    insert( &cache, &observer, 3, 10 );
+    QCOMPARE( lowestPage( cache ), 3 );
+    QCOMPARE( takeLowestPage( &cache ), 3 );
+
+    // the expensive pixmap, unused for long enough, goes eventually
+    insert( &cache, &observer, 4, 45 );
+    QCOMPARE( lowestPage( cache ), 1 );
+
+    // unless it is used again
+    cache.markUsed( &observer, 1 );
+    QCOMPARE( lowestPage( cache ), 4 );
+
+    // a pixmap evicted by the document counts as evicted too
+    AllocatedPixmap *pixmap = cache.take( &observer, 4 );
+    QVERIFY( pixmap );
+    cache.markEvicted( pixmap );
+    delete pixmap;
+    insert( &cache, &observer, 5, 60 );
+    QCOMPARE( lowestPage( cache ), 1 );
+}
+
+void PixmapCacheTest::testReplace_data()
+{
+    addPolicyRows();
+}
+
+// A pixmap rendered again replaces the previous descriptor of its page
+void PixmapCacheTest::testReplace()
+{
+    QFETCH( Okular::PixmapCache::Policy, policy );
+
+    TestObserver observer;
+    Okular::PixmapCache cache;
+    cache.setPolicy( policy );
+    insert( &cache, &observer, 1 );
+    AllocatedPixmap *pixmap = insert( &cache, &observer, 1 );
+    QCOMPARE( cache.count(), 1 );
+    QCOMPARE( cache.lowestPriority( 0, false, 0 ), pixmap );
+
+    QCOMPARE( cache.take( &observer, 1 ), pixmap );
+    delete pixmap;
+    QVERIFY( cache.isEmpty() );
+    QVERIFY( !cache.lowestPriority( 0, false, 0 ) );
+}
+
+void PixmapCacheTest::testTake_data()
+{
+    addPolicyRows();
+}
+
+void PixmapCacheTest::testTake()
+{
+    QFETCH( Okular::PixmapCache::Policy, policy );
+
+    TestObserver observer;
+    TestObserver other;
+    Okular::PixmapCache cache;
+    cache.setPolicy( policy );
+    insert( &cache, &observer, 0 );
+    insert( &cache, &observer, 1 );
+    insert( &cache, &other, 0 );
+    QCOMPARE( cache.count(), 3 );
+
+    QVERIFY( !cache.take( &observer, 2 ) );
+    QVERIFY( !cache.take( 0, 0 ) );
+
+    AllocatedPixmap *pixmap = cache.take( &observer, 0 );
+    QVERIFY( pixmap );
+    QCOMPARE( pixmap->observer, static_cast< Okular::DocumentObserver * >( &observer ) );
+    QCOMPARE( pixmap->page, 0 );
+    QCOMPARE( cache.count(), 2 );
+    QVERIFY( !cache.take( &observer, 0 ) );
+
+    // a taken pixmap is not evicted anymore, and can be put back
+    QCOMPARE( lowestPage( cache, 0, false, &observer ), 1 );
+    cache.insert( pixmap );
+    QCOMPARE( cache.count(), 3 );
+
+    // all the pixmaps of an observer only go if they can be unloaded
+    observer.visiblePages << 0 << 1;
+    QVERIFY( !cache.lowestPriority( 0, true, &observer ) );
+    AllocatedPixmap *unloadable = cache.lowestPriority( 0, true, 0 );
+    QVERIFY( unloadable );
+    QCOMPARE( unloadable->observer, static_cast< Okular::DocumentObserver * >( &other ) );
+
+    while ( takeLowestPage( &cache ) != -1 )
+        ;
+    QVERIFY( cache.isEmpty() );
+    QCOMPARE( cache.count(), 0 );
+}
+
+void PixmapCacheTest::testRemoveObserver_data()
+{
+    addPolicyRows();
+}
+
+void PixmapCacheTest::testRemoveObserver()
+{
+    QFETCH( Okular::PixmapCache::Policy, policy );
+
+    TestObserver observer;
+    TestObserver other;
+    Okular::PixmapCache cache;
+    cache.setPolicy( policy );
+    for ( int page = 0; page < 4; ++page )
+        insert( &cache, &observer, page );
+    insert( &cache, &other, 2 );
+
+    cache.removeObserver( &observer );
+    QCOMPARE( cache.count(), 1 );
+    QVERIFY( !cache.lowestPriority( 0, false, &observer ) );
+    AllocatedPixmap *pixmap = cache.lowestPriority( 0, false, 0 );
+    QVERIFY( pixmap );
+    QCOMPARE( pixmap->observer, static_cast< Okular::DocumentObserver * >( &other ) );
+
+    // removing it again is harmless
+    cache.removeObserver( &observer );
+    QCOMPARE( cache.count(), 1 );
+
+    cache.clear();
+    QVERIFY( cache.isEmpty() );
+    QVERIFY( !cache.lowestPriority( 0, false, 0 ) );
+}
+
+// Changing the policy keeps the pixmaps, which the new policy orders
+void PixmapCacheTest::testSetPolicy()
+{
+    TestObserver observer;
+    Okular::PixmapCache cache;
+    for ( int page = 0; page < 5; ++page )
+        insert( &cache, &observer, page );
+    cache.markUsed( &observer, 0 );
+    QCOMPARE( lowestPage( cache, 1 ), 4 );
+
+    cache.setPolicy( Okular::PixmapCache::LeastRecentlyUsedPolicy );
+    QCOMPARE( cache.policy(), Okular::PixmapCache::LeastRecentlyUsedPolicy );
+    QCOMPARE( cache.count(), 5 );
+    QVERIFY( cache.lowestPriority( 1, false, 0 ) );
+
+    cache.setPolicy( Okular::PixmapCache::DistancePolicy );
+    QCOMPARE( cache.count(), 5 );
+    QCOMPARE( lowestPage( cache, 1 ), 4 );
+    QCOMPARE( takeLowestPage( &cache, 1 ), 4 );
+    QCOMPARE( cache.count(), 4 );
+}
+
+QTEST_MAIN( PixmapCacheTest )
+#include "pixmapcachetest.moc"
@@ -48,6 +48,7 @@ class SearchTest : public QObject
         void testHyphenAtEndOfPage();
         void testOneColumn();
         void testTwoColumns();
+        void testFindAll();
 };
 
 void SearchTest::initTestCase()
@@ -430,5 +431,51 @@ void SearchTest::testTwoColumns()
   delete page;
 }
 
+void SearchTest::testFindAll()
+{
+  QVector<QString> text;
+  text << "cat " << "concat " << "cat2 " << "cats " << "Cat";
+
+  QVector<Okular::NormalizedRect> rect;
+  rect << Okular::NormalizedRect(0.0, 0.0, 0.1, 0.1)
+       << Okular::NormalizedRect(0.2, 0.0, 0.4, 0.1)
+       << Okular::NormalizedRect(0.5, 0.0, 0.6, 0.1)
+       << Okular::NormalizedRect(0.7, 0.0, 0.8, 0.1)
+       << Okular::NormalizedRect(0.9, 0.0, 1.0, 0.1);
+
+  CREATE_PAGE;
+
+  // whole words, as Document::WholeWords searches them
+  QVector<Okular::RegularAreaRect *> result = tp->findAll(QRegularExpression("(?<!\\w)cat(?!\\w)"));
+  QCOMPARE(result.count(), 1);
+  Okular::RegularAreaRect expected;
+  expected.append(rect[0]);
+  QCOMPARE(*result[0], expected);
+  qDeleteAll(result);
+
+  result = tp->findAll(QRegularExpression("(?<!\\w)cat(?!\\w)", QRegularExpression::CaseInsensitiveOption));
+  QCOMPARE(result.count(), 2);
+  expected.clear();
+  expected.append(rect[4]);
+  QCOMPARE(*result[1], expected);
+  qDeleteAll(result);
+
+  // a match across words covers all of them
+  result = tp->findAll(QRegularExpression("cat\\d cats"));
+  QCOMPARE(result.count(), 1);
+  expected.clear();
+  expected.append(rect[2]);
+  expected.append(rect[3]);
+  expected.simplify();
+  QCOMPARE(*result[0], expected);
+  qDeleteAll(result);
+
+  // empty matches are skipped
+  result = tp->findAll(QRegularExpression("x*"));
+  QVERIFY(result.isEmpty());
+
+  delete page;
+}
+
 QTEST_MAIN( SearchTest )
 #include "searchtest.moc"
@@ -0,0 +1,197 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QTransform>
+
+#include "../core/textindex_p.h"
+#include "../core/textpage.h"
+
+typedef QSet< int > PageSet;
+Q_DECLARE_METATYPE( PageSet )
+
+static const qint64 DocumentSize = 12345;
+
+class TextIndexTest
+: public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void testRoundTrip();
+        void testStale_data();
+        void testStale();
+        void testGrownDocument();
+        void testCandidatePages_data();
+        void testCandidatePages();
+
+    private:
+        static Okular::TextPage *textPage( const QString &text );
+        void fillIndex( Okular::TextIndex *index ) const;
+
+        QDateTime m_modified;
+        QStringList m_pages;
+};
+
+void TextIndexTest::initTestCase()
+{
+    m_modified = QDateTime( QDate( 2026, 3, 14 ), QTime( 15, 9, 26 ) );
+    m_pages << "The quick brown fox"
+            << "jumps over the lazy dog"
+            << "foxglove and quickly";
+}
+
+// A text page with the words of @p text, one after the other on a line
+Okular::TextPage *TextIndexTest::textPage( const QString &text )
+{
+    Okular::TextPage *page = new Okular::TextPage;
+    const QStringList words = text.split( ' ' );
+    for ( int i = 0; i < words.count(); ++i )
+    {
+        const double left = i / double( words.count() );
+        const QString word = i + 1 < words.count() ? words.at( i ) + ' ' : words.at( i );
+        page->append( word, new Okular::NormalizedRect( left, 0.1, left + 0.9 / words.count(), 0.2 ) );
+    }
+    return page;
+}
+
+void TextIndexTest::fillIndex( Okular::TextIndex *index ) const
+{
+    for ( int i = 0; i < m_pages.count(); ++i )
+    {
+        Okular::TextPage *page = textPage( m_pages.at( i ) );
+        QVERIFY( index->addPage( i, page ) );
+        // a page is indexed once
+        QVERIFY( !index->addPage( i, page ) );
+        delete page;
+    }
+}
+
+void TextIndexTest::testRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QString fileName = Okular::TextIndex::fileName( dir.path() + "/document.xml" );
+    QCOMPARE( fileName, dir.path() + "/document.index" );
+
+    Okular::TextIndex index( m_pages.count(), DocumentSize, m_modified );
+    QVERIFY( !index.isComplete() );
+    fillIndex( &index );
+    QVERIFY( index.isComplete() );
+    QVERIFY( index.save( fileName ) );
+
+    Okular::TextIndex loaded( m_pages.count(), DocumentSize, m_modified );
+    QVERIFY( loaded.load( fileName ) );
+    QCOMPARE( loaded.pageCount(), m_pages.count() );
+    QVERIFY( loaded.isComplete() );
+    for ( int i = 0; i < m_pages.count(); ++i )
+        QVERIFY( loaded.hasPage( i ) );
+    QCOMPARE( loaded.candidatePages( "fox", Qt::CaseInsensitive ), index.candidatePages( "fox", Qt::CaseInsensitive ) );
+
+    // the areas of the matches are kept too
+    QVector< Okular::RegularAreaRect * > matches = loaded.findText( 1, "lazy", Qt::CaseSensitive, QTransform() );
+    QCOMPARE( matches.count(), 1 );
+    QVector< Okular::RegularAreaRect * > expected = index.findText( 1, "lazy", Qt::CaseSensitive, QTransform() );
+    QCOMPARE( expected.count(), 1 );
+    QCOMPARE( matches.first()->count(), expected.first()->count() );
+    QVERIFY( matches.first()->first() == expected.first()->first() );
+    qDeleteAll( matches );
+    qDeleteAll( expected );
+}
+
+void TextIndexTest::testStale_data()
+{
+    QTest::addColumn<qint64>( "size" );
+    QTest::addColumn<QDateTime>( "modified" );
+    QTest::addColumn<bool>( "valid" );
+
+    QTest::newRow( "same document" ) << DocumentSize << m_modified << true;
+    QTest::newRow( "different size" ) << DocumentSize + 1 << m_modified << false;
+    QTest::newRow( "different modification time" ) << DocumentSize << m_modified.addSecs( 1 ) << false;
+}
+
+void TextIndexTest::testStale()
+{
+    QFETCH( qint64, size );
+    QFETCH( QDateTime, modified );
+    QFETCH( bool, valid );
+
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QString fileName = dir.path() + "/document.index";
+
+    Okular::TextIndex index( m_pages.count(), DocumentSize, m_modified );
+    fillIndex( &index );
+    QVERIFY( index.save( fileName ) );
+
+    Okular::TextIndex loaded( m_pages.count(), size, modified );
+    QCOMPARE( loaded.load( fileName ), valid );
+    QCOMPARE( loaded.hasPage( 0 ), valid );
+    QCOMPARE( loaded.isComplete(), valid );
+}
+
+// The index of a document whose pages are still being loaded is kept, and
+// grows with the document
+void TextIndexTest::testGrownDocument()
+{
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QString fileName = dir.path() + "/document.index";
+
+    Okular::TextIndex index( m_pages.count(), DocumentSize, m_modified );
+    fillIndex( &index );
+    QVERIFY( index.save( fileName ) );
+
+    Okular::TextIndex loaded( 1, DocumentSize, m_modified );
+    QVERIFY( loaded.load( fileName ) );
+    QCOMPARE( loaded.pageCount(), m_pages.count() );
+    loaded.setPageCount( m_pages.count() + 1 );
+    QCOMPARE( loaded.pageCount(), m_pages.count() + 1 );
+    QVERIFY( loaded.hasPage( 2 ) );
+    QVERIFY( !loaded.hasPage( 3 ) );
+    QVERIFY( !loaded.isComplete() );
+}
+
+void TextIndexTest::testCandidatePages_data()
+{
+    QTest::addColumn<QString>( "text" );
+    QTest::addColumn<PageSet>( "pages" );
+
+    QTest::newRow( "whole word" ) << "lazy" << ( PageSet() << 1 );
+    QTest::newRow( "case folded" ) << "QUICK" << ( PageSet() << 0 << 2 );
+    QTest::newRow( "prefix" ) << "fox" << ( PageSet() << 0 << 2 );
+    QTest::newRow( "suffix" ) << "glove" << ( PageSet() << 2 );
+    QTest::newRow( "inside a word" ) << "ove" << ( PageSet() << 1 << 2 );
+    QTest::newRow( "unknown word" ) << "cat" << PageSet();
+    QTest::newRow( "two words" ) << "brown fox" << ( PageSet() << 0 );
+    QTest::newRow( "end and start of words" ) << "own fo" << ( PageSet() << 0 );
+    QTest::newRow( "end of a word first" ) << "rown fox" << ( PageSet() << 0 );
+    QTest::newRow( "not the end of a word" ) << "brow fox" << PageSet();
+    QTest::newRow( "not the start of a word" ) << "brown ox" << PageSet();
+    QTest::newRow( "three words" ) << "jumps over the" << ( PageSet() << 1 );
+    QTest::newRow( "part of a middle word" ) << "jumps ove the" << PageSet();
+    QTest::newRow( "words on different pages" ) << "lazy quick" << PageSet();
+    QTest::newRow( "empty" ) << "" << ( PageSet() << 0 << 1 << 2 );
+}
+
+void TextIndexTest::testCandidatePages()
+{
+    QFETCH( QString, text );
+    QFETCH( PageSet, pages );
+
+    Okular::TextIndex index( m_pages.count(), DocumentSize, m_modified );
+    fillIndex( &index );
+
+    QCOMPARE( index.candidatePages( text, Qt::CaseInsensitive ), pages );
+}
+
+QTEST_MAIN( TextIndexTest )
+#include "textindextest.moc"
@@ -13,7 +13,9 @@
 #include <QMimeDatabase>
 #include "../settings_core.h"
 #include "core/annotations.h"
+#include "core/area.h"
 #include "core/document.h"
+#include "core/page.h"
 #include "testingutils.h"
 
 Okular::LineAnnotation* getNewLineAnnotation(double startX, double startY, double endX, double endY)
@@ -43,6 +45,7 @@ private slots:
     void init();
     void cleanup();
     void testTranslateAnnotation();
+    void testTranslatedAnnotationHitTest();
     void testSequentialTranslationsMergedIfBeingMovedIsSet();
     void testSequentialTranslationsNotMergedIfBeingMovedIsNotSet();
     void testAlternateTranslationsNotMerged();
@@ -151,6 +154,27 @@ void TranslateAnnotationTest::testTranslateAnnotation()
     QVERIFY( TestingUtils::pointListsAlmostEqual( m_annot1->linePoints(), m_points1DeltaA ) );
 }
 
+void TranslateAnnotationTest::testTranslatedAnnotationHitTest()
+{
+    const Okular::Page *page = m_document->page( 0 );
+    const Okular::ObjectRect *rect;
+
+    // a quarter of the way along m_annot1, before and after translating it
+    rect = page->objectRect( Okular::ObjectRect::OAnnotation, 0.125, 0.15, 1000, 1000 );
+    QVERIFY( rect && rect->object() == m_annot1 );
+    QVERIFY( !page->objectRect( Okular::ObjectRect::OAnnotation, 0.175, 0.25, 1000, 1000 ) );
+
+    m_document->translatePageAnnotation( 0, m_annot1, m_deltaA );
+    QVERIFY( !page->objectRect( Okular::ObjectRect::OAnnotation, 0.125, 0.15, 1000, 1000 ) );
+    rect = page->objectRect( Okular::ObjectRect::OAnnotation, 0.175, 0.25, 1000, 1000 );
+    QVERIFY( rect && rect->object() == m_annot1 );
+
+    m_document->undo();
+    rect = page->objectRect( Okular::ObjectRect::OAnnotation, 0.125, 0.15, 1000, 1000 );
+    QVERIFY( rect && rect->object() == m_annot1 );
+    QVERIFY( !page->objectRect( Okular::ObjectRect::OAnnotation, 0.175, 0.25, 1000, 1000 ) );
+}
+
 void TranslateAnnotationTest::testSequentialTranslationsMergedIfBeingMovedIsSet()
 {
     // mark m_annot1 as BeingMoved but not m_annot2
@@ -0,0 +1,287 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "colorfilters_p.h"
+
+#include <QtGui/QColor>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+
+#include <string.h>
+
+#include "settings_core.h"
+#include "utils_p.h"
+
+#if defined( __SSE2__ ) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#include <emmintrin.h>
+#define OKULAR_COLORFILTERS_SSE2
+#endif
+
+using namespace ColorFilters;
+
+// images with fewer pixels are filtered by the calling thread only
+static const int ParallelPixels = 512 * 1024;
+
+/* Divides @p x, at most 255 * 255, by 255 rounding to the nearest. */
+static inline int div255( int x )
+{
+    x += 0x80;
+    return ( x + ( x >> 8 ) ) >> 8;
+}
+
+/* The pixels of an image, which are written by several threads. */
+struct Pixels
+{
+    uchar *bits;
+    int bytesPerLine;
+    int width;
+};
+
+static void mapGrayPixels( QRgb *data, int width, const GrayTable *table )
+{
+    for ( int x = 0; x < width; ++x )
+        data[ x ] = table->colors[ qGray( data[ x ] ) ];
+}
+
+static void mapGrayRows( const Pixels &pixels, int firstRow, int lastRow, const GrayTable *table )
+{
+    const int width = pixels.width;
+    for ( int y = firstRow; y < lastRow; ++y )
+    {
+        QRgb *data = reinterpret_cast< QRgb * >( pixels.bits + y * pixels.bytesPerLine );
+        int x = 0;
+#ifdef OKULAR_COLORFILTERS_SSE2
+        // qGray() of four pixels at once: the channels are in the low 16
+        // bits of 32 bit lanes, whose products fit in 16 bits too
+        const __m128i channelMask = _mm_set1_epi32( 0xff );
+        const __m128i redWeight = _mm_set1_epi32( 11 );
+        const __m128i blueWeight = _mm_set1_epi32( 5 );
+        int grays[ 4 ];
+        for ( ; x + 4 <= width; x += 4 )
+        {
+            const __m128i quad = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + x ) );
+            const __m128i red = _mm_and_si128( _mm_srli_epi32( quad, 16 ), channelMask );
+            const __m128i green = _mm_and_si128( _mm_srli_epi32( quad, 8 ), channelMask );
+            const __m128i blue = _mm_and_si128( quad, channelMask );
+            const __m128i sum = _mm_add_epi32( _mm_add_epi32( _mm_mullo_epi16( red, redWeight ), _mm_slli_epi32( green, 4 ) ),
+                                               _mm_mullo_epi16( blue, blueWeight ) );
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( grays ), _mm_srli_epi32( sum, 5 ) );
+
+            data[ x ] = table->colors[ grays[ 0 ] ];
+            data[ x + 1 ] = table->colors[ grays[ 1 ] ];
+            data[ x + 2 ] = table->colors[ grays[ 2 ] ];
+            data[ x + 3 ] = table->colors[ grays[ 3 ] ];
+        }
+#endif
+        mapGrayPixels( data + x, width - x, table );
+    }
+}
+
+static void multiplyPixels( QRgb *data, int width, const QColor &color, bool transparentBlack )
+{
+    const int rh = color.red(), gh = color.green(), bh = color.blue();
+    for ( int x = 0; x < width; ++x )
+    {
+        QRgb val = data[ x ];
+        // for odt or epub
+        if ( transparentBlack && ( val & 0x00ffffff ) == 0 )
+            val = 0xffffffff;
+        data[ x ] = qRgba( div255( qRed( val ) * rh ), div255( qGreen( val ) * gh ), div255( qBlue( val ) * bh ), 255 );
+    }
+}
+
+/* The image being filtered by mapGray(). */
+struct MapGrayScan
+{
+    Pixels pixels;
+    const GrayTable *table;
+};
+
+static void mapGrayBand( void *data, int band, int firstRow, int lastRow )
+{
+    Q_UNUSED( band )
+    const MapGrayScan *scan = static_cast< const MapGrayScan * >( data );
+    mapGrayRows( scan->pixels, firstRow, lastRow, scan->table );
+}
+
+void ColorFilters::blackWhiteTable( GrayTable *table, int contrast, int threshold )
+{
+    const int thr = 255 - threshold;
+    for ( int gray = 0; gray < 256; ++gray )
+    {
+        int val = gray;
+        if ( val > thr )
+            val = 128 + ( 127 * ( val - thr ) ) / ( 255 - thr );
+        else if ( val < thr )
+            val = ( 128 * val ) / thr;
+        if ( contrast > 2 )
+            val = qBound( 0, contrast * ( val - thr ) / 2 + thr, 255 );
+        table->colors[ gray ] = qRgba( val, val, val, 255 );
+    }
+}
+
+void ColorFilters::recolorTable( GrayTable *table, const QColor &foreground, const QColor &background )
+{
+    const int fr = foreground.red(), fg = foreground.green(), fb = foreground.blue();
+    const int dr = background.red() - fr, dg = background.green() - fg, db = background.blue() - fb;
+    for ( int gray = 0; gray < 256; ++gray )
+    {
+        table->colors[ gray ] = qRgba( fr + ( dr * gray + ( dr < 0 ? -127 : 127 ) ) / 255,
+                                       fg + ( dg * gray + ( dg < 0 ? -127 : 127 ) ) / 255,
+                                       fb + ( db * gray + ( db < 0 ? -127 : 127 ) ) / 255, 255 );
+    }
+}
+
+void ColorFilters::mapGray( QImage &image, const GrayTable &table )
+{
+    if ( image.depth() != 32 )
+        image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+
+    // detach once, before the threads write to the pixels
+    MapGrayScan scan;
+    scan.pixels.bits = image.bits();
+    scan.pixels.bytesPerLine = image.bytesPerLine();
+    scan.pixels.width = image.width();
+    scan.table = &table;
+
+    const Okular::RowBands bands( image.width(), image.height(), ParallelPixels );
+    bands.run( mapGrayBand, &scan );
+}
+
+void ColorFilters::multiply( QImage &image, const QRect &rect, const QColor &color, bool transparentBlack )
+{
+    const QRect area = rect & image.rect();
+    if ( area.isEmpty() || image.depth() != 32 )
+        return;
+
+    for ( int y = area.top(); y <= area.bottom(); ++y )
+    {
+        QRgb *data = reinterpret_cast< QRgb * >( image.scanLine( y ) ) + area.left();
+        const int width = area.width();
+        int x = 0;
+#ifdef OKULAR_COLORFILTERS_SSE2
+        // the channels of two pixels in the 16 bit lanes of a register
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rgbMask = _mm_set1_epi32( 0x00ffffff );
+        const __m128i alphaMask = _mm_set1_epi32( int( 0xff000000 ) );
+        const __m128i round = _mm_set1_epi16( 0x80 );
+        const __m128i factors = _mm_setr_epi16( color.blue(), color.green(), color.red(), 255,
+                                                color.blue(), color.green(), color.red(), 255 );
+        for ( ; x + 4 <= width; x += 4 )
+        {
+            __m128i pixels = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + x ) );
+            if ( transparentBlack )
+                pixels = _mm_or_si128( pixels, _mm_cmpeq_epi32( _mm_and_si128( pixels, rgbMask ), zero ) );
+
+            __m128i low = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( pixels, zero ), factors ), round );
+            __m128i high = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( pixels, zero ), factors ), round );
+            low = _mm_srli_epi16( _mm_add_epi16( low, _mm_srli_epi16( low, 8 ) ), 8 );
+            high = _mm_srli_epi16( _mm_add_epi16( high, _mm_srli_epi16( high, 8 ) ), 8 );
+
+            pixels = _mm_or_si128( _mm_packus_epi16( low, high ), alphaMask );
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( data + x ), pixels );
+        }
+#endif
+        multiplyPixels( data + x, width - x, color, transparentBlack );
+    }
+}
+
+void ColorFilters::mapGrayScalar( QImage &image, const GrayTable &table )
+{
+    if ( image.depth() != 32 )
+        image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+
+    for ( int y = 0; y < image.height(); ++y )
+        mapGrayPixels( reinterpret_cast< QRgb * >( image.scanLine( y ) ), image.width(), &table );
+}
+
+void ColorFilters::multiplyScalar( QImage &image, const QRect &rect, const QColor &color, bool transparentBlack )
+{
+    const QRect area = rect & image.rect();
+    if ( area.isEmpty() || image.depth() != 32 )
+        return;
+
+    for ( int y = area.top(); y <= area.bottom(); ++y )
+        multiplyPixels( reinterpret_cast< QRgb * >( image.scanLine( y ) ) + area.left(), area.width(), color, transparentBlack );
+}
+
+AccessibilityFilter::AccessibilityFilter()
+    : m_renderMode( Okular::SettingsCore::EnumRenderMode::Paper )
+{
+}
+
+AccessibilityFilter AccessibilityFilter::fromSettings()
+{
+    AccessibilityFilter filter;
+    if ( !Okular::SettingsCore::changeColors() )
+        return filter;
+
+    filter.m_renderMode = Okular::SettingsCore::renderMode();
+    switch ( filter.m_renderMode )
+    {
+        case Okular::SettingsCore::EnumRenderMode::Recolor:
+            // Map the gray levels from the foreground to the background color
+            recolorTable( &filter.m_table, Okular::SettingsCore::recolorForeground(), Okular::SettingsCore::recolorBackground() );
+            break;
+        case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+            // Manual Gray and Contrast
+            blackWhiteTable( &filter.m_table, Okular::SettingsCore::bWContrast(), Okular::SettingsCore::bWThreshold() );
+            break;
+        case Okular::SettingsCore::EnumRenderMode::Inverted:
+            break;
+        default:
+            filter.m_renderMode = Okular::SettingsCore::EnumRenderMode::Paper;
+    }
+    return filter;
+}
+
+bool AccessibilityFilter::isNull() const
+{
+    return m_renderMode == Okular::SettingsCore::EnumRenderMode::Paper;
+}
+
+void AccessibilityFilter::apply( QImage *image ) const
+{
+    if ( isNull() || image->isNull() )
+        return;
+
+    // the filters work on opaque pixels, so lay the transparent parts of the
+    // image on the white paper the accessibility modes paint it on
+    if ( image->hasAlphaChannel() )
+    {
+        QImage opaqueImage( image->size(), QImage::Format_RGB32 );
+        opaqueImage.fill( Qt::white );
+        QPainter p( &opaqueImage );
+        p.drawImage( 0, 0, *image );
+        p.end();
+        *image = opaqueImage;
+    }
+
+    if ( m_renderMode == Okular::SettingsCore::EnumRenderMode::Inverted )
+        // Invert image pixels using QImage internal function
+        image->invertPixels( QImage::InvertRgb );
+    else
+        mapGray( *image, m_table );
+}
+
+bool AccessibilityFilter::operator==( const AccessibilityFilter &other ) const
+{
+    if ( m_renderMode != other.m_renderMode )
+        return false;
+    if ( m_renderMode == Okular::SettingsCore::EnumRenderMode::Inverted || isNull() )
+        return true;
+    return memcmp( m_table.colors, other.m_table.colors, sizeof( m_table.colors ) ) == 0;
+}
+
+bool AccessibilityFilter::operator!=( const AccessibilityFilter &other ) const
+{
+    return !operator==( other );
+}
+
+/* kate: replace-tabs on; indent-width 4; */
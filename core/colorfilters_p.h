@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_COLORFILTERS_P_H_
+#define _OKULAR_COLORFILTERS_P_H_
+
+#include <QtGui/QRgb>
+
+#include "okularcore_export.h"
+
+class QColor;
+class QImage;
+class QRect;
+
+/**
+ * Pixel kernels of the accessibility color modes and of the highlights.
+ *
+ * They work in place on 32 bit images, four pixels at a time with SSE2
+ * where it is available. Large images are split in bands of rows which are
+ * filtered by several threads.
+ *
+ * The accessibility colors are applied by the generators to the rendered
+ * images, outside of the GUI thread, for the requests which ask for them.
+ */
+namespace ColorFilters
+{
+    /**
+     * The colors the gray levels of the pixels are mapped to.
+     */
+    struct GrayTable
+    {
+        QRgb colors[ 256 ];
+    };
+
+    /**
+     * Fills @p table for the black and white mode, with the given
+     * @p contrast and @p threshold of the accessibility settings.
+     */
+    OKULARCORE_EXPORT void blackWhiteTable( GrayTable *table, int contrast, int threshold );
+
+    /**
+     * Fills @p table for the recolor mode, which maps black to
+     * @p foreground and white to @p background.
+     */
+    OKULARCORE_EXPORT void recolorTable( GrayTable *table, const QColor &foreground, const QColor &background );
+
+    /**
+     * Replaces each pixel of @p image with the opaque color of its gray
+     * level in @p table.
+     */
+    OKULARCORE_EXPORT void mapGray( QImage &image, const GrayTable &table );
+
+    /**
+     * Multiplies the pixels of @p image inside @p rect with @p color, making
+     * them opaque. If @p transparentBlack is true, fully black pixels are
+     * taken as white, as they are the transparent ones of an image with
+     * an alpha channel.
+     */
+    OKULARCORE_EXPORT void multiply( QImage &image, const QRect &rect, const QColor &color, bool transparentBlack );
+
+    /**
+     * Same as mapGray() and multiply(), but one pixel at a time, to check
+     * the kernels against.
+     */
+    OKULARCORE_EXPORT void mapGrayScalar( QImage &image, const GrayTable &table );
+    OKULARCORE_EXPORT void multiplyScalar( QImage &image, const QRect &rect, const QColor &color, bool transparentBlack );
+
+    /**
+     * The accessibility color mode of the settings.
+     *
+     * It is read from the settings in the GUI thread, and applied to the
+     * images in any thread.
+     */
+    class OKULARCORE_EXPORT AccessibilityFilter
+    {
+        public:
+            /**
+             * Creates a filter which leaves the images as they are.
+             */
+            AccessibilityFilter();
+
+            /**
+             * Returns the filter of the current settings.
+             */
+            static AccessibilityFilter fromSettings();
+
+            /**
+             * Returns whether the filter leaves the images as they are.
+             */
+            bool isNull() const;
+
+            /**
+             * Applies the filter to @p image, laying its transparent parts
+             * on white paper first.
+             */
+            void apply( QImage *image ) const;
+
+            bool operator==( const AccessibilityFilter &other ) const;
+            bool operator!=( const AccessibilityFilter &other ) const;
+
+        private:
+            int m_renderMode;
+            GrayTable m_table;
+    };
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
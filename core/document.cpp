@@ -28,6 +28,7 @@
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QMap>
+#include <QtCore/QRegularExpression>
 #include <QtCore/qtemporaryfile.h>
 #include <QtCore/QTextStream>
 #include <QtCore/QTimer>
@@ -75,11 +76,13 @@
 #include "page.h"
 #include "page_p.h"
 #include "pagecontroller_p.h"
+#include "pixmapcache_p.h"
 #include "scripter.h"
 #include "settings_core.h"
 #include "sourcereference.h"
 #include "sourcereference_p.h"
 #include "texteditors_p.h"
+#include "textindex_p.h"
 #include "tile.h"
 #include "tilesmanager_p.h"
 #include "utils_p.h"
@@ -97,16 +100,6 @@
 
 using namespace Okular;
 
-struct AllocatedPixmap
-{
-    // owner of the page
-    DocumentObserver *observer;
-    int page;
-    qulonglong memory;
-    // public constructor: initialize data
-    AllocatedPixmap( DocumentObserver *o, int p, qulonglong m ) : observer( o ), page( p ), memory( m ) {}
-};
-
 struct ArchiveData
 {
     ArchiveData()
@@ -128,10 +121,18 @@ struct RunningSearch
     QString cachedString;
     Document::SearchType cachedType;
     Qt::CaseSensitivity cachedCaseSensitivity;
+    // what RegularExpression and WholeWords searches match
+    QRegularExpression cachedPattern;
     bool cachedViewportMove : 1;
     bool isCurrentlySearching : 1;
     QColor cachedColor;
     int pagesDone;
+
+    // whole document search running in background threads, if any
+    TextSearchJob *textSearchJob;
+    QList< TextSearchThread * > textSearchThreads;
+    int runningTextSearchThreads;
+    bool textSearchFoundAMatch;
 };
 
 #define foreachObserver( cmd ) {\
@@ -390,10 +391,13 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
         int clean_hits = 0;
         foreach (DocumentObserver *observer, m_observers)
         {
-            AllocatedPixmap * p = searchLowestPriorityPixmap( false, true, observer );
+            AllocatedPixmap * p = searchLowestPriorityPixmap( false, false, observer );
             if ( !p ) // No pixmap to remove
                 continue;
 
+            // only the pixmaps freed completely count as evicted for the policy
+            p = m_allocatedPixmaps.take( p->observer, p->page );
+
             clean_hits++;
 
             TilesManager *tilesManager = m_pagesVector.at( p->page )->d->tilesManager( observer );
@@ -415,7 +419,10 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
                 if ( p->memory > 0 )
                     pixmapsToKeep.append( p );
                 else
+                {
+                    m_allocatedPixmaps.markEvicted( p );
                     delete p;
+                }
             }
             else
                 pixmapsToKeep.append( p );
@@ -424,10 +431,51 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
         if (clean_hits == 0) break;
     }
 
-    m_allocatedPixmaps += pixmapsToKeep;
+    foreach ( AllocatedPixmap * p, pixmapsToKeep )
+        m_allocatedPixmaps.insert( p );
     //p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
 }
 
+/* Returns whether a full page pixmap equivalent to @p request is being
+ * generated right now. Must be called with m_pixmapRequestsMutex locked.
+ */
+bool DocumentPrivate::isPixmapRequestExecuting( const PixmapRequest * request ) const
+{
+    // executing requests have width and height swapped for rotated documents
+    const bool swapped = (int)m_rotation % 2;
+    const int width = swapped ? request->height() : request->width();
+    const int height = swapped ? request->width() : request->height();
+
+    QLinkedList< PixmapRequest * >::const_iterator eIt = m_executingPixmapRequests.constBegin(), eEnd = m_executingPixmapRequests.constEnd();
+    for ( ; eIt != eEnd; ++eIt )
+    {
+        const PixmapRequest * e = *eIt;
+        if ( !e->isTile() && e->observer() == request->observer() && e->pageNumber() == request->pageNumber()
+             && e->width() == width && e->height() == height )
+            return true;
+    }
+    return false;
+}
+
+void DocumentPrivate::updatePixmapCachePolicy()
+{
+    switch ( SettingsCore::pixmapCachePolicy() )
+    {
+        case SettingsCore::EnumPixmapCachePolicy::LeastRecentlyUsed:
+            m_allocatedPixmaps.setPolicy( PixmapCache::LeastRecentlyUsedPolicy );
+            break;
+
+        case SettingsCore::EnumPixmapCachePolicy::CostAware:
+            m_allocatedPixmaps.setPolicy( PixmapCache::CostAwarePolicy );
+            break;
+
+        case SettingsCore::EnumPixmapCachePolicy::Distance:
+        default:
+            m_allocatedPixmaps.setPolicy( PixmapCache::DistancePolicy );
+            break;
+    }
+}
+
 /* Returns the next pixmap to evict from cache, or NULL if no suitable pixmap
  * if found. If unloadableOnly is set, only unloadable pixmaps are returned. If
  * thenRemoveIt is set, the pixmap is removed from m_allocatedPixmaps before
@@ -435,37 +483,12 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
  */
 AllocatedPixmap * DocumentPrivate::searchLowestPriorityPixmap( bool unloadableOnly, bool thenRemoveIt, DocumentObserver *observer )
 {
-    QLinkedList< AllocatedPixmap * >::iterator pIt = m_allocatedPixmaps.begin();
-    QLinkedList< AllocatedPixmap * >::iterator pEnd = m_allocatedPixmaps.end();
-    QLinkedList< AllocatedPixmap * >::iterator farthestPixmap = pEnd;
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     /* Find the pixmap that is farthest from the current viewport */
-    int maxDistance = -1;
-    while ( pIt != pEnd )
-    {
-        const AllocatedPixmap * p = *pIt;
-        // Filter by observer
-        if ( observer == 0 || p->observer == observer )
-        {
-            const int distance = qAbs( p->page - currentViewportPage );
-            if ( maxDistance < distance && ( !unloadableOnly || p->observer->canUnloadPixmap( p->page ) ) )
-            {
-                maxDistance = distance;
-                farthestPixmap = pIt;
-            }
-        }
-        ++pIt;
-    }
-
-    /* No pixmap to remove */
-    if ( farthestPixmap == pEnd )
-        return 0;
-
-    AllocatedPixmap * selectedPixmap = *farthestPixmap;
     if ( thenRemoveIt )
-        m_allocatedPixmaps.erase( farthestPixmap );
-    return selectedPixmap;
+        return m_allocatedPixmaps.takeLowestPriority( currentViewportPage, unloadableOnly, observer );
+    return m_allocatedPixmaps.lowestPriority( currentViewportPage, unloadableOnly, observer );
 }
 
 qulonglong DocumentPrivate::getTotalMemory()
@@ -650,6 +673,9 @@ void DocumentPrivate::loadDocumentInfo( QFile &infoFile )
         // Restore page attributes (bookmark, annotations, ...) from the DOM
         if ( catName == "pageList" )
         {
+            m_pendingPageList = QDomDocument();
+            m_pendingPageList.appendChild( m_pendingPageList.createElement( "pageList" ) );
+
             QDomNode pageNode = topLevelNode.firstChild();
             while ( pageNode.isElement() )
             {
@@ -663,6 +689,9 @@ void DocumentPrivate::loadDocumentInfo( QFile &infoFile )
                     // pass the domElement to the right page, to read config data from
                     if ( ok && pageNumber >= 0 && pageNumber < (int)m_pagesVector.count() )
                         m_pagesVector[ pageNumber ]->d->restoreLocalContents( pageElement );
+                    // keep the data of the pages the generator adds later, see appendPages()
+                    else if ( ok && pageNumber >= 0 )
+                        m_pendingPageList.documentElement().appendChild( m_pendingPageList.importNode( pageElement, true ) );
                 }
                 pageNode = pageNode.nextSibling();
             }
@@ -1141,6 +1170,9 @@ void DocumentPrivate::performModifyPageAnnotation( int page, Annotation * annota
     if ( !m_generator || !kp )
         return;
 
+    // the annotation may have been moved or resized
+    kp->d->m_objectRectIndex.update( annotation );
+
     // tell the annotation proxy
     if ( proxy && proxy->supports(AnnotationProxy::Modification) )
     {
@@ -1244,6 +1276,10 @@ void DocumentPrivate::saveDocumentInfo() const
         QVector< Page * >::const_iterator pIt = m_pagesVector.constBegin(), pEnd = m_pagesVector.constEnd();
         for ( ; pIt != pEnd; ++pIt )
             (*pIt)->d->saveLocalContents( pageList, doc, saveWhat );
+        // save back untouched the data of the pages not available yet
+        QDomNode pendingNode = m_pendingPageList.documentElement().firstChild();
+        for ( ; pendingNode.isElement(); pendingNode = pendingNode.nextSibling() )
+            pageList.appendChild( doc.importNode( pendingNode, true ) );
 
         // 2.2. Save document info (current viewport, history, ... ) to DOM
         QDomElement generalInfo = doc.createElement( "generalInfo" );
@@ -1313,11 +1349,12 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
     /* If the pixmap cache will have to be cleaned in order to make room for the
      * next request, get the distance from the current viewport of the page
      * whose pixmap will be removed. We will ignore preload requests for pages
-     * that are at the same distance or farther */
+     * that are at the same distance or farther. The other policies do not
+     * rank pixmaps by distance, so they get no such cutoff */
     const qulonglong memoryToFree = calculateMemoryToFree();
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
     int maxDistance = INT_MAX; // Default: No maximum
-    if ( memoryToFree )
+    if ( memoryToFree && m_allocatedPixmaps.policy() == PixmapCache::DistancePolicy )
     {
         AllocatedPixmap *pixmapToReplace = searchLowestPriorityPixmap( true );
         if ( pixmapToReplace )
@@ -1349,6 +1386,8 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         // request only if page isn't already present and request has valid id
         else if ( ( !r->d->mForce && r->page()->hasPixmap( r->observer(), r->width(), r->height(), r->normalizedRect() ) ) || !m_observers.contains(r->observer()) )
         {
+            // the pixmap is still wanted, tell the eviction policy
+            m_allocatedPixmaps.markUsed( r->observer(), r->pageNumber() );
             m_pixmapRequestsStack.pop_back();
             delete r;
         }
@@ -1364,6 +1403,12 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
             m_pixmapRequestsStack.pop_back();
             delete r;
         }
+        // Ignore requests whose pixmap is already being generated by another worker
+        else if ( !r->d->mForce && !r->isTile() && isPixmapRequestExecuting( r ) )
+        {
+            m_pixmapRequestsStack.pop_back();
+            delete r;
+        }
         // If the requested area is above 8000000 pixels, switch on the tile manager
         else if ( !tilesManager && m_generator->hasFeature( Generator::TiledRendering ) && (long)r->width() * (long)r->height() > 8000000L )
         {
@@ -1489,8 +1534,21 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         // a sync generation would end with requestDone() -> deadlock, and
         // we can not really know if the generator can do async requests
         m_executingPixmapRequests.push_back( request );
+        const bool threaded = request->asynchronous() && m_generator->hasFeature( Generator::Threaded );
         m_pixmapRequestsMutex.unlock();
+        request->d->mRenderTimer.start();
         m_generator->generatePixmap( request );
+
+        // a generator with more than one worker may be able to take the
+        // next request right away; sync requests already did this in requestDone()
+        if ( threaded && m_generator->canGeneratePixmap() )
+        {
+            m_pixmapRequestsMutex.lock();
+            const bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+            m_pixmapRequestsMutex.unlock();
+            if ( hasPixmaps )
+                sendGeneratorPixmapRequest();
+        }
     }
     else
     {
@@ -1557,7 +1615,6 @@ void DocumentPrivate::slotGeneratorConfigChanged( const QString& )
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll( m_allocatedPixmaps );
         m_allocatedPixmaps.clear();
         m_allocatedPixmapsTotalMemory = 0;
 
@@ -1571,6 +1628,15 @@ void DocumentPrivate::slotGeneratorConfigChanged( const QString& )
         cleanupPixmapMemory();
 }
 
+PixmapRequest::PixmapRequestFeatures DocumentPrivate::refreshFeatures( DocumentObserver *observer ) const
+{
+    // the pixmaps made again have the colors of the ones they replace
+    PixmapRequest::PixmapRequestFeatures features = PixmapRequest::Asynchronous;
+    if ( m_accessibilityObservers.contains( observer ) )
+        features |= PixmapRequest::Accessibility;
+    return features;
+}
+
 void DocumentPrivate::refreshPixmaps( int pageNumber )
 {
     Page* page = m_pagesVector.value( pageNumber, 0 );
@@ -1582,7 +1648,7 @@ void DocumentPrivate::refreshPixmaps( int pageNumber )
     for ( ; it != itEnd; ++it )
     {
         QSize size = (*it).m_pixmap->size();
-        PixmapRequest * p = new PixmapRequest( it.key(), pageNumber, size.width(), size.height(), 1, PixmapRequest::Asynchronous );
+        PixmapRequest * p = new PixmapRequest( it.key(), pageNumber, size.width(), size.height(), 1, refreshFeatures( it.key() ) );
         p->d->mForce = true;
         requestedPixmaps.push_back( p );
     }
@@ -1594,7 +1660,7 @@ void DocumentPrivate::refreshPixmaps( int pageNumber )
         {
             tilesManager->markDirty();
 
-            PixmapRequest * p = new PixmapRequest( observer, pageNumber, tilesManager->width(), tilesManager->height(), 1, PixmapRequest::Asynchronous );
+            PixmapRequest * p = new PixmapRequest( observer, pageNumber, tilesManager->width(), tilesManager->height(), 1, refreshFeatures( observer ) );
 
             NormalizedRect tilesRect;
 
@@ -1630,13 +1696,38 @@ void DocumentPrivate::refreshPixmaps( int pageNumber )
 
 void DocumentPrivate::_o_configChanged()
 {
-    // free text pages if needed
-    calculateMaxTextPages();
-    while (m_allocatedTextPagesFifo.count() > m_maxAllocatedTextPages)
+    updatePixmapCachePolicy();
+
+    // the pixmaps with the accessibility colors have to be made again
+    const ColorFilters::AccessibilityFilter accessibilityFilter = ColorFilters::AccessibilityFilter::fromSettings();
+    if ( accessibilityFilter != m_accessibilityFilter )
     {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        m_pagesVector.at(pageToKick)->setTextPage( 0 ); // deletes the textpage
+        m_accessibilityFilter = accessibilityFilter;
+        if ( !m_accessibilityObservers.isEmpty() )
+        {
+            // invalidate pixmaps
+            QVector<Page*>::const_iterator it = m_pagesVector.constBegin(), end = m_pagesVector.constEnd();
+            for ( ; it != end; ++it ) {
+                (*it)->deletePixmaps();
+            }
+
+            // [MEM] remove allocation descriptors
+            m_allocatedPixmaps.clear();
+            m_allocatedPixmapsTotalMemory = 0;
+
+            // send reload signals to observers
+            foreachObserverD( notifyContentsCleared( DocumentObserver::Pixmap ) );
+        }
     }
+
+    if ( SettingsCore::searchIndex() )
+        startTextIndex();
+    else
+        stopTextIndex();
+
+    // free text pages if needed
+    calculateMaxTextPagesMemory();
+    cleanupTextPageMemory( -1 );
 }
 
 void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct)
@@ -1687,6 +1778,7 @@ void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMa
 
         // if found a match on the current page, end the loop
         searchStruct->match = page->findText( searchStruct->searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity );
+        markTextPageUsed( page->number() );
         if ( !searchStruct->match )
         {
             if (forward) searchStruct->currentPage++;
@@ -1794,21 +1886,31 @@ void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *
             m_parent->requestTextPage( pageNumber );
 
         // loop on a page adding highlights for all found items
-        RegularAreaRect * lastMatch = 0;
-        while ( 1 )
+        if ( !search->cachedPattern.pattern().isEmpty() )
         {
-            if ( lastMatch )
-                lastMatch = page->findText( searchID, search->cachedString, NextResult, search->cachedCaseSensitivity, lastMatch );
-            else
-                lastMatch = page->findText( searchID, search->cachedString, FromTop, search->cachedCaseSensitivity );
+            const QVector<RegularAreaRect *> matches = page->d->m_text ? page->d->m_text->findAll( search->cachedPattern ) : QVector<RegularAreaRect *>();
+            if ( !matches.isEmpty() )
+                (*pageMatches)[page] = matches;
+        }
+        else
+        {
+            RegularAreaRect * lastMatch = 0;
+            while ( 1 )
+            {
+                if ( lastMatch )
+                    lastMatch = page->findText( searchID, search->cachedString, NextResult, search->cachedCaseSensitivity, lastMatch );
+                else
+                    lastMatch = page->findText( searchID, search->cachedString, FromTop, search->cachedCaseSensitivity );
 
-            if ( !lastMatch )
-                break;
+                if ( !lastMatch )
+                    break;
 
-            // add highligh rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
+                // add highligh rect to the matches map
+                (*pageMatches)[page].append(lastMatch);
+            }
+            delete lastMatch;
         }
-        delete lastMatch;
+        markTextPageUsed( pageNumber );
 
         QMetaObject::invokeMethod(m_parent, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotifySet), Q_ARG(void *, pageMatches), Q_ARG(int, currentPage + 1), Q_ARG(int, searchID));
     }
@@ -1920,6 +2022,7 @@ void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, vo
             allMatched = allMatched && wordMatched;
             anyMatched = anyMatched || wordMatched;
         }
+        markTextPageUsed( pageNumber );
 
         // if not all words are present in page, remove partial highlights
         const bool matchAll = search->cachedType == Document::GoogleAll;
@@ -1970,6 +2073,388 @@ void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, vo
     }
 }
 
+void DocumentPrivate::startTextSearch( int searchID, RunningSearch *search, const QStringList &words, QSet< int > *pagesToNotify )
+{
+    TextSearchJob *job = new TextSearchJob;
+    job->id = ++m_lastTextSearchJobId;
+    job->searchID = searchID;
+    job->words = words;
+    job->caseSensitivity = search->cachedCaseSensitivity;
+    job->pattern = search->cachedPattern;
+
+    search->textSearchJob = job;
+    search->textSearchFoundAMatch = false;
+
+    // the pages that can contain each word, according to the index; any
+    // page can match a regular expression
+    const bool usePattern = !search->cachedPattern.pattern().isEmpty();
+    QVector< QSet< int > > indexCandidates;
+    if ( m_textIndex && search->cachedType != Document::RegularExpression )
+    {
+        foreach ( const QString &word, words )
+            indexCandidates.append( m_textIndex->candidatePages( word, search->cachedCaseSensitivity ) );
+    }
+
+    // pages whose text is already there or in the index are searched right
+    // away, the text of the other ones is extracted and searched by the threads
+    foreach ( Page *page, m_pagesVector )
+    {
+        QVector< QVector< RegularAreaRect * > > matches( words.count() );
+
+        if ( !page->hasTextPage() && m_textIndex && m_textIndex->hasPage( page->number() ) )
+        {
+            for ( int w = 0; w < words.count(); ++w )
+            {
+                if ( !indexCandidates.isEmpty() && !indexCandidates.at( w ).contains( page->number() ) )
+                    continue;
+
+                if ( usePattern )
+                    matches[ w ] = m_textIndex->findAll( page->number(), search->cachedPattern, page->d->rotationMatrix() );
+                else
+                    matches[ w ] = m_textIndex->findText( page->number(), words.at( w ), search->cachedCaseSensitivity, page->d->rotationMatrix() );
+            }
+
+            if ( applyTextSearchMatches( searchID, search, page, matches ) )
+                pagesToNotify->insert( page->number() );
+            continue;
+        }
+
+        if ( !page->hasTextPage() )
+        {
+            job->pages.append( page->d );
+            continue;
+        }
+
+        for ( int w = 0; w < words.count(); ++w )
+        {
+            if ( usePattern )
+            {
+                matches[ w ] = page->d->m_text->findAll( search->cachedPattern );
+                continue;
+            }
+
+            RegularAreaRect * lastMatch = 0;
+            while ( 1 )
+            {
+                if ( lastMatch )
+                    lastMatch = page->findText( searchID, words.at( w ), NextResult, search->cachedCaseSensitivity, lastMatch );
+                else
+                    lastMatch = page->findText( searchID, words.at( w ), FromTop, search->cachedCaseSensitivity );
+
+                if ( !lastMatch )
+                    break;
+
+                matches[ w ].append( lastMatch );
+            }
+        }
+        markTextPageUsed( page->number() );
+
+        if ( applyTextSearchMatches( searchID, search, page, matches ) )
+            pagesToNotify->insert( page->number() );
+    }
+
+    foreach ( int pageNumber, *pagesToNotify )
+        foreachObserverD( notifyPageChanged( pageNumber, DocumentObserver::Highlights ) );
+    delete pagesToNotify;
+
+    if ( job->pages.isEmpty() )
+    {
+        // finish asynchronously, as if the threads were done
+        search->runningTextSearchThreads = 1;
+        QMetaObject::invokeMethod( m_parent, "textSearchDone", Qt::QueuedConnection, Q_ARG( int, job->id ) );
+        return;
+    }
+
+    int threadCount = 1;
+    if ( m_generator->hasFeature( Generator::ThreadedMultiple ) )
+        threadCount = qBound( 1, QThread::idealThreadCount(), job->pages.count() );
+
+    search->runningTextSearchThreads = threadCount;
+    for ( int i = 0; i < threadCount; ++i )
+    {
+        TextSearchThread *thread = new TextSearchThread( m_generator, job );
+        QObject::connect( thread, SIGNAL(pageSearched(void*)), m_parent, SLOT(textSearchPageDone(void*)), Qt::QueuedConnection );
+        QObject::connect( thread, SIGNAL(searchDone(int)), m_parent, SLOT(textSearchDone(int)), Qt::QueuedConnection );
+        search->textSearchThreads.append( thread );
+        thread->start( QThread::LowPriority );
+    }
+}
+
+void DocumentPrivate::stopTextSearch( RunningSearch *search )
+{
+    TextSearchJob *job = search->textSearchJob;
+    if ( !job )
+        return;
+
+    // results already queued by the threads are dropped when they arrive,
+    // as their job is not found anymore
+    job->cancelled.store( 1 );
+    foreach ( TextSearchThread *thread, search->textSearchThreads )
+    {
+        thread->wait();
+        delete thread;
+    }
+    search->textSearchThreads.clear();
+    search->runningTextSearchThreads = 0;
+    search->textSearchJob = 0;
+    delete job;
+
+    QApplication::restoreOverrideCursor();
+    search->isCurrentlySearching = false;
+}
+
+void DocumentPrivate::finishTextSearch( int searchID, RunningSearch *search )
+{
+    const bool cancelled = m_searchCancelled || search->textSearchJob->cancelled.load();
+    stopTextSearch( search );
+
+    if ( cancelled )
+    {
+        emit m_parent->searchFinished( searchID, Document::SearchCancelled );
+        return;
+    }
+
+    // send page lists to update observers (since some filter on bookmarks)
+    foreachObserverD( notifySetup( m_pagesVector, 0 ) );
+
+    if ( search->textSearchFoundAMatch ) emit m_parent->searchFinished( searchID, Document::MatchFound );
+    else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
+}
+
+RunningSearch *DocumentPrivate::textSearchForJob( int jobId, int *searchID ) const
+{
+    QMap< int, RunningSearch * >::const_iterator it = m_searches.constBegin(), itEnd = m_searches.constEnd();
+    for ( ; it != itEnd; ++it )
+    {
+        if ( it.value()->textSearchJob && it.value()->textSearchJob->id == jobId )
+        {
+            *searchID = it.key();
+            return it.value();
+        }
+    }
+    return 0;
+}
+
+/* Highlights the @p matches of the words of @p search on @p page, and deletes
+ * them. Returns whether the page has been highlighted.
+ */
+bool DocumentPrivate::applyTextSearchMatches( int searchID, RunningSearch *search, Page *page, const QVector< QVector< RegularAreaRect * > > &matches )
+{
+    const int wordCount = matches.count();
+    bool allMatched = wordCount > 0,
+         anyMatched = false;
+    for ( int w = 0; w < wordCount; w++ )
+    {
+        allMatched = allMatched && !matches.at( w ).isEmpty();
+        anyMatched = anyMatched || !matches.at( w ).isEmpty();
+    }
+
+    // with GoogleAll all the words have to be on the page
+    const bool highlight = search->cachedType == Document::GoogleAll ? allMatched : anyMatched;
+    if ( highlight )
+    {
+        const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
+        int baseHue, baseSat, baseVal;
+        search->cachedColor.getHsv( &baseHue, &baseSat, &baseVal );
+
+        for ( int w = 0; w < wordCount; w++ )
+        {
+            QColor wordColor = search->cachedColor;
+            if ( search->cachedType == Document::GoogleAll || search->cachedType == Document::GoogleAny )
+            {
+                int newHue = baseHue - w * hueStep;
+                if ( newHue < 0 )
+                    newHue += 360;
+                wordColor = QColor::fromHsv( newHue, baseSat, baseVal );
+            }
+
+            foreach ( RegularAreaRect *match, matches.at( w ) )
+                page->d->setHighlight( searchID, match, wordColor );
+        }
+        search->highlightedPages.insert( page->number() );
+        search->textSearchFoundAMatch = true;
+    }
+
+    for ( int w = 0; w < wordCount; w++ )
+        qDeleteAll( matches.at( w ) );
+
+    return highlight;
+}
+
+void DocumentPrivate::textSearchPageDone( void *textSearchResult )
+{
+    TextSearchResult *result = static_cast< TextSearchResult * >( textSearchResult );
+
+    if ( m_textIndexJob && result->jobId == m_textIndexJob->id )
+    {
+        if ( m_textIndex->addPage( result->page->m_number, result->textPage ) )
+            m_textIndexChanged = true;
+        delete result->textPage;
+        delete result;
+        return;
+    }
+
+    int searchID = -1;
+    RunningSearch *search = textSearchForJob( result->jobId, &searchID );
+
+    if ( search && !m_searchCancelled )
+    {
+        Page *page = result->page->m_page;
+        if ( applyTextSearchMatches( searchID, search, page, result->matches ) )
+            foreachObserverD( notifyPageChanged( page->number(), DocumentObserver::Highlights ) );
+
+        // keep the text, as requestTextPage() would have done
+        if ( result->textPage && !page->hasTextPage() )
+        {
+            page->setTextPage( result->textPage );
+            textGenerationDone( page );
+            result->textPage = 0;
+        }
+    }
+    else
+    {
+        // stale result of a stopped search, whose page may be gone too
+        for ( int w = 0; w < result->matches.count(); w++ )
+            qDeleteAll( result->matches.at( w ) );
+    }
+
+    delete result->textPage;
+    delete result;
+}
+
+void DocumentPrivate::textSearchDone( int jobId )
+{
+    if ( m_textIndexJob && jobId == m_textIndexJob->id )
+    {
+        m_textIndexThread->wait();
+        delete m_textIndexThread;
+        m_textIndexThread = 0;
+        // pages queued after the thread was done get a new one
+        const QVector< PagePrivate * > pendingPages = m_textIndexJob->pages.mid( m_textIndexJob->nextPage );
+        delete m_textIndexJob;
+        m_textIndexJob = 0;
+        saveTextIndex();
+        queueTextIndexPages( pendingPages );
+        return;
+    }
+
+    int searchID = -1;
+    RunningSearch *search = textSearchForJob( jobId, &searchID );
+    if ( !search || --search->runningTextSearchThreads > 0 )
+        return;
+
+    finishTextSearch( searchID, search );
+}
+
+void DocumentPrivate::textIndexLoaded( int jobId )
+{
+    if ( !m_textIndexJob || jobId != m_textIndexJob->id )
+        return;
+
+    m_textIndex = m_textIndexJob->index;
+    m_textIndexJob->index = 0;
+    // pages may have been appended while it was loading
+    m_textIndex->setPageCount( m_pagesVector.count() );
+    m_textIndexChanged = false;
+
+    // pages with text already are indexed as is
+    QVector< PagePrivate * > pages;
+    foreach ( Page *page, m_pagesVector )
+    {
+        if ( page->hasTextPage() && m_textIndex->addPage( page->number(), page->d->m_text ) )
+            m_textIndexChanged = true;
+        pages.append( page->d );
+    }
+
+    queueTextIndexPages( pages );
+}
+
+void DocumentPrivate::startTextIndex()
+{
+    if ( m_textIndex || m_textIndexJob || !SettingsCore::searchIndex() || m_xmlFileName.isEmpty() || !m_generator
+         || !m_generator->hasFeature( Generator::TextExtraction ) || !m_generator->hasFeature( Generator::Threaded ) )
+        return;
+
+    // the index thread loads the index first, then textIndexLoaded() gives
+    // it the pages to index
+    const QFileInfo documentInfo( m_docFileName );
+    m_textIndexJob = new TextSearchJob;
+    m_textIndexJob->index = new TextIndex( m_pagesVector.count(), documentInfo.size(), documentInfo.lastModified() );
+    m_textIndexJob->indexFileName = TextIndex::fileName( m_xmlFileName );
+    startTextIndexThread();
+}
+
+void DocumentPrivate::queueTextIndexPages( const QVector< PagePrivate * > &pages )
+{
+    QVector< PagePrivate * > pagesToIndex;
+    foreach ( PagePrivate *page, pages )
+    {
+        if ( !m_textIndex->hasPage( page->m_number ) )
+            pagesToIndex.append( page );
+    }
+
+    if ( pagesToIndex.isEmpty() )
+        return;
+
+    // the running thread takes them too, unless it is done already; then
+    // textSearchDone() queues them again
+    if ( m_textIndexJob )
+    {
+        QMutexLocker locker( &m_textIndexJob->pagesMutex );
+        m_textIndexJob->pages += pagesToIndex;
+        return;
+    }
+
+    m_textIndexJob = new TextSearchJob;
+    m_textIndexJob->pages = pagesToIndex;
+    startTextIndexThread();
+}
+
+void DocumentPrivate::startTextIndexThread()
+{
+    m_textIndexJob->id = ++m_lastTextSearchJobId;
+    m_textIndexJob->searchID = -1;
+    m_textIndexJob->caseSensitivity = Qt::CaseSensitive;
+
+    // a search without words just extracts the text
+    m_textIndexThread = new TextSearchThread( m_generator, m_textIndexJob );
+    QObject::connect( m_textIndexThread, SIGNAL(indexLoaded(int)), m_parent, SLOT(textIndexLoaded(int)), Qt::QueuedConnection );
+    QObject::connect( m_textIndexThread, SIGNAL(pageSearched(void*)), m_parent, SLOT(textSearchPageDone(void*)), Qt::QueuedConnection );
+    QObject::connect( m_textIndexThread, SIGNAL(searchDone(int)), m_parent, SLOT(textSearchDone(int)), Qt::QueuedConnection );
+    m_textIndexThread->start( QThread::LowestPriority );
+}
+
+void DocumentPrivate::stopTextIndex()
+{
+    if ( m_textIndexJob )
+    {
+        m_textIndexJob->cancelled.store( 1 );
+        m_textIndexThread->wait();
+        delete m_textIndexThread;
+        m_textIndexThread = 0;
+        // the index, if it was still being loaded
+        delete m_textIndexJob->index;
+        delete m_textIndexJob;
+        m_textIndexJob = 0;
+    }
+
+    saveTextIndex();
+    delete m_textIndex;
+    m_textIndex = 0;
+}
+
+void DocumentPrivate::saveTextIndex()
+{
+    if ( !m_textIndex || !m_textIndexChanged )
+        return;
+
+    // an incomplete index is saved too, the next time only the missing pages are indexed
+    if ( m_textIndex->save( TextIndex::fileName( m_xmlFileName ) ) )
+        m_textIndexChanged = false;
+    else
+        qCWarning(OkularCoreDebug) << "Could not save the text index of" << m_xmlFileName;
+}
+
 QVariant DocumentPrivate::documentMetaData( const QString &key, const QVariant &option ) const
 {
     if ( key == QLatin1String( "PaperColor" ) )
@@ -2187,6 +2672,7 @@ Document::Document( QWidget *widget )
     d->m_viewportIterator = d->m_viewportHistory.insert( d->m_viewportHistory.end(), DocumentViewport() );
     d->m_undoStack = new QUndoStack(this);
 
+    d->m_accessibilityFilter = ColorFilters::AccessibilityFilter::fromSettings();
     connect( SettingsCore::self(), SIGNAL(configChanged()), this, SLOT(_o_configChanged()) );
     connect(d->m_undoStack, &QUndoStack::canUndoChanged, this, &Document::canUndoChanged);
     connect(d->m_undoStack, &QUndoStack::canRedoChanged, this, &Document::canRedoChanged);
@@ -2430,7 +2916,11 @@ Document::OpenResult Document::openDocument(const QString & docFile, const QUrl
     {
         (*d->m_viewportIterator) = DocumentViewport();
         if ( loadedViewport.pageNumber >= (int)d->m_pagesVector.size() )
+        {
+            // the generator may still append the page, see appendPages()
+            d->m_restoredViewport = loadedViewport;
             loadedViewport.pageNumber = d->m_pagesVector.size() - 1;
+        }
     }
     else
         loadedViewport.pageNumber = 0;
@@ -2463,6 +2953,9 @@ Document::OpenResult Document::openDocument(const QString & docFile, const QUrl
     AudioPlayer::instance()->d->m_currentDocument = isstdin ? QUrl() : d->m_url;
     d->m_docSize = document_size;
 
+    // 5. build the full text index in background, if enabled
+    d->startTextIndex();
+
     const QStringList docScripts = d->m_generator->metaData( "DocumentScripts", "JavaScript" ).toStringList();
     if ( !docScripts.isEmpty() )
     {
@@ -2533,6 +3026,19 @@ void Document::closeDocument()
         d->m_fontThread = 0;
     }
 
+    d->stopTextIndex();
+
+    // stop the searches still extracting text
+    QMap< int, RunningSearch * >::const_iterator searchIt = d->m_searches.constBegin(), searchEnd = d->m_searches.constEnd();
+    for ( ; searchIt != searchEnd; ++searchIt )
+    {
+        if ( searchIt.value()->textSearchJob )
+        {
+            d->stopTextSearch( searchIt.value() );
+            emit searchFinished( searchIt.key(), SearchCancelled );
+        }
+    }
+
     // stop any audio playback
     AudioPlayer::instance()->stopPlaybacks();
 
@@ -2592,9 +3098,10 @@ void Document::closeDocument()
     for ( ; pIt != pEnd; ++pIt )
         delete *pIt;
     d->m_pagesVector.clear();
+    d->m_restoredViewport = DocumentViewport();
+    d->m_pendingPageList = QDomDocument();
 
     // clear 'memory allocation' descriptors
-    qDeleteAll( d->m_allocatedPixmaps );
     d->m_allocatedPixmaps.clear();
 
     // clear 'running searches' descriptors
@@ -2618,7 +3125,10 @@ void Document::closeDocument()
     d->m_viewportHistory.append( DocumentViewport() );
     d->m_viewportIterator = d->m_viewportHistory.begin();
     d->m_allocatedPixmapsTotalMemory = 0;
-    d->m_allocatedTextPagesFifo.clear();
+    d->m_allocatedTextPagesLru.clear();
+    d->m_allocatedTextPagesLruIndex.clear();
+    d->m_allocatedTextPagesMemory.clear();
+    d->m_allocatedTextPagesTotalMemory = 0;
     d->m_pageSize = PageSize();
     d->m_pageSizes.clear();
 
@@ -2654,19 +3164,8 @@ void Document::removeObserver( DocumentObserver * pObserver )
             (*it)->deletePixmap( pObserver );
 
         // [MEM] free observer's allocation descriptors
-        QLinkedList< AllocatedPixmap * >::iterator aIt = d->m_allocatedPixmaps.begin();
-        QLinkedList< AllocatedPixmap * >::iterator aEnd = d->m_allocatedPixmaps.end();
-        while ( aIt != aEnd )
-        {
-            AllocatedPixmap * p = *aIt;
-            if ( p->observer == pObserver )
-            {
-                aIt = d->m_allocatedPixmaps.erase( aIt );
-                delete p;
-            }
-            else
-                ++aIt;
-        }
+        d->m_allocatedPixmaps.removeObserver( pObserver );
+        d->m_accessibilityObservers.remove( pObserver );
 
         // delete observer entry from the map
         d->m_observers.remove( pObserver );
@@ -2692,7 +3191,6 @@ void Document::reparseConfig()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll( d->m_allocatedPixmaps );
         d->m_allocatedPixmaps.clear();
         d->m_allocatedPixmapsTotalMemory = 0;
 
@@ -3121,6 +3619,12 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
 
         request->d->mPage = d->m_pagesVector.value( request->pageNumber() );
 
+        if ( request->d->mFeatures & PixmapRequest::Accessibility )
+        {
+            d->m_accessibilityObservers.insert( request->observer() );
+            request->d->mAccessibilityFilter = d->m_accessibilityFilter;
+        }
+
         if ( request->isTile() )
         {
             // Change the current request rect so that only invalid tiles are
@@ -3512,6 +4016,28 @@ void Document::setNextDocumentDestination( const QString &namedDestination )
     d->m_nextDocumentDestination = namedDestination;
 }
 
+/* Returns the regular expression a RegularExpression or a WholeWords search
+ * of @p text matches with, or an empty one for the other search types.
+ */
+static QRegularExpression searchPattern( const QString &text, Document::SearchType type, Qt::CaseSensitivity caseSensitivity )
+{
+    QString pattern;
+    if ( type == Document::RegularExpression )
+        pattern = text;
+    else if ( type == Document::WholeWords )
+    {
+        // normalize as TextPage::findText() does, and don't match inside words
+        pattern = QLatin1String( "(?<!\\w)" ) + QRegularExpression::escape( text.normalized( QString::NormalizationForm_KC ) ) + QLatin1String( "(?!\\w)" );
+    }
+    else
+        return QRegularExpression();
+
+    QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
+    if ( caseSensitivity == Qt::CaseInsensitive )
+        options |= QRegularExpression::CaseInsensitiveOption;
+    return QRegularExpression( pattern, options );
+}
+
 void Document::searchText( int searchID, const QString & text, bool fromStart, Qt::CaseSensitivity caseSensitivity,
                                SearchType type, bool moveViewport, const QColor & color )
 {
@@ -3530,15 +4056,22 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     {
         RunningSearch * search = new RunningSearch();
         search->continueOnPage = -1;
+        search->textSearchJob = 0;
+        search->runningTextSearchThreads = 0;
+        search->textSearchFoundAMatch = false;
         searchIt = d->m_searches.insert( searchID, search );
     }
     RunningSearch * s = *searchIt;
 
+    // a new search replaces the one still running in background
+    d->stopTextSearch( s );
+
     // update search structure
     bool newText = text != s->cachedString;
     s->cachedString = text;
     s->cachedType = type;
     s->cachedCaseSensitivity = caseSensitivity;
+    s->cachedPattern = searchPattern( text, type, caseSensitivity );
     s->cachedViewportMove = moveViewport;
     s->cachedColor = color;
     s->isCurrentlySearching = true;
@@ -3552,11 +4085,32 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
         d->m_pagesVector.at(pageNumber)->d->deleteHighlights( searchID );
     s->highlightedPages.clear();
 
+    // an invalid regular expression matches nothing
+    if ( !s->cachedPattern.isValid() )
+    {
+        foreach ( int pageNumber, *pagesToNotify )
+            foreachObserver( notifyPageChanged( pageNumber, DocumentObserver::Highlights ) );
+        delete pagesToNotify;
+
+        s->isCurrentlySearching = false;
+        emit searchFinished( searchID, NoMatchFound );
+        return;
+    }
+
     // set hourglass cursor
     QApplication::setOverrideCursor( Qt::WaitCursor );
 
-    // 1. ALLDOC - proces all document marking pages
-    if ( type == AllDocument )
+    const bool wholeDocument = type == AllDocument || type == RegularExpression || type == WholeWords;
+
+    // 1. ALLDOC / GOOGLE* / REGEXP / WHOLEWORDS - process all document marking
+    // pages, extracting the text in background if the generator can do that
+    // in threads
+    if ( ( wholeDocument || type == GoogleAll || type == GoogleAny ) && d->m_generator->hasFeature( Generator::Threaded ) )
+    {
+        const QStringList words = wholeDocument ? QStringList( text ) : text.split( ' ', QString::SkipEmptyParts );
+        d->startTextSearch( searchID, s, words, pagesToNotify );
+    }
+    else if ( wholeDocument )
     {
         QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = new QMap< Page *, QVector<RegularAreaRect *> >;
 
@@ -3660,6 +4214,12 @@ void Document::resetSearch( int searchID )
     // get previous parameters for search
     RunningSearch * s = *searchIt;
 
+    if ( s->textSearchJob )
+    {
+        d->stopTextSearch( s );
+        emit searchFinished( searchID, SearchCancelled );
+    }
+
     // unhighlight pages and inform observers about that
     foreach(int pageNumber, s->highlightedPages)
     {
@@ -3678,6 +4238,13 @@ void Document::resetSearch( int searchID )
 void Document::cancelSearch()
 {
     d->m_searchCancelled = true;
+
+    // let the background searches stop, they will report when done
+    foreach ( RunningSearch *search, d->m_searches )
+    {
+        if ( search->textSearchJob )
+            search->textSearchJob->cancelled.store( 1 );
+    }
 }
 
 void Document::undo()
@@ -4588,17 +5155,15 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
 #endif
 
     // [MEM] 1.1 find and remove a previous entry for the same page and id
-    QLinkedList< AllocatedPixmap * >::iterator aIt = m_allocatedPixmaps.begin();
-    QLinkedList< AllocatedPixmap * >::iterator aEnd = m_allocatedPixmaps.end();
-    for ( ; aIt != aEnd; ++aIt )
-        if ( (*aIt)->page == req->pageNumber() && (*aIt)->observer == req->observer() )
-        {
-            AllocatedPixmap * p = *aIt;
-            m_allocatedPixmaps.erase( aIt );
-            m_allocatedPixmapsTotalMemory -= p->memory;
-            delete p;
-            break;
-        }
+    qint64 renderTime = req->d->mRenderTimer.isValid() ? req->d->mRenderTimer.elapsed() : 0;
+    if ( AllocatedPixmap * p = m_allocatedPixmaps.take( req->observer(), req->pageNumber() ) )
+    {
+        // tiles of a page add up to its render time
+        if ( req->isTile() )
+            renderTime += p->renderTime;
+        m_allocatedPixmapsTotalMemory -= p->memory;
+        delete p;
+    }
 
     DocumentObserver *observer = req->observer();
     if ( m_observers.contains(observer) )
@@ -4612,7 +5177,9 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
             memoryBytes = 4 * req->width() * req->height();
 
         AllocatedPixmap * memoryPage = new AllocatedPixmap( req->observer(), req->pageNumber(), memoryBytes );
-        m_allocatedPixmaps.append( memoryPage );
+        memoryPage->renderTime = renderTime;
+        m_allocatedPixmaps.insert( memoryPage );
+        m_allocatedPixmaps.markUsed( req->observer(), req->pageNumber() );
         m_allocatedPixmapsTotalMemory += memoryBytes;
 
         // 2. notify an observer that its pixmap changed
@@ -4657,45 +5224,157 @@ void DocumentPrivate::setPageBoundingBox( int page, const NormalizedRect& boundi
 
 }
 
-void DocumentPrivate::calculateMaxTextPages()
+void DocumentPrivate::appendPages( const QVector< Page * > &pages )
 {
-    int multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
+    const int previousPageCount = m_pagesVector.count();
+    foreach ( Page *page, pages )
+    {
+        page->d->m_doc = this;
+        if ( m_rotation != Rotation0 )
+            page->d->rotateAt( m_rotation );
+    }
+    m_pagesVector += pages;
+
+    // restore the annotations and forms saved for the new pages
+    QDomElement pendingPageList = m_pendingPageList.documentElement();
+    QDomNode pageNode = pendingPageList.firstChild();
+    while ( pageNode.isElement() )
+    {
+        const QDomElement pageElement = pageNode.toElement();
+        pageNode = pageNode.nextSibling();
+        const int pageNumber = pageElement.attribute( "number" ).toInt();
+        if ( pageNumber < m_pagesVector.count() )
+        {
+            m_pagesVector[ pageNumber ]->d->restoreLocalContents( pageElement );
+            pendingPageList.removeChild( pageElement );
+        }
+    }
+
+    // index the new pages too, keeping the pages indexed so far
+    if ( m_textIndex )
+    {
+        m_textIndex->setPageCount( m_pagesVector.count() );
+        QVector< PagePrivate * > newPages;
+        foreach ( Page *page, pages )
+            newPages.append( page->d );
+        queueTextIndexPages( newPages );
+    }
+
+    foreachObserverD( notifySetup( m_pagesVector, DocumentObserver::PagesAdded ) );
+
+    // go to the page restored when opening the document once it is there,
+    // unless the user moved away from the last page available back then
+    if ( m_restoredViewport.isValid() && m_restoredViewport.pageNumber < m_pagesVector.count() )
+    {
+        if ( (*m_viewportIterator).pageNumber == previousPageCount - 1 )
+            m_parent->setViewport( m_restoredViewport );
+        m_restoredViewport = DocumentViewport();
+    }
+}
+
+void DocumentPrivate::calculateMaxTextPagesMemory()
+{
+    // the budget is expressed in text pages of a typical size per 512 MB of RAM
+    const qulonglong textPageMemory = 64 * 1024;
+    const qulonglong multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
     switch (SettingsCore::memoryLevel())
     {
         case SettingsCore::EnumMemoryLevel::Low:
-            m_maxAllocatedTextPages = multipliers * 2;
+            m_maxAllocatedTextPagesMemory = multipliers * 2 * textPageMemory;
         break;
 
         case SettingsCore::EnumMemoryLevel::Normal:
-            m_maxAllocatedTextPages = multipliers * 50;
+            m_maxAllocatedTextPagesMemory = multipliers * 50 * textPageMemory;
         break;
 
         case SettingsCore::EnumMemoryLevel::Aggressive:
-            m_maxAllocatedTextPages = multipliers * 250;
+            m_maxAllocatedTextPagesMemory = multipliers * 250 * textPageMemory;
         break;
 
         case SettingsCore::EnumMemoryLevel::Greedy:
-            m_maxAllocatedTextPages = multipliers * 1250;
+            m_maxAllocatedTextPagesMemory = multipliers * 1250 * textPageMemory;
         break;
     }
 }
 
-void DocumentPrivate::textGenerationDone( Page *page )
+void DocumentPrivate::markTextPageUsed( int page )
 {
-    if ( !m_pageController ) return;
+    QHash< int, QLinkedList< int >::iterator >::iterator it = m_allocatedTextPagesLruIndex.find( page );
+    if ( it == m_allocatedTextPagesLruIndex.end() )
+        return;
+
+    if ( it.value() != --m_allocatedTextPagesLru.end() )
+    {
+        m_allocatedTextPagesLru.erase( it.value() );
+        it.value() = m_allocatedTextPagesLru.insert( m_allocatedTextPagesLru.end(), page );
+    }
+
+    // the first search on the text page builds its search buffers
+    updateTextPageMemory( page );
+}
 
-    // 1. If we reached the cache limit, delete the first text page from the fifo
-    if (m_allocatedTextPagesFifo.size() == m_maxAllocatedTextPages)
+void DocumentPrivate::updateTextPageMemory( int page )
+{
+    QHash< int, qulonglong >::iterator it = m_allocatedTextPagesMemory.find( page );
+    if ( it == m_allocatedTextPagesMemory.end() )
+        return;
+
+    const qulonglong memory = m_pagesVector.at( page )->d->textPageMemory();
+    if ( memory == it.value() )
+        return;
+
+    m_allocatedTextPagesTotalMemory -= it.value();
+    m_allocatedTextPagesTotalMemory += memory;
+    it.value() = memory;
+
+    cleanupTextPageMemory( page );
+}
+
+void DocumentPrivate::cleanupTextPageMemory( int pageToKeep )
+{
+    // delete the least recently used text pages until they fit in the budget
+    QLinkedList< int >::iterator it = m_allocatedTextPagesLru.begin();
+    while ( m_allocatedTextPagesTotalMemory > m_maxAllocatedTextPagesMemory && it != m_allocatedTextPagesLru.end() )
     {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        if (pageToKick != page->number()) // this should never happen but better be safe than sorry
+        const int pageToKick = *it;
+        if ( pageToKick == pageToKeep )
         {
-            m_pagesVector.at(pageToKick)->setTextPage( 0 ); // deletes the textpage
+            ++it;
+            continue;
         }
+
+        it = m_allocatedTextPagesLru.erase( it );
+        m_allocatedTextPagesLruIndex.remove( pageToKick );
+        m_allocatedTextPagesTotalMemory -= m_allocatedTextPagesMemory.take( pageToKick );
+        m_pagesVector.at( pageToKick )->setTextPage( 0 ); // deletes the textpage
     }
+}
+
+void DocumentPrivate::textGenerationDone( Page *page )
+{
+    if ( !m_pageController ) return;
+
+    const int pageNumber = page->number();
+
+    // 1. Account the text page as the most recently used one, replacing
+    //    the previous text page of the page if any
+    if ( m_allocatedTextPagesMemory.contains( pageNumber ) )
+    {
+        m_allocatedTextPagesLru.erase( m_allocatedTextPagesLruIndex.take( pageNumber ) );
+        m_allocatedTextPagesTotalMemory -= m_allocatedTextPagesMemory.take( pageNumber );
+    }
+    const qulonglong memory = page->d->textPageMemory();
+    m_allocatedTextPagesLruIndex.insert( pageNumber, m_allocatedTextPagesLru.insert( m_allocatedTextPagesLru.end(), pageNumber ) );
+    m_allocatedTextPagesMemory.insert( pageNumber, memory );
+    m_allocatedTextPagesTotalMemory += memory;
+
+    // 2. If we are over the cache budget, delete the least recently used
+    //    text pages
+    cleanupTextPageMemory( pageNumber );
 
-    // 2. Add the page to the fifo of generated text pages
-    m_allocatedTextPagesFifo.append( page->number() );
+    // 3. Keep its text in the index too
+    if ( m_textIndex && m_textIndex->addPage( page->number(), page->d->m_text ) )
+        m_textIndexChanged = true;
 }
 
 void Document::setRotation( int r )
@@ -4747,7 +5426,6 @@ void Document::setPageSize( const PageSize &size )
     for ( ; pIt != pEnd; ++pIt )
         (*pIt)->d->changeSize( size );
     // clear 'memory allocation' descriptors
-    qDeleteAll( d->m_allocatedPixmaps );
     d->m_allocatedPixmaps.clear();
     d->m_allocatedPixmapsTotalMemory = 0;
     // notify the generator that the current page size has changed
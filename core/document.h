@@ -588,7 +588,9 @@ class OKULARCORE_EXPORT Document : public QObject
             PreviousMatch,  ///< Search previous match
             AllDocument,    ///< Search complete document
             GoogleAll,      ///< Search all words in google style
-            GoogleAny       ///< Search any words in google style
+            GoogleAny,      ///< Search any words in google style
+            RegularExpression, ///< Search complete document for the matches of a regular expression @since 0.24
+            WholeWords      ///< Search complete document for the text as whole words @since 0.24
         };
 
         /**
@@ -1112,6 +1114,9 @@ class OKULARCORE_EXPORT Document : public QObject
         Q_PRIVATE_SLOT( d, void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct) )
         Q_PRIVATE_SLOT( d, void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID) )
         Q_PRIVATE_SLOT( d, void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words) )
+        Q_PRIVATE_SLOT( d, void textSearchPageDone(void *result) )
+        Q_PRIVATE_SLOT( d, void textSearchDone(int jobId) )
+        Q_PRIVATE_SLOT( d, void textIndexLoaded(int jobId) )
 };
 
 
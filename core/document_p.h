@@ -21,14 +21,17 @@
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 #include <QtCore/QPointer>
+#include <QtXml/QDomDocument>
 #include <QUrl>
 
 #include <kcomponentdata.h>
 #include <kservicetypetrader.h>
 
 // local includes
+#include "colorfilters_p.h"
 #include "fontinfo.h"
 #include "generator.h"
+#include "pixmapcache_p.h"
 
 class QUndoStack;
 class QEventLoop;
@@ -36,7 +39,6 @@ class QFile;
 class QTimer;
 class QTemporaryFile;
 
-struct AllocatedPixmap;
 struct ArchiveData;
 struct RunningSearch;
 
@@ -67,6 +69,10 @@ struct GeneratorInfo
 namespace Okular {
 
 class FontExtractionThread;
+class PagePrivate;
+class TextIndex;
+class TextSearchThread;
+struct TextSearchJob;
 
 struct DoContinueDirectionMatchSearchStruct
 {
@@ -81,10 +87,16 @@ class DocumentPrivate
     public:
         DocumentPrivate( Document *parent )
           : m_parent( parent ),
+            m_lastTextSearchJobId( 0 ),
+            m_textIndex( 0 ),
+            m_textIndexJob( 0 ),
+            m_textIndexThread( 0 ),
+            m_textIndexChanged( false ),
             m_tempFile( 0 ),
             m_docSize( -1 ),
             m_allocatedPixmapsTotalMemory( 0 ),
-            m_maxAllocatedTextPages( 0 ),
+            m_allocatedTextPagesTotalMemory( 0 ),
+            m_maxAllocatedTextPagesMemory( 0 ),
             m_warnedOutOfMemory( false ),
             m_rotation( Rotation0 ),
             m_exportCached( false ),
@@ -103,7 +115,8 @@ class DocumentPrivate
             m_annotationBeingMoved( false ),
             m_synctex_scanner( 0 )
         {
-            calculateMaxTextPages();
+            calculateMaxTextPagesMemory();
+            updatePixmapCachePolicy();
         }
 
         // private methods
@@ -114,7 +127,12 @@ class DocumentPrivate
         void cleanupPixmapMemory();
         void cleanupPixmapMemory( qulonglong memoryToFree );
         AllocatedPixmap * searchLowestPriorityPixmap( bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = 0 /* any */ );
-        void calculateMaxTextPages();
+        bool isPixmapRequestExecuting( const PixmapRequest * request ) const;
+        void calculateMaxTextPagesMemory();
+        void markTextPageUsed( int page );
+        void updateTextPageMemory( int page );
+        void cleanupTextPageMemory( int pageToKeep );
+        void updatePixmapCachePolicy();
         qulonglong getTotalMemory();
         qulonglong getFreeMemory( qulonglong *freeSwap = 0 );
         void loadDocumentInfo();
@@ -156,6 +174,7 @@ class DocumentPrivate
         void fontReadingGotFont( const Okular::FontInfo& font );
         void slotGeneratorConfigChanged( const QString& );
         void refreshPixmaps( int );
+        PixmapRequest::PixmapRequestFeatures refreshFeatures( DocumentObserver *observer ) const;
         void _o_configChanged();
         void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct);
         void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID);
@@ -163,6 +182,23 @@ class DocumentPrivate
 
         void doProcessSearchMatch( RegularAreaRect *match, RunningSearch *search, QSet< int > *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor & color );
 
+        // whole document searches in TextSearchThread's
+        void startTextSearch( int searchID, RunningSearch *search, const QStringList &words, QSet< int > *pagesToNotify );
+        void stopTextSearch( RunningSearch *search );
+        void finishTextSearch( int searchID, RunningSearch *search );
+        RunningSearch *textSearchForJob( int jobId, int *searchID ) const;
+        bool applyTextSearchMatches( int searchID, RunningSearch *search, Page *page, const QVector< QVector< RegularAreaRect * > > &matches );
+        void textSearchPageDone( void *result );
+        void textSearchDone( int jobId );
+        void textIndexLoaded( int jobId );
+
+        // the full text index, built in a TextSearchThread
+        void startTextIndex();
+        void queueTextIndexPages( const QVector< PagePrivate * > &pages );
+        void startTextIndexThread();
+        void stopTextIndex();
+        void saveTextIndex();
+
         // generators stuff
         /**
          * This method is used by the generators to signal the finish of
@@ -174,6 +210,7 @@ class DocumentPrivate
          * Sets the bounding box of the given @p page (in terms of upright orientation, i.e., Rotation0).
          */
         void setPageBoundingBox( int page, const NormalizedRect& boundingBox );
+        void appendPages( const QVector< Page * > &pages );
         /**
          * Request a particular metadata of the Document itself (ie, not something
          * depending on the document type/backend).
@@ -196,6 +233,11 @@ class DocumentPrivate
         // find descriptors, mapped by ID (we handle multiple searches)
         QMap< int, RunningSearch * > m_searches;
         bool m_searchCancelled;
+        int m_lastTextSearchJobId;
+        TextIndex *m_textIndex;
+        TextSearchJob *m_textIndexJob;
+        TextSearchThread *m_textIndexThread;
+        bool m_textIndexChanged;
 
         // needed because for remote documents docFileName is a local file and
         // we want the remote url when the document refers to relativeNames
@@ -211,6 +253,10 @@ class DocumentPrivate
         QLinkedList< DocumentViewport > m_viewportHistory;
         QLinkedList< DocumentViewport >::iterator m_viewportIterator;
         DocumentViewport m_nextDocumentViewport; // see Link::Goto for an explanation
+        // the viewport restored when opening the document, on a page not available yet
+        DocumentViewport m_restoredViewport;
+        // the <page> elements of the docdata file for pages not available yet
+        QDomDocument m_pendingPageList;
         QString m_nextDocumentDestination;
 
         // observers / requests / allocator stuff
@@ -218,10 +264,17 @@ class DocumentPrivate
         QLinkedList< PixmapRequest * > m_pixmapRequestsStack;
         QLinkedList< PixmapRequest * > m_executingPixmapRequests;
         QMutex m_pixmapRequestsMutex;
-        QLinkedList< AllocatedPixmap * > m_allocatedPixmaps;
+        PixmapCache m_allocatedPixmaps;
         qulonglong m_allocatedPixmapsTotalMemory;
-        QList< int > m_allocatedTextPagesFifo;
-        int m_maxAllocatedTextPages;
+        // the observers whose pixmaps have the accessibility colors
+        QSet< DocumentObserver * > m_accessibilityObservers;
+        ColorFilters::AccessibilityFilter m_accessibilityFilter;
+        // pages with a text page, least recently used first
+        QLinkedList< int > m_allocatedTextPagesLru;
+        QHash< int, QLinkedList< int >::iterator > m_allocatedTextPagesLruIndex;
+        QHash< int, qulonglong > m_allocatedTextPagesMemory;
+        qulonglong m_allocatedTextPagesTotalMemory;
+        qulonglong m_maxAllocatedTextPagesMemory;
         bool m_warnedOutOfMemory;
 
         // the rotation applied to the document
@@ -25,14 +25,16 @@
 #include "document_p.h"
 #include "page.h"
 #include "page_p.h"
+#include "settings_core.h"
 #include "textpage.h"
 #include "utils.h"
+#include "utils_p.h"
 
 using namespace Okular;
 
 GeneratorPrivate::GeneratorPrivate()
     : m_document( 0 ),
-      mPixmapGenerationThread( 0 ), mTextPageGenerationThread( 0 ),
+      mRunningPixmapGenerations( 0 ), mTextPageGenerationThread( 0 ),
       m_mutex( 0 ), m_threadsMutex( 0 ), mPixmapReady( true ), mTextPageReady( true ),
       m_closing( false ), m_closingLoop( 0 ),
       m_dpi(72.0, 72.0)
@@ -41,10 +43,11 @@ GeneratorPrivate::GeneratorPrivate()
 
 GeneratorPrivate::~GeneratorPrivate()
 {
-    if ( mPixmapGenerationThread )
-        mPixmapGenerationThread->wait();
-
-    delete mPixmapGenerationThread;
+    foreach ( PixmapGenerationThread *thread, mPixmapGenerationThreads )
+    {
+        thread->wait();
+        delete thread;
+    }
 
     if ( mTextPageGenerationThread )
         mTextPageGenerationThread->wait();
@@ -57,15 +60,38 @@ GeneratorPrivate::~GeneratorPrivate()
 
 PixmapGenerationThread* GeneratorPrivate::pixmapGenerationThread()
 {
-    if ( mPixmapGenerationThread )
-        return mPixmapGenerationThread;
+    // reuse an idle worker if there is one
+    foreach ( PixmapGenerationThread *thread, mPixmapGenerationThreads )
+    {
+        if ( !thread->request() )
+            return thread;
+    }
 
     Q_Q( Generator );
-    mPixmapGenerationThread = new PixmapGenerationThread( q );
-    QObject::connect( mPixmapGenerationThread, SIGNAL(finished()), q, SLOT(pixmapGenerationFinished()),
+    PixmapGenerationThread *thread = new PixmapGenerationThread( q );
+    QObject::connect( thread, SIGNAL(finished()), q, SLOT(pixmapGenerationFinished()),
                       Qt::QueuedConnection );
+    mPixmapGenerationThreads.append( thread );
+
+    return thread;
+}
+
+int GeneratorPrivate::maxPixmapGenerationThreads() const
+{
+    if ( !m_features.contains( Generator::ThreadedMultiple ) )
+        return 1;
+
+    // 0 (the default) means one worker per core
+    int threads = SettingsCore::pixmapGenerationThreads();
+    if ( threads <= 0 )
+        threads = QThread::idealThreadCount();
 
-    return mPixmapGenerationThread;
+    return qMax( 1, threads );
+}
+
+void GeneratorPrivate::updatePixmapReady()
+{
+    mPixmapReady = mRunningPixmapGenerations < maxPixmapGenerationThreads();
 }
 
 TextPageGenerationThread* GeneratorPrivate::textPageGenerationThread()
@@ -84,16 +110,22 @@ TextPageGenerationThread* GeneratorPrivate::textPageGenerationThread()
 void GeneratorPrivate::pixmapGenerationFinished()
 {
     Q_Q( Generator );
-    PixmapRequest *request = mPixmapGenerationThread->request();
-    mPixmapGenerationThread->endGeneration();
+    // with ThreadedMultiple there may be several workers, so find out which one is done
+    PixmapGenerationThread *thread = qobject_cast< PixmapGenerationThread * >( q->sender() );
+    if ( !thread )
+        return;
+
+    PixmapRequest *request = thread->request();
+    thread->endGeneration();
 
     QMutexLocker locker( threadsLock() );
-    mPixmapReady = true;
+    --mRunningPixmapGenerations;
+    updatePixmapReady();
 
     if ( m_closing )
     {
         delete request;
-        if ( mTextPageReady )
+        if ( mRunningPixmapGenerations == 0 && mTextPageReady )
         {
             locker.unlock();
             m_closingLoop->quit();
@@ -101,12 +133,12 @@ void GeneratorPrivate::pixmapGenerationFinished()
         return;
     }
 
-    const QImage& img = mPixmapGenerationThread->image();
-    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( img ) ), request->normalizedRect() );
+    QImage img = thread->takeImage();
+    request->page()->setPixmap( request->observer(), new QPixmap( pixmapFromImage( &img ) ), request->normalizedRect() );
     const int pageNumber = request->page()->number();
 
-    if ( mPixmapGenerationThread->calcBoundingBox() )
-        q->updatePageBoundingBox( pageNumber, mPixmapGenerationThread->boundingBox() );
+    if ( thread->calcBoundingBox() )
+        q->updatePageBoundingBox( pageNumber, thread->boundingBox() );
     q->signalPixmapRequestDone( request );
 }
 
@@ -122,7 +154,7 @@ void GeneratorPrivate::textpageGenerationFinished()
     if ( m_closing )
     {
         delete mTextPageGenerationThread->textPage();
-        if ( mPixmapReady )
+        if ( mRunningPixmapGenerations == 0 )
         {
             locker.unlock();
             m_closingLoop->quit();
@@ -138,6 +170,16 @@ void GeneratorPrivate::textpageGenerationFinished()
     }
 }
 
+TextPage* GeneratorPrivate::extractTextPage( Page *page )
+{
+    Q_Q( Generator );
+    if ( m_features.contains( Generator::ThreadedMultiple ) )
+        return q->textPage( page );
+
+    QMutexLocker locker( &mTextPageMutex );
+    return q->textPage( page );
+}
+
 QMutex* GeneratorPrivate::threadsLock()
 {
     if ( !m_threadsMutex )
@@ -202,7 +244,7 @@ bool Generator::closeDocument()
     d->m_closing = true;
 
     d->threadsLock()->lock();
-    if ( !( d->mPixmapReady && d->mTextPageReady ) )
+    if ( d->mRunningPixmapGenerations > 0 || !d->mTextPageReady )
     {
         QEventLoop loop;
         d->m_closingLoop = &loop;
@@ -234,12 +276,16 @@ bool Generator::canGeneratePixmap() const
 void Generator::generatePixmap( PixmapRequest *request )
 {
     Q_D( Generator );
-    d->mPixmapReady = false;
 
     const bool calcBoundingBox = !request->isTile() && !request->page()->isBoundingBoxKnown();
 
     if ( request->asynchronous() && hasFeature( Threaded ) )
     {
+        d->threadsLock()->lock();
+        ++d->mRunningPixmapGenerations;
+        d->updatePixmapReady();
+        d->threadsLock()->unlock();
+
         d->pixmapGenerationThread()->startGeneration( request, calcBoundingBox );
 
         /**
@@ -254,15 +300,20 @@ void Generator::generatePixmap( PixmapRequest *request )
         return;
     }
 
-    const QImage& img = image( request );
-    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( img ) ), request->normalizedRect() );
+    d->mPixmapReady = false;
+
+    QImage img = image( request );
+    // the image is given to the pixmap, so look at it first
+    const NormalizedRect boundingBox = calcBoundingBox ? Utils::imageBoundingBox( &img ) : NormalizedRect();
+    request->applyColors( &img );
+    request->page()->setPixmap( request->observer(), new QPixmap( pixmapFromImage( &img ) ), request->normalizedRect() );
     const int pageNumber = request->page()->number();
 
-    d->mPixmapReady = true;
+    d->updatePixmapReady();
 
     signalPixmapRequestDone( request );
     if ( calcBoundingBox )
-        updatePageBoundingBox( pageNumber, Utils::imageBoundingBox( &img ) );
+        updatePageBoundingBox( pageNumber, boundingBox );
 }
 
 bool Generator::canGenerateTextPage() const
@@ -273,7 +324,8 @@ bool Generator::canGenerateTextPage() const
 
 void Generator::generateTextPage( Page *page )
 {
-    TextPage *tp = textPage( page );
+    Q_D( Generator );
+    TextPage *tp = d->extractTextPage( page );
     page->setTextPage( tp );
     signalTextGenerationDone( page, tp );
 }
@@ -429,6 +481,12 @@ QMutex* Generator::userMutex() const
     return d->m_mutex;
 }
 
+int Generator::maxPixmapGenerationThreads() const
+{
+    Q_D( const Generator );
+    return d->maxPixmapGenerationThreads();
+}
+
 void Generator::updatePageBoundingBox( int page, const NormalizedRect & boundingBox )
 {
     Q_D( Generator );
@@ -436,6 +494,15 @@ void Generator::updatePageBoundingBox( int page, const NormalizedRect & bounding
         d->m_document->setPageBoundingBox( page, boundingBox );
 }
 
+void Generator::appendPages( const QVector< Page * > & pages )
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->appendPages( pages );
+    else
+        qDeleteAll( pages );
+}
+
 void Generator::requestFontData(const Okular::FontInfo & /*font*/, QByteArray * /*data*/)
 {
 
@@ -530,6 +597,11 @@ void PixmapRequest::setNormalizedRect( const NormalizedRect &rect )
     d->mNormalizedRect = rect;
 }
 
+void PixmapRequest::applyColors( QImage *image ) const
+{
+    d->mAccessibilityFilter.apply( image );
+}
+
 const NormalizedRect& PixmapRequest::normalizedRect() const
 {
     return d->mNormalizedRect;
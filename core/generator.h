@@ -188,6 +188,7 @@ class OKULARCORE_EXPORT Generator : public QObject
     /// @cond PRIVATE
     friend class PixmapGenerationThread;
     friend class TextPageGenerationThread;
+    friend class TextSearchThread;
     /// @endcond
 
     Q_OBJECT
@@ -207,7 +208,8 @@ class OKULARCORE_EXPORT Generator : public QObject
             PrintNative,       ///< Whether the Generator supports native cross-platform printing (QPainter-based).
             PrintPostscript,   ///< Whether the Generator supports postscript-based file printing.
             PrintToFile,       ///< Whether the Generator supports export to PDF & PS through the Print Dialog
-            TiledRendering     ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
+            TiledRendering,    ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
+            ThreadedMultiple   ///< Whether image() and textPage() can be run for several requests at the same time on different threads; requires Threaded @since 0.24
         };
 
         /**
@@ -482,7 +484,8 @@ class OKULARCORE_EXPORT Generator : public QObject
          * the passed pixmap @p request.
          *
          * @warning this method may be executed in its own separated thread if the
-         * @ref Threaded is enabled!
+         * @ref Threaded is enabled, and concurrently for different requests if
+         * @ref ThreadedMultiple is enabled!
          */
         virtual QImage image( PixmapRequest *page );
 
@@ -490,7 +493,8 @@ class OKULARCORE_EXPORT Generator : public QObject
          * Returns the text page for the given @p page.
          *
          * @warning this method may be executed in its own separated thread if the
-         * @ref Threaded is enabled!
+         * @ref Threaded is enabled, and concurrently for different pages if
+         * @ref ThreadedMultiple is enabled!
          */
         virtual TextPage* textPage( Page *page );
 
@@ -524,6 +528,24 @@ class OKULARCORE_EXPORT Generator : public QObject
          */
         void updatePageBoundingBox( int page, const NormalizedRect & boundingBox );
 
+        /**
+         * Append @p pages to the pages already handed to the Document, for
+         * generators that keep paginating their document after loading it.
+         * The Document takes ownership of the pages, and tells its observers
+         * that the pages and the synopsis of the document changed.
+         *
+         * @since 0.24
+         */
+        void appendPages( const QVector< Page * > & pages );
+
+        /**
+         * Returns how many pixmap requests image() may be asked to handle at
+         * the same time: 1 unless @ref ThreadedMultiple is enabled.
+         *
+         * @since 0.24
+         */
+        int maxPixmapGenerationThreads() const;
+
         /**
          * Returns DPI, previously set via setDPI()
          * @since 0.19 (KDE 4.13)
@@ -574,7 +596,8 @@ class OKULARCORE_EXPORT PixmapRequest
         {
             NoFeature = 0,
             Asynchronous = 1,
-            Preload = 2
+            Preload = 2,
+            Accessibility = 4   ///< The pixmap is made with the accessibility colors of the settings @since 0.24
         };
         Q_DECLARE_FLAGS( PixmapRequestFeatures, PixmapRequestFeature )
 
@@ -671,6 +694,18 @@ class OKULARCORE_EXPORT PixmapRequest
          */
         const NormalizedRect& normalizedRect() const;
 
+        /**
+         * Applies to @p image the colors the pixmap is requested with, such
+         * as the accessibility colors of the settings.
+         *
+         * Generators which make the pixmap without image() call it on the
+         * rendered image, after having looked for its bounding box. It can
+         * be called from any thread.
+         *
+         * @since 0.24
+         */
+        void applyColors( QImage *image ) const;
+
     private:
         Q_DISABLE_COPY( PixmapRequest )
 
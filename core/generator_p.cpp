@@ -11,9 +11,14 @@
 
 #include <QtCore/QDebug>
 
+#include "area.h"
 #include "fontinfo.h"
 #include "generator.h"
+#include "page_p.h"
+#include "textindex_p.h"
+#include "textpage.h"
 #include "utils.h"
+#include "utils_p.h"
 
 using namespace Okular;
 
@@ -40,9 +45,11 @@ PixmapRequest *PixmapGenerationThread::request() const
     return mRequest;
 }
 
-QImage PixmapGenerationThread::image() const
+QImage PixmapGenerationThread::takeImage()
 {
-    return mImage;
+    QImage image;
+    image.swap( mImage );
+    return image;
 }
 
 bool PixmapGenerationThread::calcBoundingBox() const
@@ -64,6 +71,10 @@ void PixmapGenerationThread::run()
         mImage = mGenerator->image( mRequest );
         if ( mCalcBoundingBox )
             mBoundingBox = Utils::imageBoundingBox( &mImage );
+        // the colors too are applied here, rather than when painting the pixmap
+        mRequest->applyColors( &mImage );
+        // convert it here rather than when creating the pixmap in the GUI thread
+        convertToPixmapFormat( &mImage );
     }
 }
 
@@ -100,7 +111,75 @@ void TextPageGenerationThread::run()
     mTextPage = 0;
 
     if ( mPage )
-        mTextPage = mGenerator->textPage( mPage );
+        mTextPage = mGenerator->d_func()->extractTextPage( mPage );
+}
+
+
+TextSearchThread::TextSearchThread( Generator *generator, TextSearchJob *job )
+    : mGenerator( generator ), mJob( job )
+{
+}
+
+void TextSearchThread::run()
+{
+    const int wordCount = mJob->words.count();
+
+    if ( mJob->index )
+    {
+        mJob->index->load( mJob->indexFileName );
+        emit indexLoaded( mJob->id );
+    }
+
+    while ( !mJob->cancelled.load() )
+    {
+        PagePrivate *page = 0;
+        {
+            QMutexLocker locker( &mJob->pagesMutex );
+            if ( mJob->nextPage < mJob->pages.count() )
+                page = mJob->pages.at( mJob->nextPage++ );
+        }
+        if ( !page )
+            break;
+
+        TextSearchResult *result = new TextSearchResult;
+        result->jobId = mJob->id;
+        result->page = page;
+        result->textPage = mGenerator->d_func()->extractTextPage( result->page->m_page );
+        result->matches.resize( wordCount );
+
+        if ( result->textPage )
+        {
+            result->page->prepareTextPage( result->textPage );
+
+            if ( !mJob->pattern.pattern().isEmpty() )
+            {
+                result->matches[ 0 ] = result->textPage->findAll( mJob->pattern );
+            }
+            else
+            {
+                for ( int w = 0; w < wordCount && !mJob->cancelled.load(); ++w )
+                {
+                    RegularAreaRect *lastMatch = 0;
+                    while ( 1 )
+                    {
+                        if ( lastMatch )
+                            lastMatch = result->textPage->findText( mJob->searchID, mJob->words.at( w ), NextResult, mJob->caseSensitivity, lastMatch );
+                        else
+                            lastMatch = result->textPage->findText( mJob->searchID, mJob->words.at( w ), FromTop, mJob->caseSensitivity, 0 );
+
+                        if ( !lastMatch )
+                            break;
+
+                        result->matches[ w ].append( lastMatch );
+                    }
+                }
+            }
+        }
+
+        emit pageSearched( result );
+    }
+
+    emit searchDone( mJob->id );
 }
 
 
@@ -11,13 +11,19 @@
 #define OKULAR_THREADEDGENERATOR_P_H
 
 #include "area.h"
+#include "colorfilters_p.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QRegularExpression>
 #include <QtCore/QSet>
+#include <QtCore/QStringList>
 #include <QtCore/QThread>
+#include <QtCore/QVector>
 #include <QtGui/QImage>
 
 class QEventLoop;
-class QMutex;
 
 namespace Okular {
 
@@ -26,11 +32,14 @@ class DocumentPrivate;
 class FontInfo;
 class Generator;
 class Page;
+class PagePrivate;
 class PixmapGenerationThread;
 class PixmapRequest;
+class TextIndex;
 class TextPage;
 class TextPageGenerationThread;
 class TilesManager;
+class RegularAreaRect;
 
 class GeneratorPrivate
 {
@@ -44,12 +53,21 @@ class GeneratorPrivate
 
         PixmapGenerationThread* pixmapGenerationThread();
         TextPageGenerationThread* textPageGenerationThread();
+        int maxPixmapGenerationThreads() const;
+        void updatePixmapReady();
 
         void pixmapGenerationFinished();
         void textpageGenerationFinished();
 
         QMutex* threadsLock();
 
+        /**
+         * Returns the text page of @p page from Generator::textPage(); calls
+         * from different threads are serialized unless the generator is
+         * ThreadedMultiple.
+         */
+        TextPage* extractTextPage( Page *page );
+
         virtual QVariant metaData( const QString &key, const QVariant &option ) const;
         virtual QImage image( PixmapRequest * );
 
@@ -57,10 +75,13 @@ class GeneratorPrivate
         // NOTE: the following should be a QSet< GeneratorFeature >,
         // but it is not to avoid #include'ing generator.h
         QSet< int > m_features;
-        PixmapGenerationThread *mPixmapGenerationThread;
+        // the pool of pixmap workers, more than one only for ThreadedMultiple
+        QVector< PixmapGenerationThread * > mPixmapGenerationThreads;
+        int mRunningPixmapGenerations;
         TextPageGenerationThread *mTextPageGenerationThread;
         mutable QMutex *m_mutex;
         QMutex *m_threadsMutex;
+        QMutex mTextPageMutex;
         bool mPixmapReady : 1;
         bool mTextPageReady : 1;
         bool m_closing : 1;
@@ -85,6 +106,9 @@ class PixmapRequestPrivate
         bool mTile : 1;
         Page *mPage;
         NormalizedRect mNormalizedRect;
+        QElapsedTimer mRenderTimer;
+        // the colors of the pixmap, read from the settings in the GUI thread
+        ColorFilters::AccessibilityFilter mAccessibilityFilter;
 };
 
 
@@ -101,7 +125,10 @@ class PixmapGenerationThread : public QThread
 
         PixmapRequest *request() const;
 
-        QImage image() const;
+        /**
+         * Returns the rendered image, which the thread no longer references.
+         */
+        QImage takeImage();
         bool calcBoundingBox() const;
         NormalizedRect boundingBox() const;
 
@@ -141,6 +168,78 @@ class TextPageGenerationThread : public QThread
         TextPage *mTextPage;
 };
 
+/**
+ * The pages of a full document text search, shared by all the
+ * TextSearchThread's working on it.
+ */
+struct TextSearchJob
+{
+    TextSearchJob() : nextPage( 0 ), index( 0 ) {}
+
+    int id;
+    int searchID;
+    QStringList words;
+    Qt::CaseSensitivity caseSensitivity;
+    // matched instead of the single word, unless its pattern is empty
+    QRegularExpression pattern;
+    QAtomicInt cancelled;
+
+    // guards pages and nextPage, as more pages can be queued on a running job
+    QMutex pagesMutex;
+    QVector< PagePrivate * > pages;
+    int nextPage;
+
+    // the text index the thread loads from indexFileName before taking the
+    // pages, if any; owned by the job until it is loaded
+    TextIndex *index;
+    QString indexFileName;
+};
+
+/**
+ * The matches of the words of a TextSearchJob on a page.
+ */
+struct TextSearchResult
+{
+    int jobId;
+    PagePrivate *page;
+    // the text page extracted for the search, not set to the page yet
+    TextPage *textPage;
+    // the matches of each word
+    QVector< QVector< RegularAreaRect * > > matches;
+};
+
+class TextSearchThread : public QThread
+{
+    Q_OBJECT
+
+    public:
+        TextSearchThread( Generator *generator, TextSearchJob *job );
+
+    Q_SIGNALS:
+        /**
+         * A page was searched; the TextSearchResult passed is owned by the receiver.
+         */
+        void pageSearched( void *result );
+
+        /**
+         * The text index of the job was loaded; the pages to index can be
+         * queued now.
+         */
+        void indexLoaded( int jobId );
+
+        /**
+         * No more pages will be searched by this thread.
+         */
+        void searchDone( int jobId );
+
+    protected:
+        virtual void run();
+
+    private:
+        Generator *mGenerator;
+        TextSearchJob *mJob;
+};
+
 class FontExtractionThread : public QThread
 {
     Q_OBJECT
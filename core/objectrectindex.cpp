@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "objectrectindex_p.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+#include "annotations.h"
+#include "page_p.h"
+
+using namespace Okular;
+
+static const double distanceConsideredEqual = 25; // 5px
+
+// grids have at most MaxSide x MaxSide cells
+static const int MaxSide = 32;
+
+// rects per cell added one by one before the grid is made finer
+static const int MaxCellRects = 4;
+
+ObjectRectIndex::ObjectRectIndex( const QLinkedList< ObjectRect * > *rects, const PagePrivate *page )
+    : m_rects( rects ), m_page( page ), m_built( false ), m_columns( 1 ), m_rows( 1 ), m_nextOrder( 0 )
+{
+}
+
+void ObjectRectIndex::invalidate()
+{
+    m_built = false;
+    m_cells.clear();
+    m_placements.clear();
+}
+
+void ObjectRectIndex::insert( const ObjectRect *rect )
+{
+    if ( !m_built )
+        return;
+
+    if ( m_placements.count() >= MaxCellRects * m_columns * m_rows && m_columns < MaxSide )
+        invalidate();
+    else
+        add( rect, m_nextOrder++ );
+}
+
+void ObjectRectIndex::remove( const ObjectRect *rect )
+{
+    if ( !m_built )
+        return;
+
+    QHash< const ObjectRect *, Placement >::iterator it = m_placements.find( rect );
+    if ( it == m_placements.end() )
+        return;
+
+    removeCells( rect, it.value().cells );
+    m_placements.erase( it );
+}
+
+void ObjectRectIndex::update( const void *object )
+{
+    if ( !m_built )
+        return;
+
+    QLinkedList< ObjectRect * >::const_iterator it = m_rects->constBegin(), end = m_rects->constEnd();
+    for ( ; it != end; ++it )
+    {
+        if ( (*it)->object() != object )
+            continue;
+
+        const Placement placement = m_placements.value( *it );
+        removeCells( *it, placement.cells );
+        add( *it, placement.order );
+    }
+}
+
+bool ObjectRectIndex::contains( double x, double y, double xScale, double yScale ) const
+{
+    if ( m_rects->isEmpty() )
+        return false;
+
+    const QVector< Entry > entries = candidates( x, y, xScale, yScale );
+    foreach ( const Entry &entry, entries )
+        if ( entry.rect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+            return true;
+
+    return false;
+}
+
+const ObjectRect *ObjectRectIndex::objectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
+{
+    const QVector< Entry > entries = candidates( x, y, xScale, yScale );
+    foreach ( const Entry &entry, entries )
+        if ( ( entry.rect->objectType() == type ) && entry.rect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+            return entry.rect;
+
+    return 0;
+}
+
+QLinkedList< const ObjectRect * > ObjectRectIndex::objectRects( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
+{
+    QLinkedList< const ObjectRect * > result;
+
+    const QVector< Entry > entries = candidates( x, y, xScale, yScale );
+    foreach ( const Entry &entry, entries )
+        if ( ( entry.rect->objectType() == type ) && entry.rect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+            result.append( entry.rect );
+
+    return result;
+}
+
+const ObjectRect *ObjectRectIndex::nearestObjectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double *distance ) const
+{
+    if ( !m_built )
+        build();
+
+    const ObjectRect *nearest = 0;
+    uint nearestOrder = 0;
+    double minDistance = std::numeric_limits<double>::max();
+
+    // Look at rings of cells ever farther from the point, until the cells
+    // out of them are too far to hold a rect nearer than the one found
+    const int centerColumn = column( x );
+    const int centerRow = row( y );
+    const int rings = qMax( qMax( centerColumn, m_columns - 1 - centerColumn ), qMax( centerRow, m_rows - 1 - centerRow ) );
+    for ( int ring = 0; ring <= rings; ++ring )
+    {
+        const int left = centerColumn - ring, right = centerColumn + ring;
+        const int top = centerRow - ring, bottom = centerRow + ring;
+        for ( int r = qMax( top, 0 ); r <= qMin( bottom, m_rows - 1 ); ++r )
+        {
+            if ( r == top || r == bottom )
+            {
+                for ( int c = qMax( left, 0 ); c <= qMin( right, m_columns - 1 ); ++c )
+                    nearestInCell( r * m_columns + c, type, x, y, xScale, yScale, &nearest, &nearestOrder, &minDistance );
+            }
+            else
+            {
+                if ( left >= 0 )
+                    nearestInCell( r * m_columns + left, type, x, y, xScale, yScale, &nearest, &nearestOrder, &minDistance );
+                if ( right < m_columns )
+                    nearestInCell( r * m_columns + right, type, x, y, xScale, yScale, &nearest, &nearestOrder, &minDistance );
+            }
+        }
+
+        // the distance in pixels from the point to the cells left
+        double reach = std::numeric_limits<double>::max();
+        if ( left > 0 )
+            reach = qMin( reach, ( x - (double)left / m_columns ) * xScale );
+        if ( right < m_columns - 1 )
+            reach = qMin( reach, ( (double)( right + 1 ) / m_columns - x ) * xScale );
+        if ( top > 0 )
+            reach = qMin( reach, ( y - (double)top / m_rows ) * yScale );
+        if ( bottom < m_rows - 1 )
+            reach = qMin( reach, ( (double)( bottom + 1 ) / m_rows - y ) * yScale );
+
+        if ( reach > 0 && minDistance < reach * reach )
+            break;
+    }
+
+    if ( distance )
+        *distance = minDistance;
+    return nearest;
+}
+
+bool ObjectRectIndex::isInFront( const Entry &first, const Entry &second )
+{
+    return first.order > second.order;
+}
+
+bool ObjectRectIndex::isSameRect( const Entry &first, const Entry &second )
+{
+    return first.rect == second.rect;
+}
+
+void ObjectRectIndex::build() const
+{
+    m_cells.clear();
+    m_placements.clear();
+
+    // about one rect per cell
+    const int side = qBound( 1, (int)sqrt( (double)m_rects->count() ), MaxSide );
+    m_columns = side;
+    m_rows = side;
+    m_cells.resize( m_columns * m_rows );
+    m_nextOrder = 0;
+    m_built = true;
+
+    QLinkedList< ObjectRect * >::const_iterator it = m_rects->constBegin(), end = m_rects->constEnd();
+    for ( ; it != end; ++it )
+        add( *it, m_nextOrder++ );
+}
+
+void ObjectRectIndex::add( const ObjectRect *rect, uint order ) const
+{
+    const NormalizedRect area = bounds( rect );
+
+    Placement placement;
+    placement.cells = QRect( QPoint( column( area.left ), row( area.top ) ), QPoint( column( area.right ), row( area.bottom ) ) );
+    placement.order = order;
+
+    Entry entry;
+    entry.rect = rect;
+    entry.order = order;
+    for ( int r = placement.cells.top(); r <= placement.cells.bottom(); ++r )
+        for ( int c = placement.cells.left(); c <= placement.cells.right(); ++c )
+            m_cells[ r * m_columns + c ].append( entry );
+
+    m_placements.insert( rect, placement );
+}
+
+void ObjectRectIndex::removeCells( const ObjectRect *rect, const QRect &cells ) const
+{
+    for ( int r = cells.top(); r <= cells.bottom(); ++r )
+    {
+        for ( int c = cells.left(); c <= cells.right(); ++c )
+        {
+            QVector< Entry > &cell = m_cells[ r * m_columns + c ];
+            for ( int i = 0; i < cell.count(); ++i )
+            {
+                if ( cell.at( i ).rect == rect )
+                {
+                    cell.remove( i );
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void ObjectRectIndex::nearestInCell( int cell, ObjectRect::ObjectType type, double x, double y, double xScale, double yScale,
+                                     const ObjectRect **nearest, uint *nearestOrder, double *minDistance ) const
+{
+    foreach ( const Entry &entry, m_cells.at( cell ) )
+    {
+        if ( entry.rect->objectType() != type )
+            continue;
+
+        // as walking the list, the first of the nearest rects wins
+        const double d = entry.rect->distanceSqr( x, y, xScale, yScale );
+        if ( d < *minDistance || ( d == *minDistance && *nearest && entry.order < *nearestOrder ) )
+        {
+            *nearest = entry.rect;
+            *nearestOrder = entry.order;
+            *minDistance = d;
+        }
+    }
+}
+
+NormalizedRect ObjectRectIndex::bounds( const ObjectRect *rect ) const
+{
+    switch ( rect->objectType() )
+    {
+        case ObjectRect::OAnnotation:
+        {
+            const Annotation *annotation = static_cast< const AnnotationObjectRect * >( rect )->annotation();
+            const NormalizedRect boundary = annotation->transformedBoundingRectangle();
+            // the strokes of lines and inks are hit up to half their width out of the boundary
+            const double margin = annotation->style().width() / ( 2 * qMin( m_page->m_width, m_page->m_height ) );
+            return NormalizedRect( qMin( boundary.left, boundary.right ) - margin, qMin( boundary.top, boundary.bottom ) - margin,
+                                   qMax( boundary.left, boundary.right ) + margin, qMax( boundary.top, boundary.bottom ) + margin );
+        }
+        case ObjectRect::SourceRef:
+        {
+            // a reference without a column or a line spans the whole page
+            const NormalizedPoint &point = static_cast< const SourceRefObjectRect * >( rect )->m_point;
+            if ( point.x == -1.0 )
+                return NormalizedRect( 0.0, point.y, 1.0, point.y );
+            else if ( point.y == -1.0 )
+                return NormalizedRect( point.x, 0.0, point.x, 1.0 );
+            return NormalizedRect( point.x, point.y, point.x, point.y );
+        }
+        default:
+        {
+            const QRectF area = rect->region().boundingRect();
+            return NormalizedRect( area.left(), area.top(), area.right(), area.bottom() );
+        }
+    }
+}
+
+int ObjectRectIndex::column( double x ) const
+{
+    // rects and points off the page belong to the cells on its border
+    return (int)qBound( 0.0, x * m_columns, m_columns - 1.0 );
+}
+
+int ObjectRectIndex::row( double y ) const
+{
+    return (int)qBound( 0.0, y * m_rows, m_rows - 1.0 );
+}
+
+QVector< ObjectRectIndex::Entry > ObjectRectIndex::candidates( double x, double y, double xScale, double yScale ) const
+{
+    if ( !m_built )
+        build();
+
+    // the cells within the hit distance of the point
+    const double tolerance = sqrt( distanceConsideredEqual );
+    const int left = column( x - tolerance / xScale ), right = column( x + tolerance / xScale );
+    const int top = row( y - tolerance / yScale ), bottom = row( y + tolerance / yScale );
+
+    QVector< Entry > result;
+    for ( int r = top; r <= bottom; ++r )
+        for ( int c = left; c <= right; ++c )
+            result += m_cells.at( r * m_columns + c );
+
+    // a rect overlapping several cells is listed in each of them
+    std::sort( result.begin(), result.end(), isInFront );
+    result.erase( std::unique( result.begin(), result.end(), isSameRect ), result.end() );
+    return result;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
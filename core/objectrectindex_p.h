@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_OBJECTRECTINDEX_P_H_
+#define _OKULAR_OBJECTRECTINDEX_P_H_
+
+#include <QtCore/QHash>
+#include <QtCore/QLinkedList>
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+
+#include "area.h"
+
+namespace Okular {
+
+class PagePrivate;
+
+/**
+ * Uniform grid over the object rects of a page, to hit-test them.
+ *
+ * Every cell of the grid lists the rects whose bounds, in normalized and
+ * rotated page coordinates, overlap it, so that a point is only tested
+ * against the rects around it. The rects keep the order they have in the
+ * list of the page, where the later ones are in the foreground.
+ *
+ * Rects added or removed one by one update the grid in place, while the
+ * grid of a changed list is built again on the next query only.
+ */
+class ObjectRectIndex
+{
+    public:
+        ObjectRectIndex( const QLinkedList< ObjectRect * > *rects, const PagePrivate *page );
+
+        /**
+         * Drops the grid, after a change of many rects of the list.
+         */
+        void invalidate();
+
+        /**
+         * Adds @p rect, which was appended to the list.
+         */
+        void insert( const ObjectRect *rect );
+
+        /**
+         * Removes @p rect, which is about to be removed from the list.
+         */
+        void remove( const ObjectRect *rect );
+
+        /**
+         * Moves the rects of @p object, whose bounds changed, to the
+         * cells they overlap now.
+         */
+        void update( const void *object );
+
+        /**
+         * Returns whether a rect is close to the point @p x, @p y for the
+         * scaling factor @p xScale and @p yScale.
+         */
+        bool contains( double x, double y, double xScale, double yScale ) const;
+
+        /**
+         * Returns the rect of the given @p type in the foreground among the
+         * ones close to the point @p x, @p y, or 0 if there is none.
+         */
+        const ObjectRect *objectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const;
+
+        /**
+         * Returns all the rects of the given @p type close to the point
+         * @p x, @p y, from the foreground to the background.
+         */
+        QLinkedList< const ObjectRect * > objectRects( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const;
+
+        /**
+         * Returns the rect of the given @p type nearest to the point @p x, @p y,
+         * and its squared distance in @p distance.
+         */
+        const ObjectRect *nearestObjectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double *distance ) const;
+
+    private:
+        struct Entry
+        {
+            const ObjectRect *rect;
+            // position in the list of the page
+            uint order;
+        };
+
+        struct Placement
+        {
+            // the cells the rect is listed in
+            QRect cells;
+            uint order;
+        };
+
+        static bool isInFront( const Entry &first, const Entry &second );
+        static bool isSameRect( const Entry &first, const Entry &second );
+
+        void build() const;
+        void add( const ObjectRect *rect, uint order ) const;
+        void removeCells( const ObjectRect *rect, const QRect &cells ) const;
+        void nearestInCell( int cell, ObjectRect::ObjectType type, double x, double y, double xScale, double yScale,
+                            const ObjectRect **nearest, uint *nearestOrder, double *minDistance ) const;
+        NormalizedRect bounds( const ObjectRect *rect ) const;
+        int column( double x ) const;
+        int row( double y ) const;
+        QVector< Entry > candidates( double x, double y, double xScale, double yScale ) const;
+
+        const QLinkedList< ObjectRect * > *m_rects;
+        const PagePrivate *m_page;
+
+        // the grid is built lazily by the queries
+        mutable bool m_built;
+        mutable int m_columns;
+        mutable int m_rows;
+        mutable uint m_nextOrder;
+        mutable QVector< QVector< Entry > > m_cells;
+        mutable QHash< const ObjectRect *, Placement > m_placements;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
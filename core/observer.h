@@ -53,7 +53,8 @@ class OKULARCORE_EXPORT DocumentObserver
          */
         enum SetupFlags {
             DocumentChanged = 1,    ///< The document is a new document.
-            NewLayoutForPages = 2   ///< All the pages have
+            NewLayoutForPages = 2,  ///< All the pages have
+            PagesAdded = 4          ///< Pages were appended to the document, and its synopsis may have changed @since 0.24
         };
 
         /**
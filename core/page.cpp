@@ -42,16 +42,12 @@
 #include "tilesmanager_p.h"
 #include "utils_p.h"
 
-#include <limits>
-
 #ifdef PAGE_PROFILE
 #include <QtCore/QTime>
 #endif
 
 using namespace Okular;
 
-static const double distanceConsideredEqual = 25; // 5px
-
 static void deleteObjectRects( QLinkedList< ObjectRect * >& rects, const QSet<ObjectRect::ObjectType>& which )
 {
     QLinkedList< ObjectRect * >::iterator it = rects.begin(), end = rects.end();
@@ -71,6 +67,7 @@ PagePrivate::PagePrivate( Page *page, uint n, double w, double h, Rotation o )
       m_rotation( Rotation0 ),
       m_text( 0 ), m_transition( 0 ), m_textSelections( 0 ),
       m_openingAction( 0 ), m_closingAction( 0 ), m_duration( -1 ),
+      m_objectRectIndex( &page->m_rects, this ),
       m_isBoundingBoxKnown( false )
 {
     // avoid Division-By-Zero problems in the program
@@ -93,12 +90,13 @@ PagePrivate::~PagePrivate()
 
 void PagePrivate::imageRotationDone( RotationJob * job )
 {
+    QImage image = job->takeImage();
+
     TilesManager *tm = tilesManager( job->observer() );
     if ( tm )
     {
-        QPixmap *pixmap = new QPixmap( QPixmap::fromImage( job->image() ) );
-        tm->setPixmap( pixmap, job->rect() );
-        delete pixmap;
+        const QPixmap pixmap = pixmapFromImage( &image );
+        tm->setPixmap( &pixmap, job->rect() );
         return;
     }
 
@@ -106,11 +104,11 @@ void PagePrivate::imageRotationDone( RotationJob * job )
     if ( it != m_pixmaps.end() )
     {
         PixmapObject &object = it.value();
-        (*object.m_pixmap) = QPixmap::fromImage( job->image() );
+        (*object.m_pixmap) = pixmapFromImage( &image );
         object.m_rotation = job->rotation();
     } else {
         PixmapObject object;
-        object.m_pixmap = new QPixmap( QPixmap::fromImage( job->image() ) );
+        object.m_pixmap = new QPixmap( pixmapFromImage( &image ) );
         object.m_rotation = job->rotation();
 
         m_pixmaps.insert( job->observer(), object );
@@ -248,15 +246,7 @@ RegularAreaRect * Page::textArea ( TextSelection * selection ) const
 
 bool Page::hasObjectRect( double x, double y, double xScale, double yScale ) const
 {
-    if ( m_rects.isEmpty() )
-        return false;
-
-    QLinkedList< ObjectRect * >::const_iterator it = m_rects.begin(), end = m_rects.end();
-    for ( ; it != end; ++it )
-        if ( (*it)->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
-            return true;
-
-    return false;
+    return d->m_objectRectIndex.contains( x, y, xScale, yScale );
 }
 
 bool Page::hasHighlights( int s_id ) const
@@ -395,6 +385,7 @@ void PagePrivate::rotateAt( Rotation orientation )
     QLinkedList< ObjectRect * >::const_iterator objectIt = m_page->m_rects.begin(), end = m_page->m_rects.end();
     for ( ; objectIt != end; ++objectIt )
         (*objectIt)->transform( matrix );
+    m_objectRectIndex.invalidate();
 
     QLinkedList< HighlightAreaRect* >::const_iterator hlIt = m_page->m_highlights.begin(), hlItEnd = m_page->m_highlights.end();
     for ( ; hlIt != hlItEnd; ++hlIt )
@@ -416,62 +407,26 @@ void PagePrivate::changeSize( const PageSize &size )
     m_height = size.height();
     if ( m_rotation % 2 )
         qSwap( m_width, m_height );
+
+    // the hit margin of annotations depends on the page size
+    m_objectRectIndex.invalidate();
 }
 
 const ObjectRect * Page::objectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
 {
-    // Walk list in reverse order so that annotations in the foreground are preferred
-    QLinkedListIterator< ObjectRect * > it( m_rects );
-    it.toBack();
-    while ( it.hasPrevious() )
-    {
-        const ObjectRect *objrect = it.previous();
-        if ( ( objrect->objectType() == type ) && objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
-            return objrect;
-    }
-
-    return 0;
+    // annotations in the foreground are preferred
+    return d->m_objectRectIndex.objectRect( type, x, y, xScale, yScale );
 }
 
 QLinkedList< const ObjectRect * > Page::objectRects( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
 {
-    QLinkedList< const ObjectRect * > result;
-
-    QLinkedListIterator< ObjectRect * > it( m_rects );
-    it.toBack();
-    while ( it.hasPrevious() )
-    {
-        const ObjectRect *objrect = it.previous();
-        if ( ( objrect->objectType() == type ) && objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
-            result.append( objrect );
-    }
-
-    return result;
+    return d->m_objectRectIndex.objectRects( type, x, y, xScale, yScale );
 }
 
 
 const ObjectRect* Page::nearestObjectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double * distance ) const
 {
-    ObjectRect * res = 0;
-    double minDistance = std::numeric_limits<double>::max();
-
-    QLinkedList< ObjectRect * >::const_iterator it = m_rects.constBegin(), end = m_rects.constEnd();
-    for ( ; it != end; ++it )
-    {
-        if ( (*it)->objectType() == type )
-        {
-            double d = (*it)->distanceSqr( x, y, xScale, yScale );
-            if ( d < minDistance )
-            {
-                res = (*it);
-                minDistance = d;
-            }
-        }
-    }
-
-    if ( distance )
-        *distance = minDistance;
-    return res;
+    return d->m_objectRectIndex.nearestObjectRect( type, x, y, xScale, yScale, distance );
 }
 
 const PageTransition * Page::transition() const
@@ -541,14 +496,9 @@ void Page::setTextPage( TextPage * textPage )
     delete d->m_text;
 
     d->m_text = textPage;
-    if ( d->m_text )
-    {
-        d->m_text->d->m_page = d;
-        /**
-         * Correct text order for before text selection
-         */
-        d->m_text->d->correctTextOrder();
-    }
+    // text pages from prepareTextPage() are already in order
+    if ( d->m_text && d->m_text->d->m_page != d )
+        d->prepareTextPage( d->m_text );
 }
 
 void Page::setObjectRects( const QLinkedList< ObjectRect * > & rects )
@@ -567,6 +517,7 @@ void Page::setObjectRects( const QLinkedList< ObjectRect * > & rects )
         (*objectIt)->transform( matrix );
 
     m_rects << rects;
+    d->m_objectRectIndex.invalidate();
 }
 
 void PagePrivate::setHighlight( int s_id, RegularAreaRect *rect, const QColor & color )
@@ -596,6 +547,7 @@ void Page::setSourceReferences( const QLinkedList< SourceRefObjectRect * > & ref
     deleteSourceReferences();
     foreach( SourceRefObjectRect * rect, refRects )
         m_rects << rect;
+    d->m_objectRectIndex.invalidate();
 }
 
 void Page::setDuration( double seconds )
@@ -646,6 +598,7 @@ void Page::addAnnotation( Annotation * annotation )
     annotation->d_ptr->annotationTransform( matrix );
 
     m_rects.append( rect );
+    d->m_objectRectIndex.insert( rect );
 }
 
 bool Page::removeAnnotation( Annotation * annotation )
@@ -663,6 +616,7 @@ bool Page::removeAnnotation( Annotation * annotation )
             for ( ; it != end && !rectfound; ++it )
                 if ( ( (*it)->objectType() == ObjectRect::OAnnotation ) && ( (*it)->object() == (*aIt) ) )
                 {
+                    d->m_objectRectIndex.remove( *it );
                     delete *it;
                     it = m_rects.erase( it );
                     rectfound = true;
@@ -744,6 +698,7 @@ void Page::deleteRects()
     QSet<ObjectRect::ObjectType> which;
     which << ObjectRect::Action << ObjectRect::Image;
     deleteObjectRects( m_rects, which );
+    d->m_objectRectIndex.invalidate();
 }
 
 void PagePrivate::deleteHighlights( int s_id )
@@ -772,12 +727,14 @@ void PagePrivate::deleteTextSelections()
 void Page::deleteSourceReferences()
 {
     deleteObjectRects( m_rects, QSet<ObjectRect::ObjectType>() << ObjectRect::SourceRef );
+    d->m_objectRectIndex.invalidate();
 }
 
 void Page::deleteAnnotations()
 {
     // delete ObjectRects of type Annotation
     deleteObjectRects( m_rects, QSet<ObjectRect::ObjectType>() << ObjectRect::OAnnotation );
+    d->m_objectRectIndex.invalidate();
     // delete all stored annotations
     QLinkedList< Annotation * >::const_iterator aIt = m_annotations.begin(), aEnd = m_annotations.end();
     for ( ; aIt != aEnd; ++aIt )
@@ -1016,3 +973,17 @@ void PagePrivate::setTilesManager( const DocumentObserver *observer, TilesManage
 
     m_tilesManagers.insert(observer, tm);
 }
+
+void PagePrivate::prepareTextPage( TextPage *textPage )
+{
+    textPage->d->m_page = this;
+    /**
+     * Correct text order for before text selection
+     */
+    textPage->d->correctTextOrder();
+}
+
+qulonglong PagePrivate::textPageMemory() const
+{
+    return m_text ? m_text->d->memoryUsage() : 0;
+}
@@ -21,6 +21,7 @@
 // local includes
 #include "global.h"
 #include "area.h"
+#include "objectrectindex_p.h"
 
 class QColor;
 
@@ -114,6 +115,17 @@ class PagePrivate
          */
         void setTilesManager( const DocumentObserver *observer, TilesManager *tm );
 
+        /**
+         * Gets @p textPage ready to be searched before being set to the page,
+         * possibly in a thread other than the page one.
+         */
+        void prepareTextPage( TextPage *textPage );
+
+        /**
+         * Returns the memory used by the text page, or 0 if there is none.
+         */
+        qulonglong textPageMemory() const;
+
         class PixmapObject
         {
             public:
@@ -139,6 +151,7 @@ class PagePrivate
         Action * m_closingAction;
         double m_duration;
         QString m_label;
+        ObjectRectIndex m_objectRectIndex;
 
         bool m_isBoundingBoxKnown : 1;
         QDomDocument restoredLocalAnnotationList; // <annotationList>...</annotationList>
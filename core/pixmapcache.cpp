@@ -0,0 +1,394 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "pixmapcache_p.h"
+
+#include "observer.h"
+
+using namespace Okular;
+
+namespace {
+
+/**
+ * Evicts the pixmaps farthest from the viewport first.
+ *
+ * Pixmaps are kept in a page ordered map per observer: the farthest page is
+ * always at one of the two ends of the map.
+ */
+class DistancePixmapCachePolicy : public PixmapCachePolicy
+{
+    public:
+        void inserted( AllocatedPixmap *pixmap )
+        {
+            m_pixmaps[ pixmap->observer ].insert( pixmap->page, pixmap );
+        }
+
+        void removed( AllocatedPixmap *pixmap )
+        {
+            QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::iterator oIt = m_pixmaps.find( pixmap->observer );
+            if ( oIt == m_pixmaps.end() )
+                return;
+
+            oIt.value().remove( pixmap->page );
+            if ( oIt.value().isEmpty() )
+                m_pixmaps.erase( oIt );
+        }
+
+        void used( AllocatedPixmap * )
+        {
+        }
+
+        AllocatedPixmap *lowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer ) const
+        {
+            if ( observer )
+            {
+                QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constFind( observer );
+                if ( oIt == m_pixmaps.constEnd() )
+                    return 0;
+                return farthest( oIt.value(), viewportPage, unloadableOnly );
+            }
+
+            // the farthest pixmap among the farthest pixmaps of each observer
+            AllocatedPixmap *farthestPixmap = 0;
+            int maxDistance = -1;
+            QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constBegin(), oEnd = m_pixmaps.constEnd();
+            for ( ; oIt != oEnd; ++oIt )
+            {
+                AllocatedPixmap *p = farthest( oIt.value(), viewportPage, unloadableOnly );
+                if ( p && qAbs( p->page - viewportPage ) > maxDistance )
+                {
+                    maxDistance = qAbs( p->page - viewportPage );
+                    farthestPixmap = p;
+                }
+            }
+            return farthestPixmap;
+        }
+
+    private:
+        static AllocatedPixmap *farthest( const QMap< int, AllocatedPixmap * > &pixmaps, int viewportPage, bool unloadableOnly )
+        {
+            if ( pixmaps.isEmpty() )
+                return 0;
+
+            // walk inwards from both ends of the map: the first acceptable
+            // pixmap found this way is the farthest one. Pixmaps that can't
+            // be unloaded are the visible ones, so very few are skipped.
+            QMap< int, AllocatedPixmap * >::const_iterator low = pixmaps.constBegin();
+            QMap< int, AllocatedPixmap * >::const_iterator high = pixmaps.constEnd();
+            --high;
+            while ( true )
+            {
+                const bool lowIsFarther = qAbs( low.key() - viewportPage ) >= qAbs( high.key() - viewportPage );
+                AllocatedPixmap *p = lowIsFarther ? low.value() : high.value();
+                if ( !unloadableOnly || p->observer->canUnloadPixmap( p->page ) )
+                    return p;
+
+                if ( low == high )
+                    return 0;
+
+                if ( lowIsFarther )
+                    ++low;
+                else
+                    --high;
+            }
+        }
+
+        QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > > m_pixmaps;
+};
+
+/**
+ * Base for the policies that evict the pixmaps with the lowest key first,
+ * where the key only changes when a pixmap is used.
+ */
+template < typename Key >
+class KeyOrderedPixmapCachePolicy : public PixmapCachePolicy
+{
+    public:
+        void inserted( AllocatedPixmap *pixmap )
+        {
+            m_pixmaps[ pixmap->observer ].insert( key( pixmap ), pixmap );
+        }
+
+        void removed( AllocatedPixmap *pixmap )
+        {
+            typename QHash< DocumentObserver *, QMultiMap< Key, AllocatedPixmap * > >::iterator oIt = m_pixmaps.find( pixmap->observer );
+            if ( oIt == m_pixmaps.end() )
+                return;
+
+            oIt.value().remove( key( pixmap ), pixmap );
+            if ( oIt.value().isEmpty() )
+                m_pixmaps.erase( oIt );
+        }
+
+        void used( AllocatedPixmap *pixmap )
+        {
+            removed( pixmap );
+            updateKey( pixmap );
+            inserted( pixmap );
+        }
+
+        AllocatedPixmap *lowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer ) const
+        {
+            Q_UNUSED( viewportPage )
+
+            if ( observer )
+            {
+                typename QHash< DocumentObserver *, QMultiMap< Key, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constFind( observer );
+                if ( oIt == m_pixmaps.constEnd() )
+                    return 0;
+                return first( oIt.value(), unloadableOnly );
+            }
+
+            AllocatedPixmap *lowestPixmap = 0;
+            typename QHash< DocumentObserver *, QMultiMap< Key, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constBegin(), oEnd = m_pixmaps.constEnd();
+            for ( ; oIt != oEnd; ++oIt )
+            {
+                AllocatedPixmap *p = first( oIt.value(), unloadableOnly );
+                if ( p && ( !lowestPixmap || key( p ) < key( lowestPixmap ) ) )
+                    lowestPixmap = p;
+            }
+            return lowestPixmap;
+        }
+
+    protected:
+        virtual Key key( const AllocatedPixmap *pixmap ) const = 0;
+        virtual void updateKey( AllocatedPixmap *pixmap ) = 0;
+
+    private:
+        static AllocatedPixmap *first( const QMultiMap< Key, AllocatedPixmap * > &pixmaps, bool unloadableOnly )
+        {
+            typename QMultiMap< Key, AllocatedPixmap * >::const_iterator it = pixmaps.constBegin(), end = pixmaps.constEnd();
+            for ( ; it != end; ++it )
+            {
+                AllocatedPixmap *p = it.value();
+                if ( !unloadableOnly || p->observer->canUnloadPixmap( p->page ) )
+                    return p;
+            }
+            return 0;
+        }
+
+        QHash< DocumentObserver *, QMultiMap< Key, AllocatedPixmap * > > m_pixmaps;
+};
+
+/**
+ * Evicts the pixmaps that were rendered or requested least recently first.
+ */
+class LeastRecentlyUsedPixmapCachePolicy : public KeyOrderedPixmapCachePolicy< qulonglong >
+{
+    public:
+        LeastRecentlyUsedPixmapCachePolicy()
+            : m_clock( 0 )
+        {
+        }
+
+    protected:
+        qulonglong key( const AllocatedPixmap *pixmap ) const
+        {
+            return pixmap->lastUse;
+        }
+
+        void updateKey( AllocatedPixmap *pixmap )
+        {
+            pixmap->lastUse = ++m_clock;
+        }
+
+    private:
+        qulonglong m_clock;
+};
+
+/**
+ * GreedyDual-Size: every pixmap gets a credit of its render time per byte on
+ * top of an inflation value, which is raised to the credit of each evicted
+ * pixmap. Cheap pixmaps go first, expensive ones stay until they have not
+ * been used for long enough.
+ */
+class CostAwarePixmapCachePolicy : public KeyOrderedPixmapCachePolicy< double >
+{
+    public:
+        CostAwarePixmapCachePolicy()
+            : m_inflation( 0 )
+        {
+        }
+
+        void evicted( AllocatedPixmap *pixmap )
+        {
+            m_inflation = qMax( m_inflation, pixmap->credit );
+        }
+
+    protected:
+        double key( const AllocatedPixmap *pixmap ) const
+        {
+            return pixmap->credit;
+        }
+
+        void updateKey( AllocatedPixmap *pixmap )
+        {
+            // milliseconds of rendering per MiB of memory
+            const double cost = pixmap->renderTime * 1048576.0 / qMax( pixmap->memory, Q_UINT64_C(1) );
+            pixmap->credit = m_inflation + cost;
+        }
+
+    private:
+        double m_inflation;
+};
+
+PixmapCachePolicy *createPolicy( PixmapCache::Policy policy )
+{
+    switch ( policy )
+    {
+        case PixmapCache::LeastRecentlyUsedPolicy:
+            return new LeastRecentlyUsedPixmapCachePolicy();
+        case PixmapCache::CostAwarePolicy:
+            return new CostAwarePixmapCachePolicy();
+        case PixmapCache::DistancePolicy:
+            break;
+    }
+    return new DistancePixmapCachePolicy();
+}
+
+}
+
+PixmapCache::PixmapCache()
+    : m_count( 0 ), m_policyType( DistancePolicy ), m_policy( createPolicy( DistancePolicy ) )
+{
+}
+
+PixmapCache::~PixmapCache()
+{
+    clear();
+    delete m_policy;
+}
+
+void PixmapCache::setPolicy( Policy policy )
+{
+    if ( policy == m_policyType )
+        return;
+
+    delete m_policy;
+    m_policyType = policy;
+    m_policy = createPolicy( policy );
+
+    QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constBegin(), oEnd = m_pixmaps.constEnd();
+    for ( ; oIt != oEnd; ++oIt )
+    {
+        foreach ( AllocatedPixmap *p, oIt.value() )
+            m_policy->inserted( p );
+    }
+}
+
+PixmapCache::Policy PixmapCache::policy() const
+{
+    return m_policyType;
+}
+
+void PixmapCache::insert( AllocatedPixmap *pixmap )
+{
+    QMap< int, AllocatedPixmap * > &pixmaps = m_pixmaps[ pixmap->observer ];
+    QMap< int, AllocatedPixmap * >::iterator it = pixmaps.find( pixmap->page );
+    if ( it != pixmaps.end() )
+    {
+        m_policy->removed( it.value() );
+        delete it.value();
+        it.value() = pixmap;
+    }
+    else
+    {
+        pixmaps.insert( pixmap->page, pixmap );
+        ++m_count;
+    }
+    m_policy->inserted( pixmap );
+}
+
+void PixmapCache::markUsed( DocumentObserver *observer, int page )
+{
+    QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constFind( observer );
+    if ( oIt == m_pixmaps.constEnd() )
+        return;
+
+    AllocatedPixmap *pixmap = oIt.value().value( page );
+    if ( pixmap )
+        m_policy->used( pixmap );
+}
+
+AllocatedPixmap *PixmapCache::take( DocumentObserver *observer, int page )
+{
+    QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::iterator oIt = m_pixmaps.find( observer );
+    if ( oIt == m_pixmaps.end() )
+        return 0;
+
+    AllocatedPixmap *pixmap = oIt.value().take( page );
+    if ( !pixmap )
+        return 0;
+
+    m_policy->removed( pixmap );
+    --m_count;
+    if ( oIt.value().isEmpty() )
+        m_pixmaps.erase( oIt );
+    return pixmap;
+}
+
+AllocatedPixmap *PixmapCache::lowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer ) const
+{
+    return m_policy->lowestPriority( viewportPage, unloadableOnly, observer );
+}
+
+AllocatedPixmap *PixmapCache::takeLowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer )
+{
+    AllocatedPixmap *pixmap = m_policy->lowestPriority( viewportPage, unloadableOnly, observer );
+    if ( !pixmap )
+        return 0;
+
+    m_policy->evicted( pixmap );
+    return take( pixmap->observer, pixmap->page );
+}
+
+void PixmapCache::markEvicted( AllocatedPixmap *pixmap )
+{
+    m_policy->evicted( pixmap );
+}
+
+void PixmapCache::removeObserver( DocumentObserver *observer )
+{
+    QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::iterator oIt = m_pixmaps.find( observer );
+    if ( oIt == m_pixmaps.end() )
+        return;
+
+    foreach ( AllocatedPixmap *p, oIt.value() )
+    {
+        m_policy->removed( p );
+        delete p;
+    }
+    m_count -= oIt.value().count();
+    m_pixmaps.erase( oIt );
+}
+
+void PixmapCache::clear()
+{
+    QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::const_iterator oIt = m_pixmaps.constBegin(), oEnd = m_pixmaps.constEnd();
+    for ( ; oIt != oEnd; ++oIt )
+        qDeleteAll( oIt.value() );
+    m_pixmaps.clear();
+    m_count = 0;
+
+    // start over with a fresh policy
+    delete m_policy;
+    m_policy = createPolicy( m_policyType );
+}
+
+bool PixmapCache::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int PixmapCache::count() const
+{
+    return m_count;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
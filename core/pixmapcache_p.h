@@ -0,0 +1,181 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_PIXMAPCACHE_P_H_
+#define _OKULAR_PIXMAPCACHE_P_H_
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+
+#include "okularcore_export.h"
+
+namespace Okular {
+class DocumentObserver;
+}
+
+/**
+ * Memory allocation descriptor of the pixmap (or tiles) of a page,
+ * for one observer.
+ */
+struct AllocatedPixmap
+{
+    // owner of the page
+    Okular::DocumentObserver *observer;
+    int page;
+    qulonglong memory;
+    // milliseconds it took to render the pixmap (or its tiles)
+    qint64 renderTime;
+    // eviction policy bookkeeping, see PixmapCachePolicy
+    qulonglong lastUse;
+    double credit;
+    // public constructor: initialize data
+    AllocatedPixmap( Okular::DocumentObserver *o, int p, qulonglong m ) : observer( o ), page( p ), memory( m ), renderTime( 0 ), lastUse( 0 ), credit( 0 ) {}
+};
+
+namespace Okular {
+
+/**
+ * Strategy deciding which allocated pixmap is evicted first.
+ *
+ * A policy indexes the pixmaps of the cache in the order it wants them to be
+ * evicted, and is told whenever a pixmap is added, removed, used again or
+ * evicted.
+ */
+class PixmapCachePolicy
+{
+    public:
+        virtual ~PixmapCachePolicy() {}
+
+        /**
+         * @p pixmap was added to the cache, possibly again after having been
+         * taken out of it: the policy data already stored in it is kept.
+         */
+        virtual void inserted( AllocatedPixmap *pixmap ) = 0;
+
+        /**
+         * @p pixmap is going to be removed from the cache.
+         */
+        virtual void removed( AllocatedPixmap *pixmap ) = 0;
+
+        /**
+         * @p pixmap, which is in the cache, was just rendered or requested again.
+         */
+        virtual void used( AllocatedPixmap *pixmap ) = 0;
+
+        /**
+         * @p pixmap, which is in the cache, is being evicted.
+         */
+        virtual void evicted( AllocatedPixmap *pixmap ) { Q_UNUSED( pixmap ) }
+
+        /**
+         * Returns the pixmap that should be evicted first, considering only
+         * the pixmaps the observer can unload if @p unloadableOnly is set and
+         * only the pixmaps of @p observer if it is not 0.
+         */
+        virtual AllocatedPixmap *lowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer ) const = 0;
+};
+
+/**
+ * Index of the allocated pixmaps of a document.
+ *
+ * Descriptors are looked up by (observer, page) in logarithmic time, and the
+ * eviction order is kept by a PixmapCachePolicy, which for all the available
+ * policies finds the next pixmap to evict in logarithmic time too.
+ *
+ * The cache owns the descriptors it contains.
+ */
+class OKULARCORE_EXPORT PixmapCache
+{
+    public:
+        enum Policy
+        {
+            DistancePolicy,           ///< Evict the pages farthest from the viewport first
+            LeastRecentlyUsedPolicy,  ///< Evict the pages used least recently first
+            CostAwarePolicy           ///< Keep the pages that were slow to render per byte they use (GreedyDual-Size)
+        };
+
+        PixmapCache();
+        ~PixmapCache();
+
+        /**
+         * Changes the eviction policy; the pixmaps already in the cache are kept.
+         */
+        void setPolicy( Policy policy );
+
+        /**
+         * Returns the eviction policy.
+         */
+        Policy policy() const;
+
+        /**
+         * Adds @p pixmap to the cache, replacing (and deleting) any previous
+         * descriptor for the same observer and page.
+         */
+        void insert( AllocatedPixmap *pixmap );
+
+        /**
+         * Tells the eviction policy that the pixmap of @p page of @p observer
+         * was just rendered or requested again.
+         */
+        void markUsed( DocumentObserver *observer, int page );
+
+        /**
+         * Removes the descriptor for @p page of @p observer and returns it,
+         * or returns 0 if there is none.
+         */
+        AllocatedPixmap *take( DocumentObserver *observer, int page );
+
+        /**
+         * Returns the pixmap that should be evicted first, or 0 if
+         * no suitable pixmap is found. If @p unloadableOnly is set, only
+         * pixmaps whose observer can unload them are considered. If
+         * @p observer is not 0 only its pixmaps are considered.
+         */
+        AllocatedPixmap *lowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer ) const;
+
+        /**
+         * Like lowestPriority(), but also removes the returned pixmap from the
+         * cache, as it is being evicted.
+         */
+        AllocatedPixmap *takeLowestPriority( int viewportPage, bool unloadableOnly, DocumentObserver *observer );
+
+        /**
+         * Tells the eviction policy that @p pixmap, which was taken out of the
+         * cache with take(), was evicted.
+         */
+        void markEvicted( AllocatedPixmap *pixmap );
+
+        /**
+         * Removes and deletes all the descriptors of @p observer.
+         */
+        void removeObserver( DocumentObserver *observer );
+
+        /**
+         * Removes and deletes all the descriptors.
+         */
+        void clear();
+
+        bool isEmpty() const;
+        int count() const;
+
+    private:
+        QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > > m_pixmaps;
+        int m_count;
+        Policy m_policyType;
+        PixmapCachePolicy *m_policy;
+
+        Q_DISABLE_COPY( PixmapCache )
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
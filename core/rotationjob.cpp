@@ -11,6 +11,8 @@
 
 #include <QtGui/QTransform>
 
+#include "utils_p.h"
+
 using namespace Okular;
 
 RotationJob::RotationJob( const QImage &image, Rotation oldRotation, Rotation newRotation, DocumentObserver *observer )
@@ -92,6 +94,13 @@ QImage RotationJobInternal::image() const
     return mRotatedImage;
 }
 
+QImage RotationJobInternal::takeImage()
+{
+    QImage image;
+    image.swap( mRotatedImage );
+    return image;
+}
+
 Rotation RotationJobInternal::rotation() const
 {
     return mNewRotation;
@@ -100,13 +109,16 @@ Rotation RotationJobInternal::rotation() const
 void RotationJobInternal::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread)
 {
     if ( mOldRotation == mNewRotation ) {
-        mRotatedImage = mImage;
-        return;
-    }
+        // hand the image over, so that converting it does not copy it
+        mRotatedImage.swap( mImage );
+    } else {
+        const QTransform matrix = RotationJob::rotationMatrix( mOldRotation, mNewRotation );
 
-    const QTransform matrix = RotationJob::rotationMatrix( mOldRotation, mNewRotation );
+        mRotatedImage = mImage.transformed( matrix );
+    }
 
-    mRotatedImage = mImage.transformed( matrix );
+    // convert it here rather than when creating the pixmap in the GUI thread
+    convertToPixmapFormat( &mRotatedImage );
 }
 
 #include "moc_rotationjob_p.cpp"
@@ -30,6 +30,7 @@ class RotationJobInternal : public ThreadWeaver::Job
 
     public:
         QImage image() const;
+        QImage takeImage();
         Rotation rotation() const;
         NormalizedRect rect() const;
 
@@ -39,7 +40,7 @@ class RotationJobInternal : public ThreadWeaver::Job
     private:
         RotationJobInternal( const QImage &image, Rotation oldRotation, Rotation newRotation );
 
-        const QImage mImage;
+        QImage mImage;
         Rotation mOldRotation;
         Rotation mNewRotation;
         QImage mRotatedImage;
@@ -55,6 +56,7 @@ class RotationJob : public ThreadWeaver::QObjectDecorator
         void setRect( const NormalizedRect &rect );
 
         QImage image() const { return static_cast<const RotationJobInternal*>(job())->image(); }
+        QImage takeImage() { return static_cast<RotationJobInternal*>(job())->takeImage(); }
         Rotation rotation() const { return static_cast<const RotationJobInternal*>(job())->rotation(); }
         DocumentObserver *observer() const;
         PagePrivate * page() const;
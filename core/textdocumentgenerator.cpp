@@ -10,14 +10,18 @@
 #include "textdocumentgenerator.h"
 #include "textdocumentgenerator_p.h"
 
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
 #include <QtCore/QStack>
 #include <QtCore/QTextStream>
+#include <QtCore/QTimer>
 #include <QtCore/QVector>
 #include <QtGui/QFontDatabase>
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
+#include <QtGui/QTextLayout>
 #include <QtPrintSupport/QPrinter>
 #if QT_VERSION >= 0x040500
 #include <QtGui/QTextDocumentWriter>
@@ -32,6 +36,15 @@
 
 using namespace Okular;
 
+// how many characters are laid out at a time when paginating
+static const int PaginationStepSize = 16 * 1024;
+// how long (in ms) the pagination runs before going back to the event loop
+static const int PaginationStepTime = 50;
+// how often (in ms) the newly paginated pages are handed to the document at
+// first; the interval doubles after each time, up to the maximum
+static const int PaginationAppendInterval = 1000;
+static const int MaxPaginationAppendInterval = 8000;
+
 /**
  * Generic Converter Implementation
  */
@@ -95,23 +108,48 @@ Okular::TextPage* TextDocumentGeneratorPrivate::createTextPage( int pageNumber )
 #endif
     TextDocumentUtils::calculatePositions( mDocument, pageNumber, start, end );
 
-    {
-    QTextCursor cursor( mDocument );
-    for ( int i = start; i < end - 1; ++i ) {
-        cursor.setPosition( i );
-        cursor.setPosition( i + 1, QTextCursor::KeepAnchor );
-
-        QString text = cursor.selectedText();
-        if ( text.length() == 1 ) {
-            QRectF rect;
-            TextDocumentUtils::calculateBoundingRect( mDocument, i, i + 1, rect, pageNumber );
-            if ( pageNumber == -1 )
-                text = "\n";
-
-            textPage->append( text, new Okular::NormalizedRect( rect.left(), rect.top(), rect.right(), rect.bottom() ) );
+    // walk the lines of the blocks of the page once, adding a text entity
+    // for each of their words
+    const QSizeF pageSize = mDocument->pageSize();
+    const QAbstractTextDocumentLayout *documentLayout = mDocument->documentLayout();
+    for ( QTextBlock block = mDocument->findBlock( start ); block.isValid() && block.position() < end; block = block.next() ) {
+        const QTextLayout *layout = block.layout();
+        if ( !layout )
+            continue;
+
+        const QRectF blockRect = documentLayout->blockBoundingRect( block );
+        const QString blockText = block.text();
+        for ( int l = 0; l < layout->lineCount(); ++l ) {
+            const QTextLine line = layout->lineAt( l );
+            const double y = blockRect.y() + line.y();
+            if ( qRound( y ) / qRound( pageSize.height() ) != pageNumber )
+                continue;
+
+            const double top = ( qRound( y ) % qRound( pageSize.height() ) ) / pageSize.height();
+            const double bottom = top + line.height() / pageSize.height();
+            const int lineEnd = qMin( line.textStart() + line.textLength(), blockText.length() );
+            int pos = line.textStart();
+            while ( pos < lineEnd ) {
+                // the word, and the spaces after it
+                const int wordStart = pos;
+                while ( pos < lineEnd && !blockText.at( pos ).isSpace() )
+                    ++pos;
+                const int wordEnd = pos;
+                while ( pos < lineEnd && blockText.at( pos ).isSpace() )
+                    ++pos;
+                if ( wordStart == wordEnd )
+                    continue;
+
+                const double x1 = blockRect.x() + line.cursorToX( wordStart );
+                const double x2 = blockRect.x() + line.cursorToX( wordEnd );
+                QString text = blockText.mid( wordStart, wordEnd - wordStart );
+                text += pos < lineEnd ? QLatin1Char( ' ' ) : QLatin1Char( '\n' );
+
+                textPage->append( text, new Okular::NormalizedRect( qMin( x1, x2 ) / pageSize.width(), top,
+                                                                    qMax( x1, x2 ) / pageSize.width(), bottom ) );
+            }
         }
     }
-    }
 #ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->unlock();
 #endif
@@ -167,38 +205,127 @@ void TextDocumentGeneratorPrivate::addMetaData( DocumentInfo::Key key, const QSt
     mDocumentInfo.set( key, value );
 }
 
-void TextDocumentGeneratorPrivate::generateLinkInfos()
+bool TextDocumentGeneratorPrivate::paginate( QVector<Okular::Page*> *pages )
 {
-    for ( int i = 0; i < mLinkPositions.count(); ++i ) {
-        const LinkPosition &linkPosition = mLinkPositions[ i ];
+    // lay out the document up to the next PaginationStepSize characters
+    int length = 0;
+    while ( mPaginationBlock.isValid() && length < PaginationStepSize ) {
+        length += mPaginationBlock.length();
+        mPaginationBlock = mPaginationBlock.next();
+    }
+
+    int pageCount, laidOutPosition;
+    if ( mPaginationBlock.isValid() ) {
+        // laying out a block does not move the ones before it, so the pages
+        // before the one of the next block are final
+        const QRectF rect = mDocument->documentLayout()->blockBoundingRect( mPaginationBlock );
+        pageCount = qMax( mPageCount, qRound( rect.y() ) / qRound( mDocument->pageSize().height() ) );
+        laidOutPosition = mPaginationBlock.position();
+    } else {
+        pageCount = qMax( mPageCount, mDocument->pageCount() );
+        laidOutPosition = mDocument->characterCount();
+    }
+
+    if ( pageCount == mPageCount )
+        return !mPaginationBlock.isValid();
+
+    // the links and annotations of the new pages
+    QHash< int, QLinkedList<Okular::ObjectRect*> > objects;
+    QList<LinkPosition>::iterator linkIt = mLinkPositions.begin();
+    while ( linkIt != mLinkPositions.end() ) {
+        if ( linkIt->endPosition >= laidOutPosition ) {
+            ++linkIt;
+            continue;
+        }
+
+        QRectF rect;
+        int page;
+        TextDocumentUtils::calculateBoundingRect( mDocument, linkIt->startPosition, linkIt->endPosition, rect, page );
+
+        // on a page not laid out completely yet
+        if ( page >= pageCount ) {
+            ++linkIt;
+            continue;
+        }
+        if ( page >= mPageCount )
+            objects[ page ].append( new Okular::ObjectRect( rect.left(), rect.top(), rect.right(), rect.bottom(), false,
+                                                            Okular::ObjectRect::Action, linkIt->link ) );
+        linkIt = mLinkPositions.erase( linkIt );
+    }
+
+    QHash< int, QLinkedList<Okular::Annotation*> > annots;
+    QList<AnnotationPosition>::iterator annIt = mAnnotationPositions.begin();
+    while ( annIt != mAnnotationPositions.end() ) {
+        if ( annIt->endPosition >= laidOutPosition ) {
+            ++annIt;
+            continue;
+        }
 
-        LinkInfo info;
-        info.link = linkPosition.link;
+        QRectF rect;
+        int page;
+        TextDocumentUtils::calculateBoundingRect( mDocument, annIt->startPosition, annIt->endPosition, rect, page );
+        if ( page >= pageCount ) {
+            ++annIt;
+            continue;
+        }
+        if ( page >= mPageCount )
+            annots[ page ].append( annIt->annotation );
+        annIt = mAnnotationPositions.erase( annIt );
+    }
 
-        TextDocumentUtils::calculateBoundingRect( mDocument, linkPosition.startPosition, linkPosition.endPosition,
-                                                  info.boundingRect, info.page );
+    const QSize size = mDocument->pageSize().toSize();
+    for ( int i = mPageCount; i < pageCount; ++i ) {
+        Okular::Page * page = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
+        pages->append( page );
 
-        if ( info.page >= 0 )
-            mLinkInfos.append( info );
+        if ( objects.contains( i ) ) {
+            page->setObjectRects( objects.value( i ) );
+        }
+        foreach ( Okular::Annotation *annotation, annots.value( i ) ) {
+            page->addAnnotation( annotation );
+        }
     }
+    mPageCount = pageCount;
+
+    return !mPaginationBlock.isValid();
 }
 
-void TextDocumentGeneratorPrivate::generateAnnotationInfos()
+void TextDocumentGeneratorPrivate::paginationStep()
 {
-    for ( int i = 0; i < mAnnotationPositions.count(); ++i ) {
-        const AnnotationPosition &annotationPosition = mAnnotationPositions[ i ];
+    Q_Q( TextDocumentGenerator );
 
-        AnnotationInfo info;
-        info.annotation = annotationPosition.annotation;
+    // paginate for a little while, not to block the user interface
+    QElapsedTimer time;
+    time.start();
+    bool finished = false;
+    while ( !finished && time.elapsed() < PaginationStepTime )
+        finished = paginate( &mPendingPages );
 
-        TextDocumentUtils::calculateBoundingRect( mDocument, annotationPosition.startPosition, annotationPosition.endPosition,
-                                                  info.boundingRect, info.page );
+    if ( finished ) {
+        mPaginationTimer->stop();
+        generateTitleInfos();
+    }
 
-        if ( info.page >= 0 )
-            mAnnotationInfos.append( info );
+    // hand the new pages to the document in ever larger batches, as every
+    // time all the observers are set up again
+    if ( finished || ( !mPendingPages.isEmpty() && mAppendTime.elapsed() >= mAppendInterval ) ) {
+        const QVector<Okular::Page*> pages = mPendingPages;
+        mPendingPages.clear();
+        mAppendTime.start();
+        mAppendInterval = qMin( mAppendInterval * 2, MaxPaginationAppendInterval );
+        q->appendPages( pages );
     }
 }
 
+void TextDocumentGeneratorPrivate::stopPagination()
+{
+    mPaginationTimer->stop();
+    mPaginationBlock = QTextBlock();
+    mPageCount = 0;
+    qDeleteAll( mPendingPages );
+    mPendingPages.clear();
+}
+
 void TextDocumentGeneratorPrivate::generateTitleInfos()
 {
     QStack< QPair<int,QDomNode> > parentNodeStack;
@@ -245,6 +372,9 @@ void TextDocumentGeneratorPrivate::initializeGenerator()
         mFont = mGeneralSettings->font();
     }
 
+    mPaginationTimer = new QTimer( q );
+    QObject::connect( mPaginationTimer, SIGNAL(timeout()), q, SLOT(paginationStep()) );
+
     q->setFeature( Generator::TextExtraction );
     q->setFeature( Generator::PrintNative );
     q->setFeature( Generator::PrintToFile );
@@ -311,44 +441,24 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword( const QStr
     }
     d->mDocument = d->mConverter->document();
 
-    d->generateTitleInfos();
-    d->generateLinkInfos();
-    d->generateAnnotationInfos();
-
-    pagesVector.resize( d->mDocument->pageCount() );
-
-    const QSize size = d->mDocument->pageSize().toSize();
-
-    QVector< QLinkedList<Okular::ObjectRect*> > objects( d->mDocument->pageCount() );
-    for ( int i = 0; i < d->mLinkInfos.count(); ++i ) {
-        const TextDocumentGeneratorPrivate::LinkInfo &info = d->mLinkInfos.at( i );
-
-        // in case that the converter report bogus link info data, do not assert here
-        if ( info.page >= objects.count() )
-          continue;
-
-        const QRectF rect = info.boundingRect;
-        objects[ info.page ].append( new Okular::ObjectRect( rect.left(), rect.top(), rect.right(), rect.bottom(), false,
-                                                             Okular::ObjectRect::Action, info.link ) );
-    }
-
-    QVector< QLinkedList<Okular::Annotation*> > annots( d->mDocument->pageCount() );
-    for ( int i = 0; i < d->mAnnotationInfos.count(); ++i ) {
-        const TextDocumentGeneratorPrivate::AnnotationInfo &info = d->mAnnotationInfos[ i ];
-        annots[ info.page ].append( info.annotation );
-    }
-
-    for ( int i = 0; i < d->mDocument->pageCount(); ++i ) {
-        Okular::Page * page = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
-        pagesVector[ i ] = page;
-
-        if ( !objects.at( i ).isEmpty() ) {
-            page->setObjectRects( objects.at( i ) );
-        }
-        QLinkedList<Okular::Annotation*>::ConstIterator annIt = annots.at( i ).begin(), annEnd = annots.at( i ).end();
-        for ( ; annIt != annEnd; ++annIt ) {
-            page->addAnnotation( *annIt );
-        }
+    // paginate with the font the pages are rendered with
+    if ( d->mDocument->defaultFont() != d->mFont )
+        d->mDocument->setDefaultFont( d->mFont );
+
+    // lay out only the first pages of the document now, and the rest of it
+    // in the background, so that the document is shown right away
+    d->mPaginationBlock = d->mDocument->begin();
+    d->mPageCount = 0;
+    bool finished = false;
+    while ( !finished && pagesVector.isEmpty() )
+        finished = d->paginate( &pagesVector );
+
+    if ( finished ) {
+        d->generateTitleInfos();
+    } else {
+        d->mAppendTime.start();
+        d->mAppendInterval = PaginationAppendInterval;
+        d->mPaginationTimer->start();
     }
 
     return openResult;
@@ -357,14 +467,23 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword( const QStr
 bool TextDocumentGenerator::doCloseDocument()
 {
     Q_D( TextDocumentGenerator );
+    d->stopPagination();
+
     delete d->mDocument;
     d->mDocument = 0;
 
+    // the links and annotations not handed to a page yet
     d->mTitlePositions.clear();
+    Q_FOREACH ( const TextDocumentGeneratorPrivate::LinkPosition &linkPos, d->mLinkPositions )
+    {
+        delete linkPos.link;
+    }
     d->mLinkPositions.clear();
-    d->mLinkInfos.clear();
+    Q_FOREACH ( const TextDocumentGeneratorPrivate::AnnotationPosition &annPos, d->mAnnotationPositions )
+    {
+        delete annPos.annotation;
+    }
     d->mAnnotationPositions.clear();
-    d->mAnnotationInfos.clear();
     // do not use clear() for the following two, otherwise they change type
     d->mDocumentInfo = Okular::DocumentInfo();
     d->mDocumentSynopsis = Okular::DocumentSynopsis();
@@ -418,7 +537,9 @@ QImage TextDocumentGeneratorPrivate::image( PixmapRequest * request )
 //        if Qt ever gets fixed
 //     context.palette.setColor( QPalette::Link, Qt::blue );
     context.clip = rect;
-    mDocument->setDefaultFont( mFont );
+    // setting the font lays out the document again, even if it is the same
+    if ( mDocument->defaultFont() != mFont )
+        mDocument->setDefaultFont( mFont );
     mDocument->documentLayout()->draw( &p, context );
 #ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->unlock();
@@ -10,6 +10,8 @@
 #ifndef _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 #define _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
 #include <QtGui/QAbstractTextDocumentLayout>
 #include <QtGui/QTextBlock>
 #include <QtGui/QTextDocument>
@@ -116,12 +118,14 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
 
     public:
         TextDocumentGeneratorPrivate( TextDocumentConverter *converter )
-            : mConverter( converter ), mDocument( 0 ), mGeneralSettings( 0 )
+            : mConverter( converter ), mDocument( 0 ), mPaginationTimer( 0 ), mPageCount( 0 ), mAppendInterval( 0 ),
+              mGeneralSettings( 0 )
         {
         }
 
         virtual ~TextDocumentGeneratorPrivate()
         {
+            qDeleteAll( mPendingPages );
             delete mConverter;
             delete mDocument;
         }
@@ -143,8 +147,15 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         void addMetaData( const QString &key, const QString &value, const QString &title );
         void addMetaData( DocumentInfo::Key, const QString &value );
 
-        void generateLinkInfos();
-        void generateAnnotationInfos();
+        /**
+         * Lays out the next part of the document, and appends to @p pages
+         * the pages that are laid out completely; returns whether the whole
+         * document is laid out.
+         */
+        bool paginate( QVector<Okular::Page*> *pages );
+        void paginationStep();
+        void stopPagination();
+
         void generateTitleInfos();
 
         TextDocumentConverter *mConverter;
@@ -169,14 +180,6 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         };
         QList<LinkPosition> mLinkPositions;
 
-        struct LinkInfo
-        {
-          int page;
-          QRectF boundingRect;
-          Action *link;
-        };
-        QList<LinkInfo> mLinkInfos;
-
         struct AnnotationPosition
         {
           int startPosition;
@@ -185,13 +188,16 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         };
         QList<AnnotationPosition> mAnnotationPositions;
 
-        struct AnnotationInfo
-        {
-          int page;
-          QRectF boundingRect;
-          Annotation *annotation;
-        };
-        QList<AnnotationInfo> mAnnotationInfos;
+        // the pagination of the document, done in the background
+        QTimer *mPaginationTimer;
+        // the first block not laid out yet
+        QTextBlock mPaginationBlock;
+        // how many pages were laid out
+        int mPageCount;
+        // the pages laid out but not handed to the document yet
+        QVector<Okular::Page*> mPendingPages;
+        QElapsedTimer mAppendTime;
+        int mAppendInterval;
 
         TextDocumentSettings *mGeneralSettings;
 
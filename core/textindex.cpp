@@ -0,0 +1,374 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "textindex_p.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStringList>
+#include <QtGui/QTransform>
+
+#include <algorithm>
+
+#include "textpage.h"
+#include "textpage_p.h"
+
+using namespace Okular;
+
+static const quint32 TextIndexMagic = 0x4f4b5449; // "OKTI"
+static const quint32 TextIndexVersion = 1;
+
+class TextIndex::SuffixLessThan
+{
+    public:
+        SuffixLessThan( const QVector< QString > &vocabulary ) : m_vocabulary( vocabulary ) {}
+
+        bool operator()( const Suffix &first, const Suffix &second ) const
+        {
+            return suffix( first ).compare( suffix( second ) ) < 0;
+        }
+
+        bool operator()( const Suffix &suffix, const QString &text ) const
+        {
+            return this->suffix( suffix ).compare( text ) < 0;
+        }
+
+        QStringRef suffix( const Suffix &suffix ) const
+        {
+            return m_vocabulary.at( suffix.word ).midRef( suffix.offset );
+        }
+
+    private:
+        const QVector< QString > &m_vocabulary;
+};
+
+/* Returns the index of the word containing the character at @p position. */
+static int wordAt( const QVector< int > &offsets, int position )
+{
+    return ( std::upper_bound( offsets.constBegin(), offsets.constEnd(), position ) - offsets.constBegin() ) - 1;
+}
+
+/* Returns the whitespace separated words of @p text. */
+static QStringList splitWords( const QString &text )
+{
+    QStringList words;
+    int start = -1;
+    for ( int i = 0; i <= text.length(); ++i )
+    {
+        const bool space = i == text.length() || text.at( i ).isSpace();
+        if ( space && start != -1 )
+        {
+            words.append( text.mid( start, i - start ) );
+            start = -1;
+        }
+        else if ( !space && start == -1 )
+        {
+            start = i;
+        }
+    }
+    return words;
+}
+
+TextIndex::TextIndex( int pageCount, qint64 documentSize, const QDateTime &documentModified )
+    : m_pages( pageCount ), m_suffixesSorted( true ), m_indexedPages( 0 ), m_documentSize( documentSize ), m_documentModified( documentModified )
+{
+}
+
+QString TextIndex::fileName( const QString &docDataFileName )
+{
+    QString fileName = docDataFileName;
+    if ( fileName.endsWith( QLatin1String( ".xml" ) ) )
+        fileName.chop( 4 );
+    return fileName + QLatin1String( ".index" );
+}
+
+bool TextIndex::load( const QString &fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_0 );
+
+    quint32 magic, version;
+    qint64 documentSize;
+    QDateTime documentModified;
+    qint32 pageCount;
+    stream >> magic >> version >> documentSize >> documentModified >> pageCount;
+    if ( stream.status() != QDataStream::Ok || magic != TextIndexMagic || version != TextIndexVersion )
+        return false;
+
+    // a stale index, the document changed since it was built; the page
+    // counts differ still while the pages are being loaded progressively
+    if ( documentSize != m_documentSize || documentModified != m_documentModified || pageCount < 0 )
+        return false;
+
+    QVector< IndexedPage > pages( qMax( int( pageCount ), m_pages.count() ) );
+    for ( int i = 0; i < pageCount; ++i )
+    {
+        IndexedPage &page = pages[ i ];
+        stream >> page.indexed;
+        if ( !page.indexed )
+            continue;
+
+        qint32 wordCount;
+        stream >> page.text >> wordCount;
+        if ( stream.status() != QDataStream::Ok || wordCount < 0 )
+            return false;
+
+        page.offsets.resize( wordCount );
+        page.areas.resize( wordCount );
+        for ( int w = 0; w < wordCount; ++w )
+        {
+            qint32 offset;
+            float left, top, right, bottom;
+            stream >> offset >> left >> top >> right >> bottom;
+            page.offsets[ w ] = offset;
+            page.areas[ w ] = NormalizedRect( left, top, right, bottom );
+        }
+    }
+    if ( stream.status() != QDataStream::Ok )
+        return false;
+
+    m_pages = pages;
+    m_vocabulary.clear();
+    m_wordPages.clear();
+    m_wordIds.clear();
+    m_suffixes.clear();
+    m_suffixesSorted = true;
+    m_indexedPages = 0;
+    for ( int i = 0; i < m_pages.count(); ++i )
+    {
+        if ( m_pages.at( i ).indexed )
+        {
+            ++m_indexedPages;
+            indexWords( i );
+        }
+    }
+    return true;
+}
+
+bool TextIndex::save( const QString &fileName ) const
+{
+    QSaveFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_0 );
+
+    stream << TextIndexMagic << TextIndexVersion << m_documentSize << m_documentModified << qint32( m_pages.count() );
+    foreach ( const IndexedPage &page, m_pages )
+    {
+        stream << page.indexed;
+        if ( !page.indexed )
+            continue;
+
+        stream << page.text << qint32( page.offsets.count() );
+        for ( int w = 0; w < page.offsets.count(); ++w )
+        {
+            const NormalizedRect &area = page.areas.at( w );
+            stream << qint32( page.offsets.at( w ) ) << float( area.left ) << float( area.top ) << float( area.right ) << float( area.bottom );
+        }
+    }
+
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+int TextIndex::pageCount() const
+{
+    return m_pages.count();
+}
+
+void TextIndex::setPageCount( int pageCount )
+{
+    if ( pageCount > m_pages.count() )
+        m_pages.resize( pageCount );
+}
+
+bool TextIndex::hasPage( int page ) const
+{
+    return page >= 0 && page < m_pages.count() && m_pages.at( page ).indexed;
+}
+
+bool TextIndex::isComplete() const
+{
+    return m_indexedPages == m_pages.count();
+}
+
+bool TextIndex::addPage( int page, const TextPage *textPage )
+{
+    if ( !textPage || page < 0 || page >= m_pages.count() || m_pages.at( page ).indexed )
+        return false;
+
+    IndexedPage &indexedPage = m_pages[ page ];
+    indexedPage.text = textPage->d->searchableText( &indexedPage.offsets, &indexedPage.areas );
+    indexedPage.indexed = true;
+    ++m_indexedPages;
+    indexWords( page );
+    return true;
+}
+
+void TextIndex::indexWords( int page )
+{
+    const QStringList words = splitWords( m_pages.at( page ).text.toCaseFolded() );
+    foreach ( const QString &word, words.toSet() )
+    {
+        QHash< QString, int >::const_iterator it = m_wordIds.constFind( word );
+        if ( it != m_wordIds.constEnd() )
+        {
+            m_wordPages[ it.value() ].append( page );
+            continue;
+        }
+
+        const int id = m_vocabulary.count();
+        m_vocabulary.append( word );
+        m_wordPages.append( QVector< int >() << page );
+        m_wordIds.insert( word, id );
+        for ( int offset = 0; offset < word.length(); ++offset )
+        {
+            const Suffix suffix = { id, offset };
+            m_suffixes.append( suffix );
+        }
+        m_suffixesSorted = false;
+    }
+}
+
+/* Adds to @p pages the pages of the words of the vocabulary @p word matches as @p match. */
+void TextIndex::matchingWords( const QString &word, WordMatch match, QSet< int > *pages ) const
+{
+    if ( match == WholeWord )
+    {
+        foreach ( int page, m_wordPages.value( m_wordIds.value( word, -1 ) ) )
+            pages->insert( page );
+        return;
+    }
+
+    const SuffixLessThan lessThan( m_vocabulary );
+    if ( !m_suffixesSorted )
+    {
+        std::sort( m_suffixes.begin(), m_suffixes.end(), lessThan );
+        m_suffixesSorted = true;
+    }
+
+    // the suffixes starting with word follow each other
+    QVector< Suffix >::const_iterator it = std::lower_bound( m_suffixes.constBegin(), m_suffixes.constEnd(), word, lessThan );
+    for ( ; it != m_suffixes.constEnd(); ++it )
+    {
+        const QStringRef suffix = lessThan.suffix( *it );
+        if ( !suffix.startsWith( word ) )
+            break;
+        if ( ( match == WordStart && it->offset != 0 ) || ( match == WordEnd && suffix.length() != word.length() ) )
+            continue;
+
+        foreach ( int page, m_wordPages.at( it->word ) )
+            pages->insert( page );
+    }
+}
+
+QSet< int > TextIndex::candidatePages( const QString &text, Qt::CaseSensitivity caseSensitivity ) const
+{
+    Q_UNUSED( caseSensitivity ) // the words are case folded, so this is a superset anyway
+
+    const QStringList textWords = splitWords( text.normalized( QString::NormalizationForm_KC ).toCaseFolded() );
+
+    QSet< int > pages;
+    if ( textWords.isEmpty() )
+    {
+        for ( int i = 0; i < m_pages.count(); ++i )
+        {
+            if ( m_pages.at( i ).indexed )
+                pages.insert( i );
+        }
+        return pages;
+    }
+
+    // a single word can match inside a word of the page; otherwise the first
+    // word ends a word of the page, the last one starts one, and the words
+    // between them are whole words of the page
+    if ( textWords.count() == 1 )
+    {
+        matchingWords( textWords.first(), WordPart, &pages );
+        return pages;
+    }
+
+    for ( int i = 0; i < textWords.count(); ++i )
+    {
+        const WordMatch match = i == 0 ? WordEnd : i == textWords.count() - 1 ? WordStart : WholeWord;
+        QSet< int > wordPages;
+        matchingWords( textWords.at( i ), match, &wordPages );
+        if ( i == 0 )
+            pages = wordPages;
+        else
+            pages.intersect( wordPages );
+        if ( pages.isEmpty() )
+            break;
+    }
+    return pages;
+}
+
+QVector< RegularAreaRect * > TextIndex::findText( int page, const QString &text, Qt::CaseSensitivity caseSensitivity, const QTransform &matrix ) const
+{
+    QVector< RegularAreaRect * > matches;
+    if ( !hasPage( page ) )
+        return matches;
+
+    // normalize query search all unicode (including glyphs), as TextPage does
+    const QString query = text.normalized( QString::NormalizationForm_KC );
+    if ( query.isEmpty() )
+        return matches;
+
+    const IndexedPage &indexedPage = m_pages.at( page );
+    int from = 0;
+    while ( ( from = indexedPage.text.indexOf( query, from, caseSensitivity ) ) != -1 )
+    {
+        matches.append( matchArea( indexedPage, from, query.length(), matrix ) );
+        from += query.length();
+    }
+    return matches;
+}
+
+QVector< RegularAreaRect * > TextIndex::findAll( int page, const QRegularExpression &pattern, const QTransform &matrix ) const
+{
+    QVector< RegularAreaRect * > matches;
+    if ( !hasPage( page ) || !pattern.isValid() )
+        return matches;
+
+    const IndexedPage &indexedPage = m_pages.at( page );
+    QRegularExpressionMatchIterator it = pattern.globalMatch( indexedPage.text );
+    while ( it.hasNext() )
+    {
+        const QRegularExpressionMatch match = it.next();
+        if ( match.capturedLength() > 0 )
+            matches.append( matchArea( indexedPage, match.capturedStart(), match.capturedLength(), matrix ) );
+    }
+    return matches;
+}
+
+/* Returns the area of the words of @p page spanned by the @p length characters at @p from. */
+RegularAreaRect *TextIndex::matchArea( const IndexedPage &page, int from, int length, const QTransform &matrix )
+{
+    const int first = wordAt( page.offsets, from );
+    const int last = wordAt( page.offsets, from + length - 1 );
+
+    RegularAreaRect *area = new RegularAreaRect;
+    for ( int w = first; w <= last; ++w )
+    {
+        NormalizedRect wordArea = page.areas.at( w );
+        wordArea.transform( matrix );
+        area->append( wordArea );
+    }
+    area->simplify();
+    return area;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,149 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_TEXTINDEX_P_H_
+#define _OKULAR_TEXTINDEX_P_H_
+
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "area.h"
+#include "okularcore_export.h"
+
+class QRegularExpression;
+class QTransform;
+
+namespace Okular {
+
+class TextPage;
+
+/**
+ * Full text index of a document, saved next to its docdata file.
+ *
+ * For each page the index keeps the text searches match against, with the
+ * normalized area of each word, so that whole document searches can be
+ * answered without extracting the text pages again. An inverted index from
+ * the words of the document to their pages skips the pages that can't match:
+ * whole words are looked up by hash, and parts of words in the sorted list
+ * of the suffixes of all the words.
+ *
+ * The index is only valid for the document file it was built for, which is
+ * checked with its size and modification time.
+ */
+class OKULARCORE_EXPORT TextIndex
+{
+    public:
+        TextIndex( int pageCount, qint64 documentSize, const QDateTime &documentModified );
+
+        /**
+         * Returns the file where the index of the document whose docdata file
+         * is @p docDataFileName is saved.
+         */
+        static QString fileName( const QString &docDataFileName );
+
+        /**
+         * Loads the index from @p fileName; fails if the index was built for
+         * a different version of the document.
+         */
+        bool load( const QString &fileName );
+
+        /**
+         * Saves the index to @p fileName.
+         */
+        bool save( const QString &fileName ) const;
+
+        int pageCount() const;
+
+        /**
+         * Grows the index to @p pageCount pages, for the pages appended to
+         * the document; the pages indexed already are kept.
+         */
+        void setPageCount( int pageCount );
+
+        bool hasPage( int page ) const;
+        bool isComplete() const;
+
+        /**
+         * Adds the text of @p textPage as the text of @p page, unless the
+         * page is already indexed. Returns whether the index changed.
+         */
+        bool addPage( int page, const TextPage *textPage );
+
+        /**
+         * Returns the pages that may contain @p text.
+         */
+        QSet< int > candidatePages( const QString &text, Qt::CaseSensitivity caseSensitivity ) const;
+
+        /**
+         * Returns all the matches of @p text on @p page, in the same way as
+         * TextPage::findText() would, with the areas transformed by @p matrix.
+         * The caller takes ownership of the returned areas.
+         */
+        QVector< RegularAreaRect * > findText( int page, const QString &text, Qt::CaseSensitivity caseSensitivity, const QTransform &matrix ) const;
+
+        /**
+         * Returns all the matches of @p pattern on @p page, in the same way as
+         * TextPage::findAll() would, with the areas transformed by @p matrix.
+         * The caller takes ownership of the returned areas.
+         */
+        QVector< RegularAreaRect * > findAll( int page, const QRegularExpression &pattern, const QTransform &matrix ) const;
+
+    private:
+        struct IndexedPage
+        {
+            IndexedPage() : indexed( false ) {}
+
+            QString text;
+            QVector< int > offsets;
+            QVector< NormalizedRect > areas;
+            bool indexed;
+        };
+
+        // the suffix of a word of the vocabulary starting at offset
+        struct Suffix
+        {
+            int word;
+            int offset;
+        };
+        class SuffixLessThan;
+
+        enum WordMatch
+        {
+            WholeWord,
+            WordStart,
+            WordEnd,
+            WordPart
+        };
+
+        void indexWords( int page );
+        void matchingWords( const QString &word, WordMatch match, QSet< int > *pages ) const;
+        static RegularAreaRect *matchArea( const IndexedPage &page, int from, int length, const QTransform &matrix );
+
+        QVector< IndexedPage > m_pages;
+        // the case folded words of the document, and the pages containing each
+        QVector< QString > m_vocabulary;
+        QVector< QVector< int > > m_wordPages;
+        QHash< QString, int > m_wordIds;
+        // the suffixes of the vocabulary in lexicographic order, sorted again
+        // by the first query after new words were added
+        mutable QVector< Suffix > m_suffixes;
+        mutable bool m_suffixesSorted;
+        int m_indexedPages;
+        qint64 m_documentSize;
+        QDateTime m_documentModified;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
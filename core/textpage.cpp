@@ -11,6 +11,7 @@
 #include "textpage_p.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QRegularExpression>
 
 #include "area.h"
 #include "debug_p.h"
@@ -50,18 +51,6 @@ class SearchPoint
         int offset_end;
 };
 
-/* text comparison functions */
-
-static bool CaseInsensitiveCmpFn( const QStringRef & from, const QStringRef & to )
-{
-    return from.compare( to, Qt::CaseInsensitive ) == 0;
-}
-
-static bool CaseSensitiveCmpFn( const QStringRef & from, const QStringRef & to )
-{
-    return from.compare( to, Qt::CaseSensitive ) == 0;
-}
-
 
 /**
  * Returns true iff segments [@p left1, @p right1] and [@p left2, @p right2] on the real line
@@ -106,6 +95,10 @@ static bool doesConsumeY(const NormalizedRect& first, const NormalizedRect& seco
 
 
 /*
+  TinyTextEntity is only used while laying out the text of a page, see
+  TextPagePrivate::correctTextOrder(); the words are then stored in a
+  TextList.
+
   Rationale behind TinyTextEntity:
 
   instead of storing directly a QString for the text of an entity,
@@ -213,15 +206,110 @@ NormalizedRect TextEntity::transformedArea(const QTransform &matrix) const
 }
 
 
+TextList::TextList()
+{
+    m_offsets.append( 0 );
+}
+
+void TextList::append( const QString &text, const NormalizedRect &area )
+{
+    m_text.append( text );
+    m_offsets.append( m_text.length() );
+    m_areas.append( area.left );
+    m_areas.append( area.top );
+    m_areas.append( area.right );
+    m_areas.append( area.bottom );
+}
+
+void TextList::clear()
+{
+    m_text.clear();
+    m_offsets.resize( 1 );
+    m_areas.clear();
+}
+
+void TextList::squeeze()
+{
+    m_text.squeeze();
+    m_offsets.squeeze();
+    m_areas.squeeze();
+}
+
+qulonglong TextList::memoryUsage() const
+{
+    return sizeof( TextList )
+           + m_text.capacity() * sizeof( QChar )
+           + m_offsets.capacity() * sizeof( int )
+           + m_areas.capacity() * sizeof( float );
+}
+
+
+TextMatcher::TextMatcher( const QString &pattern )
+    : m_pattern( pattern )
+{
+    const int length = m_pattern.length();
+    const ushort *data = m_pattern.utf16();
+    for ( int c = 0; c < 256; ++c )
+    {
+        m_forwardShifts[ c ] = length;
+        m_backwardShifts[ c ] = length;
+    }
+    // the occurrences nearest to the end of the pattern, or to its start,
+    // give the smallest shifts
+    for ( int i = 0; i < length - 1; ++i )
+        m_forwardShifts[ data[ i ] & 0xff ] = length - 1 - i;
+    for ( int i = length - 1; i > 0; --i )
+        m_backwardShifts[ data[ i ] & 0xff ] = i;
+}
+
+int TextMatcher::indexIn( const QString &text, int from ) const
+{
+    const int length = m_pattern.length();
+    if ( length == 0 )
+        return -1;
+
+    const ushort *pattern = m_pattern.utf16();
+    const ushort *data = text.utf16();
+    const ushort last = pattern[ length - 1 ];
+    for ( int pos = qMax( from, 0 ); pos <= text.length() - length; )
+    {
+        const ushort c = data[ pos + length - 1 ];
+        if ( c == last && memcmp( data + pos, pattern, ( length - 1 ) * sizeof( ushort ) ) == 0 )
+            return pos;
+        pos += m_forwardShifts[ c & 0xff ];
+    }
+    return -1;
+}
+
+int TextMatcher::lastIndexIn( const QString &text, int to ) const
+{
+    const int length = m_pattern.length();
+    if ( length == 0 )
+        return -1;
+
+    const ushort *pattern = m_pattern.utf16();
+    const ushort *data = text.utf16();
+    const ushort first = pattern[ 0 ];
+    for ( int pos = qMin( to, text.length() ) - length; pos >= 0; )
+    {
+        const ushort c = data[ pos ];
+        if ( c == first && memcmp( data + pos + 1, pattern + 1, ( length - 1 ) * sizeof( ushort ) ) == 0 )
+            return pos;
+        pos -= m_backwardShifts[ c & 0xff ];
+    }
+    return -1;
+}
+
+
 TextPagePrivate::TextPagePrivate()
-    : m_page( 0 )
+    : m_page( 0 ), m_matcher( 0 ), m_matcherCaseSensitivity( Qt::CaseSensitive )
 {
 }
 
 TextPagePrivate::~TextPagePrivate()
 {
     qDeleteAll( m_searchPoints );
-    qDeleteAll( m_words );
+    delete m_matcher;
 }
 
 
@@ -238,7 +326,7 @@ TextPage::TextPage( const TextEntity::List &words )
     {
         TextEntity *e = *it;
         if ( !e->text().isEmpty() )
-            d->m_words.append( new TinyTextEntity( e->text(), *e->area() ) );
+            d->m_words.append( e->text(), *e->area() );
         delete e;
     }
 }
@@ -251,13 +339,16 @@ TextPage::~TextPage()
 void TextPage::append( const QString &text, NormalizedRect *area )
 {
     if ( !text.isEmpty() )
-        d->m_words.append( new TinyTextEntity( text.normalized(QString::NormalizationForm_KC), *area ) );
+    {
+        d->m_words.append( text.normalized(QString::NormalizationForm_KC), *area );
+        d->invalidateSearchText();
+    }
     delete area;
 }
 
 struct WordWithCharacters
 {
-    WordWithCharacters(TinyTextEntity *w, const TextList &c)
+    WordWithCharacters(TinyTextEntity *w, const TinyTextEntityList &c)
      : word(w), characters(c)
     {
     }
@@ -273,7 +364,7 @@ struct WordWithCharacters
     }
     
     TinyTextEntity *word;
-    TextList characters;
+    TinyTextEntityList characters;
 };
 typedef QList<WordWithCharacters> WordsWithCharacters;
 
@@ -719,9 +810,8 @@ RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchD
     // invalid search request
     if ( d->m_words.isEmpty() || query.isEmpty() || ( area && area->isNull() ) )
         return 0;
-    TextList::ConstIterator start;
-    int start_offset = 0;
-    TextList::ConstIterator end;
+    d->buildSearchText();
+    int position = 0;
     const QMap< int, SearchPoint* >::const_iterator sIt = d->m_searchPoints.constFind( searchID );
     if ( sIt == d->m_searchPoints.constEnd() )
     {
@@ -736,40 +826,52 @@ RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchD
     switch ( dir )
     {
         case FromTop:
-            start = d->m_words.constBegin();
-            start_offset = 0;
-            end = d->m_words.constEnd();
+            position = 0;
             break;
         case FromBottom:
-            start = d->m_words.constEnd();
-            start_offset = 0;
-            end = d->m_words.constBegin();
+            position = d->m_searchText.length();
             forward = false;
             break;
         case NextResult:
-            start = (*sIt)->it_end;
-            start_offset = (*sIt)->offset_end;
-            end = d->m_words.constEnd();
+            position = d->searchPosition( (*sIt)->it_end.index(), (*sIt)->offset_end );
             break;
         case PreviousResult:
-            start = (*sIt)->it_begin;
-            start_offset = (*sIt)->offset_begin;
-            end = d->m_words.constBegin();
+            position = d->searchPosition( (*sIt)->it_begin.index(), (*sIt)->offset_begin );
             forward = false;
             break;
     };
-    RegularAreaRect* ret = 0;
-    const TextComparisonFunction cmpFn = caseSensitivity == Qt::CaseSensitive
-                                       ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
-    if ( forward )
-    {
-        ret = d->findTextInternalForward( searchID, query, cmpFn, start, start_offset, end );
-    }
-    else
+    return d->findTextInternal( searchID, query, caseSensitivity, forward, position );
+}
+
+QVector< RegularAreaRect * > TextPage::findAll( const QRegularExpression &pattern )
+{
+    QVector< RegularAreaRect * > matches;
+    if ( d->m_words.isEmpty() || !pattern.isValid() )
+        return matches;
+    d->buildSearchText();
+
+    const QTransform matrix = d->m_page ? d->m_page->rotationMatrix() : QTransform();
+    QRegularExpressionMatchIterator it = pattern.globalMatch( d->m_searchText );
+    while ( it.hasNext() )
     {
-        ret = d->findTextInternalBackward( searchID, query, cmpFn, start, start_offset, end );
+        const QRegularExpressionMatch match = it.next();
+        if ( match.capturedLength() == 0 )
+            continue;
+
+        const int first = d->searchWord( match.capturedStart() );
+        const int last = d->searchWord( match.capturedEnd() - 1 );
+
+        RegularAreaRect *area = new RegularAreaRect;
+        for ( int w = first; w <= last; ++w )
+        {
+            NormalizedRect wordArea = d->m_words.area( w );
+            wordArea.transform( matrix );
+            area->append( wordArea );
+        }
+        area->simplify();
+        matches.append( area );
     }
-    return ret;
+    return matches;
 }
 
 // hyphenated '-' must be at the end of a word, so hyphenation means
@@ -790,7 +892,7 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
         if ( ( it + 1 ) != textListEnd )
         {
             // 1. if the next character is '\n'
-            const QString &lookahedStr = (*(it+1))->text();
+            const QString &lookahedStr = (*(it+1))->rawText();
             if (lookahedStr.startsWith('\n'))
             {
                 len -= 1;
@@ -798,8 +900,8 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
             else
             {
                 // 2. if the next word is in a different line or not
-                const NormalizedRect& hyphenArea = (*it)->area;
-                const NormalizedRect& lookaheadArea = (*(it + 1))->area;
+                const NormalizedRect hyphenArea = (*it)->area;
+                const NormalizedRect lookaheadArea = (*(it + 1))->area;
 
                 // lookahead to check whether both the '-' rect and next character rect overlap
                 if( !doesConsumeY( hyphenArea, lookaheadArea, 70 ) )
@@ -818,6 +920,51 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
     return len;
 }
 
+QString TextPagePrivate::searchableText( QVector< int > *offsets, QVector< NormalizedRect > *areas ) const
+{
+    QString ret;
+    offsets->reserve( m_words.count() );
+    if ( areas )
+        areas->reserve( m_words.count() );
+
+    const TextList::ConstIterator itEnd = m_words.constEnd();
+    for ( TextList::ConstIterator it = m_words.constBegin(); it != itEnd; ++it )
+    {
+        const QString str = (*it)->rawText();
+        offsets->append( ret.length() );
+        if ( areas )
+            areas->append( (*it)->area );
+        ret += str.leftRef( stringLengthAdaptedWithHyphen( str, it, itEnd ) );
+    }
+    return ret;
+}
+
+void TextPagePrivate::buildSearchText()
+{
+    if ( !m_searchOffsets.isEmpty() )
+        return;
+
+    m_searchText = searchableText( &m_searchOffsets, 0 );
+    m_searchOffsets.append( m_searchText.length() );
+    m_searchOffsets.squeeze();
+}
+
+void TextPagePrivate::invalidateSearchText()
+{
+    m_searchText.clear();
+    m_foldedSearchText.clear();
+    m_searchOffsets.clear();
+}
+
+qulonglong TextPagePrivate::memoryUsage() const
+{
+    return sizeof( TextPage ) + sizeof( TextPagePrivate ) - sizeof( TextList )
+           + m_words.memoryUsage()
+           + m_searchPoints.count() * sizeof( SearchPoint )
+           + ( m_searchText.capacity() + m_foldedSearchText.capacity() ) * sizeof( QChar )
+           + m_searchOffsets.capacity() * sizeof( int );
+}
+
 RegularAreaRect* TextPagePrivate::searchPointToArea(const SearchPoint* sp)
 {
     const QTransform matrix = m_page ? m_page->rotationMatrix() : QTransform();
@@ -825,7 +972,7 @@ RegularAreaRect* TextPagePrivate::searchPointToArea(const SearchPoint* sp)
 
     for (TextList::ConstIterator it = sp->it_begin; ; it++)
     {
-        const TinyTextEntity* curEntity = *it;
+        const TextListEntry curEntity = *it;
         ret->append( curEntity->transformedArea( matrix ) );
 
         if (it == sp->it_end) {
@@ -837,232 +984,60 @@ RegularAreaRect* TextPagePrivate::searchPointToArea(const SearchPoint* sp)
     return ret;
 }
 
-RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const QString &_query,
-                                                             TextComparisonFunction comparer,
-                                                             const TextList::ConstIterator &start,
-                                                             int start_offset,
-                                                             const TextList::ConstIterator &end)
+RegularAreaRect* TextPagePrivate::findTextInternal( int searchID, const QString &query,
+                                                     Qt::CaseSensitivity caseSensitivity,
+                                                     bool forward, int position )
 {
-    // normalize query search all unicode (including glyphs)
-    const QString query = _query.normalized(QString::NormalizationForm_KC);
-
-    // j is the current position in our query
-    // len is the length of the string in TextEntity
-    // queryLeft is the length of the query we have left
-    int j=0, queryLeft=query.length();
-
-    TextList::ConstIterator it = start;
-    int offset = start_offset;
-
-    TextList::ConstIterator it_begin = TextList::ConstIterator();
-    int offset_begin = 0; //dummy initial value to suppress compiler warnings
-
-    while ( it != end )
-    {
-        const TinyTextEntity* curEntity = *it;
-        const QString& str = curEntity->text();
-        int len = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
-
-        if (offset >= len)
-        {
-            it++;
-            offset = 0;
-            continue;
-        }
-
-        if ( it_begin == TextList::ConstIterator() )
-        {
-            it_begin = it;
-            offset_begin = offset;
-        }
-
-        int min=qMin(queryLeft,len-offset);
-        {
-#ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << str.midRef(offset, min) << ":" << _query.midRef(j, min);
-#endif
-            // we have equal (or less than) area of the query left as the length of the current 
-            // entity
-
-            if ( !comparer( str.midRef( offset, min ), query.midRef( j, min ) ) )
-            {
-                    // we have not matched
-                    // this means we do not have a complete match
-                    // we need to get back to query start
-                    // and continue the search from this place
-#ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << "\tnot matched";
-#endif
-                    j = 0;
-                    queryLeft=query.length();
-                    it = it_begin;
-                    offset = offset_begin+1;
-                    it_begin = TextList::ConstIterator();
-            }
-            else
-            {
-                    // we have a match
-                    // move the current position in the query
-                    // to the position after the length of this string
-                    // we matched
-                    // subtract the length of the current entity from 
-                    // the left length of the query
-#ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << "\tmatched";
-#endif
-                    j += min;
-                    queryLeft -= min;
-
-                    if (queryLeft==0)
-                    {
-                        // save or update the search point for the current searchID
-                        QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
-                        if ( sIt == m_searchPoints.end() )
-                        {
-                            sIt = m_searchPoints.insert( searchID, new SearchPoint );
-                        }
-                        SearchPoint* sp = *sIt;
-                        sp->it_begin = it_begin;
-                        sp->it_end = it;
-                        sp->offset_begin = offset_begin;
-                        sp->offset_end = offset + min;
-                        return searchPointToArea(sp);
-                    }
-
-                    it++;
-                    offset = 0;
-            }
-        }
-    }
-    // end of loop - it means that we've ended the textentities
-
-    const QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
-    if ( sIt != m_searchPoints.end() )
+    // normalize query search all unicode (including glyphs), once for all
+    // the searches of the same query on this page
+    if ( !m_matcher || m_matcherQuery != query || m_matcherCaseSensitivity != caseSensitivity )
     {
-        SearchPoint* sp = *sIt;
-        m_searchPoints.erase( sIt );
-        delete sp;
+        QString pattern = query.normalized( QString::NormalizationForm_KC );
+        if ( caseSensitivity == Qt::CaseInsensitive )
+            pattern = pattern.toCaseFolded();
+
+        delete m_matcher;
+        m_matcher = new TextMatcher( pattern );
+        m_matcherQuery = query;
+        m_matcherCaseSensitivity = caseSensitivity;
     }
-    return 0;
-}
-
-RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const QString &_query,
-                                                            TextComparisonFunction comparer,
-                                                            const TextList::ConstIterator &start,
-                                                            int start_offset,
-                                                            const TextList::ConstIterator &end)
-{
-    // normalize query to search all unicode (including glyphs)
-    const QString query = _query.normalized(QString::NormalizationForm_KC);
 
-    // j is the current position in our query
-    // len is the length of the string in TextEntity
-    // queryLeft is the length of the query we have left
-    int j=query.length(), queryLeft=query.length();
+    // case folding maps each UTF-16 code unit to one, so the positions in
+    // both texts are the same
+    if ( caseSensitivity == Qt::CaseInsensitive && m_foldedSearchText.isNull() )
+        m_foldedSearchText = m_searchText.toCaseFolded();
+    const QString &text = caseSensitivity == Qt::CaseSensitive ? m_searchText : m_foldedSearchText;
 
-    TextList::ConstIterator it = start;
-    int offset = start_offset;
-
-    TextList::ConstIterator it_begin = TextList::ConstIterator();
-    int offset_begin = 0; //dummy initial value to suppress compiler warnings
-
-    while ( true )
+    const int length = m_matcher->pattern().length();
+    const int match = forward ? m_matcher->indexIn( text, position ) : m_matcher->lastIndexIn( text, position );
+    if ( match == -1 )
     {
-        if (offset <= 0)
-        {
-            if ( it == end )
-            {
-                break;
-            }
-            it--;
-        }
-
-        const TinyTextEntity* curEntity = *it;
-        const QString& str = curEntity->text();
-        int len = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
-
-        if (offset <= 0)
+        const QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
+        if ( sIt != m_searchPoints.end() )
         {
-            offset = len;
-        }
-
-        if ( it_begin == TextList::ConstIterator() )
-        {
-            it_begin = it;
-            offset_begin = offset;
-        }
-
-        int min=qMin(queryLeft,offset);
-        {
-#ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << str.midRef(offset-min, min) << " : " << _query.midRef(j-min, min);
-#endif
-            // we have equal (or less than) area of the query left as the length of the current 
-            // entity
-
-            // Note len is not str.length() so we can't use rightRef here
-            if ( !comparer( str.midRef(offset-min, min ), query.midRef( j - min, min ) ) )
-            {
-                    // we have not matched
-                    // this means we do not have a complete match
-                    // we need to get back to query start
-                    // and continue the search from this place
-#ifdef DEBUG_TEXTPAGE
-                    qCDebug(OkularCoreDebug) << "\tnot matched";
-#endif
-
-                    j = query.length();
-                    queryLeft = query.length();
-                    it = it_begin;
-                    offset = offset_begin-1;
-                    it_begin = TextList::ConstIterator();
-            }
-            else
-            {
-                    // we have a match
-                    // move the current position in the query
-                    // to the position after the length of this string
-                    // we matched
-                    // subtract the length of the current entity from 
-                    // the left length of the query
-#ifdef DEBUG_TEXTPAGE
-                    qCDebug(OkularCoreDebug) << "\tmatched";
-#endif
-                    j -= min;
-                    queryLeft -= min;
-
-                    if ( queryLeft == 0 )
-                    {
-                        // save or update the search point for the current searchID
-                        QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
-                        if ( sIt == m_searchPoints.end() )
-                        {
-                            sIt = m_searchPoints.insert( searchID, new SearchPoint );
-                        }
-                        SearchPoint* sp = *sIt;
-                        sp->it_begin = it;
-                        sp->it_end = it_begin;
-                        sp->offset_begin = offset - min;
-                        sp->offset_end = offset_begin;
-                        return searchPointToArea(sp);
-                    }
-
-                    offset = 0;
-            }
-
+            SearchPoint* sp = *sIt;
+            m_searchPoints.erase( sIt );
+            delete sp;
         }
-
+        return 0;
     }
-    // end of loop - it means that we've ended the textentities
 
-    const QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
-    if ( sIt != m_searchPoints.end() )
+    // the words containing the first and the last character of the match
+    const int first = searchWord( match );
+    const int last = searchWord( match + length - 1 );
+
+    // save or update the search point for the current searchID
+    QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
+    if ( sIt == m_searchPoints.end() )
     {
-        SearchPoint* sp = *sIt;
-        m_searchPoints.erase( sIt );
-        delete sp;
+        sIt = m_searchPoints.insert( searchID, new SearchPoint );
     }
-    return 0;
+    SearchPoint* sp = *sIt;
+    sp->it_begin = TextList::ConstIterator( &m_words, first );
+    sp->it_end = TextList::ConstIterator( &m_words, last );
+    sp->offset_begin = match - m_searchOffsets.at( first );
+    sp->offset_end = match + length - m_searchOffsets.at( last );
+    return searchPointToArea(sp);
 }
 
 QString TextPage::text(const RegularAreaRect *area) const
@@ -1075,6 +1050,8 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     if ( area && area->isNull() )
         return QString();
 
+    // the words are appended as characters, as appending a string to an
+    // empty one shares its data, which belongs to the list
     TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
     QString ret;
     if ( area )
@@ -1085,7 +1062,8 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
             {
                 if ( area->intersects( (*it)->area ) )
                 {
-                    ret += (*it)->text();
+                    const QString word = (*it)->rawText();
+                    ret.append( word.constData(), word.length() );
                 }
             }
             else
@@ -1093,7 +1071,8 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
                 NormalizedPoint center = (*it)->area.center();
                 if ( area->contains( center.x, center.y ) )
                 {
-                    ret += (*it)->text();
+                    const QString word = (*it)->rawText();
+                    ret.append( word.constData(), word.length() );
                 }
             }
         }
@@ -1101,7 +1080,10 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     else
     {
         for ( ; it != itEnd; ++it )
-            ret += (*it)->text();
+        {
+            const QString word = (*it)->rawText();
+            ret.append( word.constData(), word.length() );
+        }
     }
     return ret;
 }
@@ -1125,25 +1107,32 @@ static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWi
 /**
  * Sets a new world list. Deleting the contents of the old one
  */
-void TextPagePrivate::setWordList(const TextList &list)
+void TextPagePrivate::setWordList(const TinyTextEntityList &list)
 {
-    qDeleteAll(m_words);
-    m_words = list;
+    m_words.clear();
+    invalidateSearchText();
+    foreach(TinyTextEntity *te, list)
+    {
+        m_words.append(te->text(), te->area);
+    }
+    m_words.squeeze();
+    qDeleteAll(list);
 }
 
 /**
  * Remove all the spaces in between texts. It will make all the generators
  * same, whether they save spaces(like pdf) or not(like djvu).
  */
-static void removeSpace(TextList *words)
+static void removeSpace(TinyTextEntityList *words)
 {
-    TextList::Iterator it = words->begin();
+    TinyTextEntityList::Iterator it = words->begin();
     const QString str(' ');
 
     while ( it != words->end() )
     {
         if((*it)->text() == str)
         {
+            delete *it;
             it = words->erase(it);
         }
         else
@@ -1160,7 +1149,7 @@ static void removeSpace(TextList *words)
  * WordsWithCharacters memory has to be managed by the caller, both the 
  * WordWithCharacters::word and WordWithCharacters::characters contents
  */
-static WordsWithCharacters makeWordFromCharacters(const TextList &characters, int pageWidth, int pageHeight)
+static WordsWithCharacters makeWordFromCharacters(const TinyTextEntityList &characters, int pageWidth, int pageHeight)
 {
     /**
      * We will traverse characters and try to create words from the TinyTextEntities in it.
@@ -1175,7 +1164,7 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
      */
     WordsWithCharacters wordsWithCharacters;
 
-    TextList::ConstIterator it = characters.begin(), itEnd = characters.end(), tmpIt;
+    TinyTextEntityList::ConstIterator it = characters.begin(), itEnd = characters.end(), tmpIt;
     int newLeft,newRight,newTop,newBottom;
     int index = 0;
 
@@ -1184,7 +1173,7 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
         QString textString = (*it)->text();
         QString newString;
         QRect lineArea = (*it)->area.roundedGeometry(pageWidth,pageHeight),elementArea;
-        TextList wordCharacters;
+        TinyTextEntityList wordCharacters;
         tmpIt = it;
         int space = 0;
 
@@ -1883,7 +1872,12 @@ void TextPagePrivate::correctTextOrder()
     const int pageWidth  = (int) (scalingFactor * m_page->m_page->width() );
     const int pageHeight = (int) (scalingFactor * m_page->m_page->height());
 
-    TextList characters = m_words;
+    TinyTextEntityList characters;
+    const TextList::ConstIterator itEnd = m_words.constEnd();
+    for ( TextList::ConstIterator it = m_words.constBegin(); it != itEnd; ++it )
+    {
+        characters.append( new TinyTextEntity( (*it)->rawText(), (*it)->area ) );
+    }
 
     /**
      * Remove spaces from the text
@@ -1894,6 +1888,7 @@ void TextPagePrivate::correctTextOrder()
      * Construct words from characters
      */
     const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
+    qDeleteAll(characters);
 
     /**
      * Make a XY Cut tree for segmentation of the texts
@@ -1908,7 +1903,7 @@ void TextPagePrivate::correctTextOrder()
     /**
      * Break the words into characters
      */
-    TextList listOfCharacters;
+    TinyTextEntityList listOfCharacters;
     foreach(const WordWithCharacters &word, listWithWordsAndSpaces)
     {
         delete word.word;
@@ -1925,8 +1920,9 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
     TextEntity::List ret;
     if ( area )
     {
-        foreach (TinyTextEntity *te, d->m_words)
+        for ( TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd(); it != itEnd; ++it )
         {
+            const TextListEntry te = *it;
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
                 if ( area->intersects( te->area ) )
@@ -1946,8 +1942,9 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
     }
     else
     {
-        foreach (TinyTextEntity *te, d->m_words)
+        for ( TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd(); it != itEnd; ++it )
         {
+            const TextListEntry te = *it;
             ret.append( new TextEntity( te->text(), new Okular::NormalizedRect( te->area) ) );
         }
     }
@@ -1970,7 +1967,7 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
     QString text;
     if ( posIt != itEnd )
     {
-        if ( (*posIt)->text().simplified().isEmpty() )
+        if ( (*posIt)->rawText().simplified().isEmpty() )
         {
             return NULL;
         }
@@ -1978,7 +1975,7 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
         while ( posIt != itBegin )
         {
             --posIt;
-            const QString itText = (*posIt)->text();
+            const QString itText = (*posIt)->rawText();
             if ( itText.right(1).at(0).isSpace() )
             {
                 if (itText.endsWith("-\n"))
@@ -1991,7 +1988,7 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
                 if (itText == "\n" && posIt != itBegin )
                 {
                     --posIt;
-                    if ((*posIt)->text().endsWith("-")) {
+                    if ((*posIt)->rawText().endsWith("-")) {
                         // Is an hyphenated word
                         // continue searching the start of the word back
                         continue;
@@ -2006,14 +2003,14 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
         RegularAreaRect *ret = new RegularAreaRect();
         for ( ; posIt != itEnd; ++posIt )
         {
-            const QString itText = (*posIt)->text();
+            const QString itText = (*posIt)->rawText();
             if ( itText.simplified().isEmpty() )
             {
                 break;
             }
             
             ret->appendShape( (*posIt)->area );
-            text += (*posIt)->text();
+            text.append( itText.constData(), itText.length() );
             if (itText.right(1).at(0).isSpace())
             {
                 if (!text.endsWith("-\n"))
@@ -12,10 +12,12 @@
 
 #include <QtCore/QList>
 #include <QtCore/QString>
+#include <QtCore/QVector>
 
 #include "okularcore_export.h"
 #include "global.h"
 
+class QRegularExpression;
 class QTransform;
 
 namespace Okular {
@@ -92,6 +94,7 @@ class OKULARCORE_EXPORT TextPage
     /// @cond PRIVATE
     friend class Page;
     friend class PagePrivate;
+    friend class TextIndex;
     /// @endcond
 
     public:
@@ -141,6 +144,15 @@ class OKULARCORE_EXPORT TextPage
         RegularAreaRect* findText( int id, const QString &text, SearchDirection direction,
                                    Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *lastRect );
 
+        /**
+         * Returns the bounding rects of all the matches of @p pattern in the
+         * text of the page, which spans the words as for findText(). Empty
+         * matches are skipped. The caller takes ownership of the returned areas.
+         *
+         * @since 0.24
+         */
+        QVector< RegularAreaRect * > findAll( const QRegularExpression &pattern );
+
         /**
          * Text extraction function.
          *
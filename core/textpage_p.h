@@ -14,8 +14,13 @@
 #include <QtCore/QList>
 #include <QtCore/QMap>
 #include <QtCore/QPair>
+#include <QtCore/QVector>
 #include <QtGui/QTransform>
 
+#include <algorithm>
+
+#include "area.h"
+
 class SearchPoint;
 class TinyTextEntity;
 class RegionText;
@@ -24,13 +29,173 @@ namespace Okular
 {
 
 class PagePrivate;
-typedef QList< TinyTextEntity* > TextList;
+class TextList;
 
 /**
- * Returns whether the two strings match.
- * Satisfies the condition that if two strings match then their lengths are equal.
+ * List of TinyTextEntity, used while the text of a page is laid out.
  */
-typedef bool ( *TextComparisonFunction )( const QStringRef & from, const QStringRef & to );
+typedef QList< TinyTextEntity* > TinyTextEntityList;
+
+/**
+ * A word of a TextList, as given by its iterators.
+ */
+class TextListEntry
+{
+    public:
+        TextListEntry( const TextList *list, int index );
+
+        inline const TextListEntry *operator->() const
+        {
+            return this;
+        }
+
+        /**
+         * The text of the word, as a copy that outlives the list.
+         */
+        QString text() const;
+
+        /**
+         * The text of the word without copying it. It refers to the data of
+         * the list, so it must not be kept nor leave the text page.
+         */
+        QString rawText() const;
+
+        inline NormalizedRect transformedArea( const QTransform &matrix ) const
+        {
+            NormalizedRect transformed_area = area;
+            transformed_area.transform( matrix );
+            return transformed_area;
+        }
+
+        NormalizedRect area;
+
+    private:
+        const TextList *m_list;
+        int m_index;
+};
+
+/**
+ * The words of a text page, stored without one allocation per word: the
+ * text of all the words is in a single UTF-16 buffer, with the offset where
+ * each word starts, and their areas are kept as floats in a single array.
+ */
+class TextList
+{
+    public:
+        class ConstIterator
+        {
+            public:
+                ConstIterator() : m_list( 0 ), m_index( -1 ) {}
+                ConstIterator( const TextList *list, int index ) : m_list( list ), m_index( index ) {}
+
+                inline TextListEntry operator*() const { return TextListEntry( m_list, m_index ); }
+                inline int index() const { return m_index; }
+
+                inline ConstIterator &operator++() { ++m_index; return *this; }
+                inline ConstIterator operator++( int ) { ConstIterator it = *this; ++m_index; return it; }
+                inline ConstIterator &operator--() { --m_index; return *this; }
+                inline ConstIterator operator--( int ) { ConstIterator it = *this; --m_index; return it; }
+                inline ConstIterator operator+( int j ) const { return ConstIterator( m_list, m_index + j ); }
+                inline ConstIterator operator-( int j ) const { return ConstIterator( m_list, m_index - j ); }
+
+                inline bool operator==( const ConstIterator &other ) const { return m_list == other.m_list && m_index == other.m_index; }
+                inline bool operator!=( const ConstIterator &other ) const { return !( *this == other ); }
+                inline bool operator<( const ConstIterator &other ) const { return m_index < other.m_index; }
+                inline bool operator<=( const ConstIterator &other ) const { return m_index <= other.m_index; }
+                inline bool operator>( const ConstIterator &other ) const { return m_index > other.m_index; }
+                inline bool operator>=( const ConstIterator &other ) const { return m_index >= other.m_index; }
+
+            private:
+                const TextList *m_list;
+                int m_index;
+        };
+
+        TextList();
+
+        void append( const QString &text, const NormalizedRect &area );
+        void clear();
+        /**
+         * Releases the memory reserved for words not appended yet.
+         */
+        void squeeze();
+
+        /**
+         * Returns the memory allocated for the words, in bytes.
+         */
+        qulonglong memoryUsage() const;
+
+        inline int count() const { return m_offsets.count() - 1; }
+        inline bool isEmpty() const { return count() == 0; }
+
+        inline const QChar *textData( int index ) const { return m_text.constData() + m_offsets.at( index ); }
+        inline int textLength( int index ) const { return m_offsets.at( index + 1 ) - m_offsets.at( index ); }
+        inline NormalizedRect area( int index ) const
+        {
+            const float *area = m_areas.constData() + 4 * index;
+            return NormalizedRect( area[0], area[1], area[2], area[3] );
+        }
+
+        inline ConstIterator constBegin() const { return ConstIterator( this, 0 ); }
+        inline ConstIterator constEnd() const { return ConstIterator( this, count() ); }
+
+    private:
+        QString m_text;
+        // where each word starts in m_text, followed by the end of the last one
+        QVector< int > m_offsets;
+        // left, top, right and bottom of each word
+        QVector< float > m_areas;
+
+        Q_DISABLE_COPY( TextList )
+};
+
+inline TextListEntry::TextListEntry( const TextList *list, int index )
+    : area( list->area( index ) ), m_list( list ), m_index( index )
+{
+}
+
+inline QString TextListEntry::text() const
+{
+    return QString( m_list->textData( m_index ), m_list->textLength( m_index ) );
+}
+
+inline QString TextListEntry::rawText() const
+{
+    return QString::fromRawData( m_list->textData( m_index ), m_list->textLength( m_index ) );
+}
+
+/**
+ * Finds a pattern in a text with the Boyer-Moore-Horspool algorithm, in
+ * either direction. The shifts are indexed by the low byte of the UTF-16
+ * code units, which keeps the tables small and the shifts safe.
+ */
+class TextMatcher
+{
+    public:
+        explicit TextMatcher( const QString &pattern );
+
+        /**
+         * Returns the position of the first match in @p text starting at or
+         * after @p from, or -1 if there is none.
+         */
+        int indexIn( const QString &text, int from ) const;
+
+        /**
+         * Returns the position of the last match in @p text ending at or
+         * before @p to, or -1 if there is none.
+         */
+        int lastIndexIn( const QString &text, int to ) const;
+
+        inline const QString &pattern() const { return m_pattern; }
+
+    private:
+        QString m_pattern;
+        // shift of the window when scanning forward, for the last character
+        // of the window, and when scanning backward, for its first character
+        int m_forwardShifts[ 256 ];
+        int m_backwardShifts[ 256 ];
+
+        Q_DISABLE_COPY( TextMatcher )
+};
 
 /**
  * A list of RegionText. It keeps a bunch of TextList with their bounding rectangles
@@ -43,21 +208,44 @@ class TextPagePrivate
         TextPagePrivate();
         ~TextPagePrivate();
 
-        RegularAreaRect * findTextInternalForward( int searchID, const QString &query,
-                                                   TextComparisonFunction comparer,
-                                                   const TextList::ConstIterator &start,
-                                                   int start_offset,
-                                                   const TextList::ConstIterator &end);
-        RegularAreaRect * findTextInternalBackward( int searchID, const QString &query,
-                                                    TextComparisonFunction comparer,
-                                                    const TextList::ConstIterator &start,
-                                                    int start_offset,
-                                                    const TextList::ConstIterator &end );
+        /**
+         * Finds the first match of @p query after @p position in the search
+         * text, or the last one before it if @p forward is false, and saves
+         * it as the search point of @p searchID.
+         */
+        RegularAreaRect * findTextInternal( int searchID, const QString &query,
+                                            Qt::CaseSensitivity caseSensitivity,
+                                            bool forward, int position );
+
+        /**
+         * Builds the search text of the words, unless it is already built.
+         */
+        void buildSearchText();
+
+        /**
+         * The words changed, so their search text has to be built again.
+         */
+        void invalidateSearchText();
+
+        /**
+         * Returns the position in the search text of the character at
+         * @p offset in the word at @p index.
+         */
+        inline int searchPosition( int index, int offset ) const { return m_searchOffsets.at( index ) + offset; }
 
         /**
-         * Copy a TextList to m_words, the pointers of list are adopted
+         * Returns the index of the word containing the character at
+         * @p position in the search text.
          */
-        void setWordList(const TextList &list);
+        inline int searchWord( int position ) const
+        {
+            return ( std::upper_bound( m_searchOffsets.constBegin(), m_searchOffsets.constEnd(), position ) - m_searchOffsets.constBegin() ) - 1;
+        }
+
+        /**
+         * Copy a TinyTextEntityList to m_words, the entities of list are deleted
+         */
+        void setWordList(const TinyTextEntityList &list);
 
         /**
          * Make necessary modifications in the TextList to make the text order correct, so
@@ -65,11 +253,36 @@ class TextPagePrivate
          */
         void correctTextOrder();
 
+        /**
+         * Returns the text searches match against, that is the text of the
+         * words without the hyphens breaking them across lines, and sets the
+         * offset in it where each word starts and, unless @p areas is 0, the
+         * area of each word.
+         */
+        QString searchableText( QVector< int > *offsets, QVector< NormalizedRect > *areas ) const;
+
+        /**
+         * Returns the memory used by the text page, in bytes.
+         */
+        qulonglong memoryUsage() const;
+
         // variables those can be accessed directly from TextPage
         TextList m_words;
         QMap< int, SearchPoint* > m_searchPoints;
         PagePrivate *m_page;
 
+        // searchableText() of the words and its case folded version, which
+        // is only built for the first case insensitive search; the offsets
+        // of the words in them are followed by their length
+        QString m_searchText;
+        QString m_foldedSearchText;
+        QVector< int > m_searchOffsets;
+
+        // the normalized, and possibly case folded, query of the last search
+        TextMatcher *m_matcher;
+        QString m_matcherQuery;
+        Qt::CaseSensitivity m_matcherCaseSensitivity;
+
     private:
         RegularAreaRect * searchPointToArea(const SearchPoint* sp);
 };
@@ -12,10 +12,24 @@
 #include "utils_p.h"
 
 #include <QtCore/QRect>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QImage>
+#include <QImageReader>
 #include <QIODevice>
+#include <QPixmap>
+
+#include <utility>
+
+#if defined( __SSE2__ ) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#include <emmintrin.h>
+#define OKULAR_UTILS_SSE2
+#endif
 
 #ifdef Q_WS_X11
   #include "config-okular.h"
@@ -304,56 +318,207 @@ QSizeF Utils::realDpi(QWidget*)
 }
 #endif
 
-inline static bool isWhite( QRgb argb ) {
+// the threads processing the bands of rows of the images, which may be
+// computing a bounding box in a thread of the global pool already
+Q_GLOBAL_STATIC( QThreadPool, rowBandPool )
+
+/* Processes a band of rows of an image on a thread of the pool. */
+class RowBandJob : public QRunnable
+{
+    public:
+        RowBandJob( RowBands::Function function, void *data, int band, int firstRow, int lastRow, QSemaphore *done )
+            : m_function( function ), m_data( data ), m_band( band ), m_firstRow( firstRow ), m_lastRow( lastRow ), m_done( done )
+        {
+        }
+
+        void run() Q_DECL_OVERRIDE
+        {
+            m_function( m_data, m_band, m_firstRow, m_lastRow );
+            m_done->release();
+        }
+
+    private:
+        RowBands::Function m_function;
+        void *m_data;
+        int m_band;
+        int m_firstRow;
+        int m_lastRow;
+        QSemaphore *m_done;
+};
+
+RowBands::RowBands( int width, int height, qint64 parallelPixels )
+    : m_height( height ), m_count( 1 )
+{
+    if ( (qint64)width * height >= parallelPixels )
+        m_count = qBound( 1, QThread::idealThreadCount(), height );
+    m_bandHeight = ( height + m_count - 1 ) / m_count;
+}
+
+int RowBands::count() const
+{
+    return m_count;
+}
+
+void RowBands::run( Function function, void *data ) const
+{
+    QSemaphore done;
+    for ( int band = 1; band < m_count; ++band )
+    {
+        const int firstRow = qMin( band * m_bandHeight, m_height );
+        rowBandPool()->start( new RowBandJob( function, data, band, firstRow, qMin( firstRow + m_bandHeight, m_height ), &done ) );
+    }
+    function( data, 0, 0, qMin( m_bandHeight, m_height ) );
+    done.acquire( m_count - 1 );
+}
+
+// images with fewer pixels are scanned by the calling thread only
+static const int ParallelBoundingBoxPixels = 1024 * 1024;
+
+/* Whether the pixel is white, as QImage::pixel() would return it; a
+ * premultiplied pixel is white when its color channels equal its alpha.
+ */
+inline static bool isWhite( QRgb argb, bool premultiplied ) {
+    if ( premultiplied )
+        return argb != 0 && argb == ( argb >> 24 ) * 0x01010101u;
     return ( argb & 0xFFFFFF ) == 0xFFFFFF; // ignore alpha
 }
 
+#ifdef OKULAR_UTILS_SSE2
+/* Whether the four pixels at @p pixels are white. */
+inline static bool areWhite( const QRgb *pixels, bool premultiplied ) {
+    __m128i quad = _mm_loadu_si128( reinterpret_cast< const __m128i * >( pixels ) );
+    __m128i white;
+    if ( premultiplied )
+    {
+        // a transparent pixel is not white
+        if ( _mm_movemask_epi8( _mm_cmpeq_epi32( quad, _mm_setzero_si128() ) ) != 0 )
+            return false;
+        const __m128i alpha = _mm_srli_epi32( quad, 24 );
+        white = _mm_or_si128( alpha, _mm_slli_epi32( alpha, 8 ) );
+        white = _mm_or_si128( white, _mm_slli_epi32( white, 16 ) );
+    }
+    else
+    {
+        quad = _mm_or_si128( quad, _mm_set1_epi32( int( 0xFF000000 ) ) );
+        white = _mm_set1_epi32( -1 );
+    }
+    return _mm_movemask_epi8( _mm_cmpeq_epi8( quad, white ) ) == 0xFFFF;
+}
+#endif
+
+/* Returns the first non-white pixel of @p row in [from, to), or -1. */
+static int firstNonWhite( const QRgb *row, int from, int to, bool premultiplied )
+{
+    int x = from;
+#ifdef OKULAR_UTILS_SSE2
+    for ( ; x + 4 <= to; x += 4 )
+        if ( !areWhite( row + x, premultiplied ) )
+            break;
+#endif
+    for ( ; x < to; ++x )
+        if ( !isWhite( row[ x ], premultiplied ) )
+            return x;
+    return -1;
+}
+
+/* Returns the last non-white pixel of @p row in [from, to), or -1. */
+static int lastNonWhite( const QRgb *row, int from, int to, bool premultiplied )
+{
+    int x = to;
+#ifdef OKULAR_UTILS_SSE2
+    for ( ; x - 4 >= from; x -= 4 )
+        if ( !areWhite( row + x - 4, premultiplied ) )
+            break;
+#endif
+    while ( x > from )
+        if ( !isWhite( row[ --x ], premultiplied ) )
+            return x;
+    return -1;
+}
+
+/* The non-white pixels of a band of rows of an image. */
+struct BoundingBoxBand
+{
+    // the bounds found, top is -1 if the band is blank
+    int top, bottom, left, right;
+};
+
+/* The bands of an image being scanned. */
+struct BoundingBoxScan
+{
+    const QImage *image;
+    bool premultiplied;
+    BoundingBoxBand *bands;
+};
+
+static void scanBoundingBoxBand( void *data, int bandIndex, int firstRow, int lastRow )
+{
+    BoundingBoxScan *scan = static_cast< BoundingBoxScan * >( data );
+    BoundingBoxBand *band = &scan->bands[ bandIndex ];
+    const int width = scan->image->width();
+    band->top = band->bottom = band->right = -1;
+    band->left = width;
+    for ( int y = firstRow; y < lastRow; ++y )
+    {
+        const QRgb *row = reinterpret_cast< const QRgb * >( scan->image->constScanLine( y ) );
+        const int first = firstNonWhite( row, 0, width, scan->premultiplied );
+        if ( first == -1 )
+            continue;
+
+        if ( band->top == -1 )
+            band->top = y;
+        band->bottom = y;
+        band->left = qMin( band->left, first );
+        // only the pixels right of the rightmost one found so far matter
+        band->right = qMax( band->right, lastNonWhite( row, qMax( first, band->right + 1 ), width, scan->premultiplied ) );
+    }
+}
+
 NormalizedRect Utils::imageBoundingBox( const QImage * image )
 {
     if ( !image )
         return NormalizedRect();
 
-    int width = image->width();
-    int height = image->height();
-    int left, top, bottom, right, x, y;
-
 #ifdef BBOX_DEBUG
     QTime time;
     time.start();
 #endif
 
-    // Scan pixels for top non-white
-    for ( top = 0; top < height; ++top )
-        for ( x = 0; x < width; ++x )
-            if ( !isWhite( image->pixel( x, top ) ) )
-                goto got_top;
-    return NormalizedRect( 0, 0, 0, 0 ); // the image is blank
-got_top:
-    left = right = x;
-
-    // Scan pixels for bottom non-white
-    for ( bottom = height-1; bottom >= top; --bottom )
-        for ( x = width-1; x >= 0; --x )
-            if ( !isWhite( image->pixel( x, bottom ) ) )
-                goto got_bottom;
-    Q_ASSERT( 0 ); // image changed?!
-got_bottom:
-    if ( x < left )
-        left = x;
-    if ( x > right )
-        right = x;
-
-    // Scan for leftmost and rightmost (we already found some bounds on these):
-    for ( y = top; y <= bottom && ( left > 0 || right < width-1 ); ++y )
+    // the rows are scanned as 32 bit pixels
+    QImage converted;
+    if ( image->format() != QImage::Format_RGB32 && image->format() != QImage::Format_ARGB32
+         && image->format() != QImage::Format_ARGB32_Premultiplied )
     {
-        for ( x = 0; x < left; ++x )
-            if ( !isWhite( image->pixel( x, y ) ) )
-                left = x;
-        for ( x = width-1; x > right+1; --x )
-            if ( !isWhite( image->pixel( x, y ) ) )
-                right = x;
+        converted = image->convertToFormat( QImage::Format_ARGB32 );
+        image = &converted;
     }
 
+    const int width = image->width();
+    const int height = image->height();
+
+    // the rows are split in bands scanned by several threads
+    const RowBands rowBands( width, height, ParallelBoundingBoxPixels );
+    QVector< BoundingBoxBand > bands( rowBands.count() );
+    BoundingBoxScan scan;
+    scan.image = image;
+    scan.premultiplied = image->format() == QImage::Format_ARGB32_Premultiplied;
+    scan.bands = bands.data();
+    rowBands.run( scanBoundingBoxBand, &scan );
+
+    int top = -1, bottom = -1, left = width, right = -1;
+    foreach ( const BoundingBoxBand &band, bands )
+    {
+        if ( band.top == -1 )
+            continue;
+        if ( top == -1 )
+            top = band.top;
+        bottom = band.bottom;
+        left = qMin( left, band.left );
+        right = qMax( right, band.right );
+    }
+    if ( top == -1 )
+        return NormalizedRect( 0, 0, 0, 0 ); // the image is blank
+
     NormalizedRect bbox( QRect( left, top, ( right - left + 1), ( bottom - top + 1 ) ),
                          image->width(), image->height() );
 
@@ -364,6 +529,23 @@ got_bottom:
     return bbox;
 }
 
+QImage Utils::scaledImage( QImageReader *reader, const QSize &size )
+{
+    // only the downscaling can be done by the codecs, and only for some formats
+    const QSize fullSize = reader->size();
+    if ( size.isValid() && reader->supportsOption( QImageIOHandler::ScaledSize )
+         && fullSize.isValid() && size.width() < fullSize.width() && size.height() < fullSize.height() )
+    {
+        reader->setScaledSize( size );
+    }
+
+    QImage image = reader->read();
+    if ( !image.isNull() && size.isValid() && image.size() != size )
+        image = image.scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+
+    return image;
+}
+
 void Okular::copyQIODevice( QIODevice *from, QIODevice *to )
 {
     QByteArray buffer( 65536, '\0' );
@@ -399,4 +581,25 @@ QTransform Okular::buildRotationMatrix(Rotation rotation)
     return matrix;
 }
 
+void Okular::convertToPixmapFormat( QImage *image )
+{
+    if ( image->isNull() )
+        return;
+
+    const QImage::Format format = image->hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    if ( image->format() != format )
+        *image = image->convertToFormat( format );
+}
+
+QPixmap Okular::pixmapFromImage( QImage *image )
+{
+    QImage adopted;
+    adopted.swap( *image );
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 3, 0 )
+    return QPixmap::fromImage( std::move( adopted ) );
+#else
+    return QPixmap::fromImage( adopted );
+#endif
+}
+
 /* kate: replace-tabs on; indent-width 4; */
@@ -15,6 +15,8 @@
 
 class QRect;
 class QImage;
+class QImageReader;
+class QSize;
 class QWidget;
 
 namespace Okular
@@ -83,6 +85,21 @@ class OKULARCORE_EXPORT Utils
      * @since 0.7 (KDE 4.1)
      */
     static NormalizedRect imageBoundingBox( const QImage* image );
+
+    /**
+     * Reads the image of @p reader scaled to @p size.
+     *
+     * When the image format supports it, the codec is asked to decode the
+     * image directly at a reduced resolution (JPEG images, for instance, are
+     * decoded at 1/2, 1/4 or 1/8 of their size), so that only an image
+     * slightly larger than @p size is resampled, instead of decoding the
+     * image at full resolution and scaling it down.
+     *
+     * Returns a null image if the image can't be read.
+     *
+     * @since 0.24
+     */
+    static QImage scaledImage( QImageReader *reader, const QSize &size );
 };
 
 }
@@ -10,7 +10,12 @@
 #ifndef _OKULAR_UTILS_P_H_
 #define _OKULAR_UTILS_P_H_
 
+#include "global.h"
+
+class QImage;
 class QIODevice;
+class QPixmap;
+class QTransform;
 
 namespace Okular
 {
@@ -22,6 +27,55 @@ void copyQIODevice( QIODevice *from, QIODevice *to );
  */
 QTransform buildRotationMatrix( Rotation rotation );
 
+/**
+ * Converts @p image to the format a QPixmap would store it in, so that
+ * pixmapFromImage() does not need to convert it. Unlike the pixmap creation,
+ * this can be done in any thread.
+ */
+void convertToPixmapFormat( QImage *image );
+
+/**
+ * Returns a pixmap with the contents of @p image, which is cleared.
+ *
+ * If @p image was the only reference to its data and is already in the
+ * format given by convertToPixmapFormat(), the pixmap takes over the data
+ * of the image instead of copying it (on platforms with raster pixmaps).
+ */
+QPixmap pixmapFromImage( QImage *image );
+
+/**
+ * The bands of rows an image is split in, to be processed by several
+ * threads. Images with fewer pixels than given make a single band.
+ */
+class RowBands
+{
+    public:
+        /**
+         * Processes the rows from @p firstRow to @p lastRow (excluded) of
+         * the band @p band, with the @p data given to run().
+         */
+        typedef void (*Function)( void *data, int band, int firstRow, int lastRow );
+
+        RowBands( int width, int height, qint64 parallelPixels );
+
+        /**
+         * Returns the number of bands.
+         */
+        int count() const;
+
+        /**
+         * Calls @p function for each band and waits for all of them: the
+         * first band is processed by the calling thread, the other ones by
+         * a thread pool of the bands.
+         */
+        void run( Function function, void *data ) const;
+
+    private:
+        int m_height;
+        int m_count;
+        int m_bandHeight;
+};
+
 }
 
 #endif
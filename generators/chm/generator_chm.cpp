@@ -226,6 +226,7 @@ void CHMGenerator::slotCompleted()
 
     if ( !req->page()->isBoundingBoxKnown() )
         updatePageBoundingBox( req->page()->number(), Okular::Utils::imageBoundingBox( &image ) );
+    req->applyColors( &image );
     req->page()->setPixmap( req->observer(), new QPixmap( QPixmap::fromImage( image ) ) );
     signalPixmapRequestDone( req );
 }
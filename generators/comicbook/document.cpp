@@ -9,6 +9,10 @@
 
 #include "document.h"
 
+#include <QtCore/QBuffer>
+#include <QtCore/QRect>
+#include <QtCore/qmath.h>
+#include <QtCore/QRunnable>
 #include <QtCore/QScopedPointer>
 #include <QtGui/QImage>
 #include <QtGui/QImageReader>
@@ -22,6 +26,7 @@
 #include <memory>
 
 #include <core/page.h>
+#include <core/utils.h>
 
 #include "debug_comicbook.h"
 #include "directory.h"
@@ -30,6 +35,71 @@
 
 using namespace ComicBook;
 
+// how many pages are decoded ahead of the one being read
+static const int PrefetchPageCount = 2;
+
+// smaller images, like thumbnails, are not requested while reading, so the
+// pages after them are not decoded ahead
+static const int MinPrefetchPixels = 512 * 512;
+
+namespace ComicBook {
+
+class PrefetchJob : public QRunnable
+{
+    public:
+        PrefetchJob( const Document *document, int page, const QSize &size )
+            : mDocument( document ), mPage( page ), mSize( size )
+        {
+        }
+
+        void run() Q_DECL_OVERRIDE
+        {
+            const QSize imageSize = mSize.isValid() ? mSize : mDocument->mPageSizes.at( mPage );
+            mDocument->prefetchDone( PrefetchKey( mPage, imageSize ), mDocument->decodePage( mPage, mSize ) );
+        }
+
+    private:
+        const Document *mDocument;
+        int mPage;
+        QSize mSize;
+};
+
+}
+
+/**
+ * Returns the size of the image read from @p dev, reading only its header
+ * when possible, or an invalid size if it is not an image.
+ */
+static QSize imageSize( QIODevice *dev )
+{
+    // most formats have the size in their header, so avoid reading (and
+    // decompressing) the whole entry
+    QByteArray data = dev->read( 64 * 1024 );
+    {
+        QBuffer header( &data );
+        header.open( QIODevice::ReadOnly );
+        QImageReader reader( &header );
+        if ( !reader.canRead() )
+            return QSize();
+
+        const QSize size = reader.size();
+        if ( size.isValid() )
+            return size;
+    }
+
+    data += dev->readAll();
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::ReadOnly );
+    QImageReader reader( &buffer );
+    QSize size = reader.size();
+    if ( !size.isValid() ) {
+        const QImage i = reader.read();
+        if ( !i.isNull() )
+            size = i.size();
+    }
+    return size;
+}
+
 static void imagesInArchive( const QString &prefix, const KArchiveDirectory* dir, QStringList *entries )
 {
     Q_FOREACH ( const QString &entry, dir->entries() ) {
@@ -44,12 +114,13 @@ static void imagesInArchive( const QString &prefix, const KArchiveDirectory* dir
 
 
 Document::Document()
-    : mDirectory( 0 ), mUnrar( 0 ), mArchive( 0 )
+    : mDirectory( 0 ), mUnrar( 0 ), mArchive( 0 ), mTilePage( -1 )
 {
 }
 
 Document::~Document()
 {
+    stopPrefetching();
 }
 
 bool Document::open( const QString &fileName )
@@ -128,6 +199,14 @@ void Document::close()
     if ( !( mArchive || mUnrar || mDirectory ) )
         return;
 
+    stopPrefetching();
+
+    {
+        QMutexLocker locker( &mTileMutex );
+        mTilePage = -1;
+        mTileData.clear();
+    }
+
     delete mArchive;
     mArchive = 0;
     delete mDirectory;
@@ -135,6 +214,8 @@ void Document::close()
     delete mUnrar;
     mUnrar = 0;
     mPageMap.clear();
+    mArchivePages.clear();
+    mPageSizes.clear();
     mEntries.clear();
 }
 
@@ -169,10 +250,11 @@ void Document::pages( QVector<Okular::Page*> * pagesVector )
     int count = 0;
     pagesVector->clear();
     pagesVector->resize( mEntries.size() );
-    QImageReader reader;
     foreach(const QString &file, mEntries) {
+        const KArchiveFile *entry = 0;
+        dev.reset();
         if ( mArchive ) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
+            entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
             if ( entry ) {
                 dev.reset( entry->createDevice() );
             }
@@ -183,22 +265,15 @@ void Document::pages( QVector<Okular::Page*> * pagesVector )
         }
 
         if ( ! dev.isNull() ) {
-            reader.setDevice( dev.data() );
-            if ( reader.canRead() )
-            {
-                QSize pageSize = reader.size();
-                if ( !pageSize.isValid() ) {
-                    const QImage i = reader.read();
-                    if ( !i.isNull() )
-                        pageSize = i.size();
-                }
-                if ( pageSize.isValid() ) {
-                    pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
-                    mPageMap.append(file);
-                    count++;
-                } else {
-                    qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
-                }
+            const QSize pageSize = imageSize( dev.data() );
+            if ( pageSize.isValid() ) {
+                pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
+                mPageMap.append(file);
+                mArchivePages.append(entry);
+                mPageSizes.append(pageSize);
+                count++;
+            } else {
+                qCDebug(OkularComicbookDebug) << "Ignoring" << file << "as it doesn't seem to be an image";
             }
         }
     }
@@ -210,19 +285,154 @@ QStringList Document::pageTitles() const
     return QStringList();
 }
 
-QImage Document::pageImage( int page ) const
+QImage Document::pageImage( int page, const QSize &size ) const
 {
-    if ( mArchive ) {
-        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( mPageMap[ page ] ) );
-        if ( entry )
-            return QImage::fromData( entry->data() );
-    } else if ( mDirectory ) {
-        return QImage( mPageMap[ page ] );
+    const QSize pageSize = mPageSizes.at( page );
+    const QSize imageSize = size.isValid() ? size : pageSize;
+
+    const bool prefetch = imageSize.width() * imageSize.height() >= MinPrefetchPixels;
+
+    // the next pages, at the size they are going to be requested at
+    QVector<QSize> nextSizes;
+    QSet<PrefetchKey> nextKeys;
+    for ( int i = 1; prefetch && i <= PrefetchPageCount && page + i < mPageSizes.count(); ++i ) {
+        const QSize nextPageSize = mPageSizes.at( page + i );
+        QSize nextSize;
+        if ( size.isValid() ) {
+            nextSize = QSize( qMax( 1, qRound( (qreal)nextPageSize.width() * size.width() / pageSize.width() ) ),
+                              qMax( 1, qRound( (qreal)nextPageSize.height() * size.height() / pageSize.height() ) ) );
+        }
+        nextSizes.append( nextSize );
+        nextKeys.insert( PrefetchKey( page + i, nextSize.isValid() ? nextSize : nextPageSize ) );
+    }
+
+    QImage image;
+    {
+        QMutexLocker locker( &mPrefetchMutex );
+        const PrefetchKey key( page, imageSize );
+        while ( mPrefetching.contains( key ) )
+            mPrefetchCondition.wait( &mPrefetchMutex );
+
+        image = mPrefetched.take( key );
+
+        // forget the pages decoded ahead of a page the reader moved away
+        // from, or at a size they are not read at anymore
+        if ( prefetch ) {
+            QHash<PrefetchKey, QImage>::iterator it = mPrefetched.begin();
+            while ( it != mPrefetched.end() ) {
+                if ( !nextKeys.contains( it.key() ) )
+                    it = mPrefetched.erase( it );
+                else
+                    ++it;
+            }
+        }
+    }
+
+    if ( image.isNull() )
+        image = decodePage( page, size );
+
+    for ( int i = 0; i < nextSizes.count(); ++i )
+        prefetchPage( page + 1 + i, nextSizes.at( i ) );
+
+    return image;
+}
+
+QImage Document::pageTile( int page, const QSize &size, const QRect &rect ) const
+{
+    const QSize pageSize = mPageSizes.at( page );
+    if ( !size.isValid() || !pageSize.isValid() || rect.isEmpty() )
+        return QImage();
+
+    // the area of the page image the tile covers
+    const qreal xScale = (qreal)pageSize.width() / size.width();
+    const qreal yScale = (qreal)pageSize.height() / size.height();
+    const QRect clipRect = QRect( qFloor( rect.left() * xScale ), qFloor( rect.top() * yScale ),
+                                  qCeil( rect.width() * xScale ), qCeil( rect.height() * yScale ) )
+                           & QRect( QPoint( 0, 0 ), pageSize );
+    if ( clipRect.isEmpty() )
+        return QImage();
+
+    QImage image;
+    if ( mDirectory ) {
+        QImageReader reader( mPageMap[ page ] );
+        reader.setClipRect( clipRect );
+        reader.setScaledSize( rect.size() );
+        image = reader.read();
     } else {
-        return QImage::fromData( mUnrar->contentOf( mPageMap[ page ] ) );
+        QMutexLocker locker( &mTileMutex );
+        if ( mTilePage != page ) {
+            mTileData = pageData( page );
+            mTilePage = page;
+        }
+
+        QBuffer buffer( &mTileData );
+        buffer.open( QIODevice::ReadOnly );
+        QImageReader reader( &buffer );
+        reader.setClipRect( clipRect );
+        reader.setScaledSize( rect.size() );
+        image = reader.read();
+    }
+
+    return image;
+}
+
+QByteArray Document::pageData( int page ) const
+{
+    if ( mArchive ) {
+        const KArchiveFile *entry = mArchivePages.at( page );
+        if ( entry ) {
+            QMutexLocker locker( &mArchiveMutex );
+            return entry->data();
+        }
+    } else if ( mUnrar ) {
+        return mUnrar->contentOf( mPageMap[ page ] );
+    }
+
+    return QByteArray();
+}
+
+QImage Document::decodePage( int page, const QSize &size ) const
+{
+    if ( mDirectory ) {
+        QImageReader reader( mPageMap[ page ] );
+        return Okular::Utils::scaledImage( &reader, size );
     }
 
-    return QImage();
+    QByteArray data = pageData( page );
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::ReadOnly );
+    QImageReader reader( &buffer );
+    return Okular::Utils::scaledImage( &reader, size );
+}
+
+void Document::prefetchPage( int page, const QSize &size ) const
+{
+    const PrefetchKey key( page, size.isValid() ? size : mPageSizes.at( page ) );
+
+    QMutexLocker locker( &mPrefetchMutex );
+    if ( mPrefetching.contains( key ) || mPrefetched.contains( key ) )
+        return;
+
+    mPrefetching.insert( key );
+    mPrefetchPool.start( new PrefetchJob( this, page, size ) );
+}
+
+void Document::prefetchDone( const PrefetchKey &key, const QImage &image ) const
+{
+    QMutexLocker locker( &mPrefetchMutex );
+    mPrefetching.remove( key );
+    mPrefetched.insert( key, image );
+    mPrefetchCondition.wakeAll();
+}
+
+void Document::stopPrefetching()
+{
+    mPrefetchPool.clear();
+    mPrefetchPool.waitForDone();
+
+    QMutexLocker locker( &mPrefetchMutex );
+    mPrefetching.clear();
+    mPrefetched.clear();
 }
 
 QString Document::lastErrorString() const
@@ -10,12 +10,21 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QSize>
 #include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+#include <QtGui/QImage>
 
 class KArchiveDirectory;
+class KArchiveFile;
 class KArchive;
 class QImage;
-class QSize;
+class QRect;
 class Unrar;
 class Directory;
 
@@ -25,6 +34,27 @@ class Page;
 
 namespace ComicBook {
 
+/**
+ * A page decoded at a given size.
+ */
+struct PrefetchKey
+{
+    PrefetchKey( int p, const QSize &s ) : page( p ), size( s ) {}
+
+    bool operator==( const PrefetchKey &other ) const
+    {
+        return page == other.page && size == other.size;
+    }
+
+    int page;
+    QSize size;
+};
+
+inline uint qHash( const PrefetchKey &key )
+{
+    return ::qHash( key.page ) ^ ::qHash( ( key.size.width() << 16 ) ^ key.size.height() );
+}
+
 class Document
 {
     public:
@@ -37,20 +67,57 @@ class Document
         void pages( QVector<Okular::Page*> * pagesVector );
         QStringList pageTitles() const;
 
-        QImage pageImage( int page ) const;
+        /**
+         * Returns the image of the given page, scaled to @p size if it is
+         * valid, and starts decoding the following pages at the same scale
+         * in background threads.
+         */
+        QImage pageImage( int page, const QSize &size = QSize() ) const;
+
+        /**
+         * Returns the @p rect area of the given page scaled to @p size,
+         * decoding only that area when the image format allows it.
+         */
+        QImage pageTile( int page, const QSize &size, const QRect &rect ) const;
 
         QString lastErrorString() const;
 
     private:
         bool processArchive();
 
+        QByteArray pageData( int page ) const;
+        QImage decodePage( int page, const QSize &size ) const;
+        void prefetchPage( int page, const QSize &size ) const;
+        void prefetchDone( const PrefetchKey &key, const QImage &image ) const;
+        void stopPrefetching();
+
+        friend class PrefetchJob;
+
         QStringList mPageMap;
+        // the archive entries of the pages, looked up once
+        QVector<const KArchiveFile*> mArchivePages;
+        QVector<QSize> mPageSizes;
         Directory *mDirectory;
         Unrar *mUnrar;
         KArchive *mArchive;
         KArchiveDirectory *mArchiveDir;
         QString mLastErrorString;
         QStringList mEntries;
+
+        // serializes the reads from mArchive, which uses a single device
+        mutable QMutex mArchiveMutex;
+
+        mutable QThreadPool mPrefetchPool;
+        mutable QMutex mPrefetchMutex;
+        mutable QWaitCondition mPrefetchCondition;
+        mutable QSet<PrefetchKey> mPrefetching;
+        mutable QHash<PrefetchKey, QImage> mPrefetched;
+
+        // the encoded data of the page the last tile was decoded from, as
+        // the tiles of a page are requested one after the other
+        mutable QMutex mTileMutex;
+        mutable int mTilePage;
+        mutable QByteArray mTileData;
 };
 
 }
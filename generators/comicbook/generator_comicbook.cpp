@@ -42,6 +42,7 @@ ComicBookGenerator::ComicBookGenerator( QObject *parent, const QVariantList &arg
     : Generator( parent, args )
 {
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
 }
@@ -76,9 +77,11 @@ QImage ComicBookGenerator::image( Okular::PixmapRequest * request )
     int width = request->width();
     int height = request->height();
 
-    QImage image = mDocument.pageImage( request->pageNumber() );
+    if ( request->isTile() )
+        return mDocument.pageTile( request->pageNumber(), QSize( width, height ),
+                                   request->normalizedRect().geometry( width, height ) );
 
-    return image.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    return mDocument.pageImage( request->pageNumber(), QSize( width, height ) );
 }
 
 bool ComicBookGenerator::print( QPrinter& printer )
@@ -18,6 +18,8 @@
 #include <core/utils.h>
 #include <core/fileprinter.h>
 
+#include "settings_core.h"
+
 #include <qdom.h>
 #include <qmutex.h>
 #include <qpixmap.h>
@@ -68,6 +70,27 @@ static void recurseCreateTOC( QDomDocument &maindoc, const QDomNode &parent, QDo
     }
 }
 
+/**
+ * Returns how much memory the decoded pages (and the rendered pages) of the
+ * document can use, according to the memory level of the core.
+ */
+static qulonglong cacheMemory()
+{
+    const qulonglong MiB = 1024 * 1024;
+    switch ( Okular::SettingsCore::memoryLevel() )
+    {
+        case Okular::SettingsCore::EnumMemoryLevel::Low:
+            return 16 * MiB;
+        case Okular::SettingsCore::EnumMemoryLevel::Aggressive:
+            return 256 * MiB;
+        case Okular::SettingsCore::EnumMemoryLevel::Greedy:
+            return 1024 * MiB;
+        case Okular::SettingsCore::EnumMemoryLevel::Normal:
+        default:
+            return 64 * MiB;
+    }
+}
+
 static KAboutData createAboutData()
 {
     KAboutData aboutData(
@@ -88,6 +111,7 @@ DjVuGenerator::DjVuGenerator( QObject *parent, const QVariantList &args )
 {
     setFeature( TextExtraction );
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintPostscript );
     if ( Okular::FilePrinter::ps2pdfAvailable() )
         setFeature( PrintToFile );
@@ -129,7 +153,18 @@ bool DjVuGenerator::doCloseDocument()
 QImage DjVuGenerator::image( Okular::PixmapRequest *request )
 {
     userMutex()->lock();
-    QImage img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    const qulonglong memory = cacheMemory();
+    m_djvu->setCacheLimits( memory, memory );
+    QImage img;
+    if ( request->isTile() )
+    {
+        const QRect rect = request->normalizedRect().geometry( request->width(), request->height() );
+        img = m_djvu->tile( request->pageNumber(), request->width(), request->height(), rect );
+    }
+    else
+    {
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    }
     userMutex()->unlock();
     return img;
 }
@@ -13,10 +13,12 @@
 #include <qdom.h>
 #include <qfile.h>
 #include <qhash.h>
+#include <qlinkedlist.h>
 #include <qlist.h>
-#include <qpainter.h>
 #include <qqueue.h>
+#include <qrunnable.h>
 #include <qstring.h>
+#include <qthreadpool.h>
 
 #include <QtCore/QDebug>
 #include <KLocalizedString>
@@ -24,6 +26,7 @@
 #include <libdjvu/ddjvuapi.h>
 #include <libdjvu/miniexp.h>
 
+#include <limits.h>
 #include <stdio.h>
 #include <KDebug>
 
@@ -426,17 +429,95 @@ QRect KDjVu::TextEntity::rect() const
 }
 
 
+/**
+ * Renders the \p rect area of \p djvupage, scaled to \p width x \p height,
+ * into the same area of \p image, which is as large as the page or as
+ * large as the area.
+ */
+static int renderInto( ddjvu_format_t *format, ddjvu_page_t *djvupage, int width, int height,
+    const QRect &rect, QImage *image )
+{
+    ddjvu_rect_t renderrect;
+    renderrect.x = rect.x();
+    renderrect.y = rect.y();
+    renderrect.w = rect.width();
+    renderrect.h = rect.height();
+#ifdef KDJVU_DEBUG
+    kDebug() << "renderrect:" << renderrect;
+#endif
+    ddjvu_rect_t pagerect;
+    pagerect.x = 0;
+    pagerect.y = 0;
+    pagerect.w = width;
+    pagerect.h = height;
+#ifdef KDJVU_DEBUG
+    kDebug() << "pagerect:" << pagerect;
+#endif
+    uchar *buffer = image->bits();
+    if ( image->size() != rect.size() )
+        buffer += rect.y() * image->bytesPerLine() + rect.x() * 4;
+    int res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR,
+                  &pagerect, &renderrect, format, image->bytesPerLine(), (char *)buffer );
+#ifdef KDJVU_DEBUG
+    kDebug() << "rendering result:" << res;
+#endif
+    return res;
+}
+
+// RenderPartJob
+
+/**
+ * Renders a part of a page straight into its area of the page image.
+ */
+class RenderPartJob : public QRunnable
+{
+    public:
+        RenderPartJob( ddjvu_format_t *format, ddjvu_page_t *djvupage, int width, int height,
+                       const QRect &rect, QImage *image )
+          : m_format( format ), m_djvupage( djvupage ), m_width( width ), m_height( height ),
+            m_rect( rect ), m_image( image ), m_res( 0 )
+        {
+            setAutoDelete( false );
+        }
+
+        void run() Q_DECL_OVERRIDE
+        {
+            m_res = renderInto( m_format, m_djvupage, m_width, m_height, m_rect, m_image );
+        }
+
+        int result() const
+        {
+            return m_res;
+        }
+
+    private:
+        ddjvu_format_t *m_format;
+        ddjvu_page_t *m_djvupage;
+        int m_width;
+        int m_height;
+        QRect m_rect;
+        QImage *m_image;
+        int m_res;
+};
+
+
 class KDjVu::Private
 {
     public:
         Private()
           : m_djvu_cxt( 0 ), m_djvu_document( 0 ), m_format( 0 ), m_docBookmarks( 0 ),
+            m_pagesMemory( 0 ), m_maxPagesMemory( DefaultCacheMemory ),
+            m_imagesMemory( 0 ), m_maxImagesMemory( DefaultCacheMemory ),
             m_cacheEnabled( true )
         {
         }
 
-        QImage generateImageTile( ddjvu_page_t *djvupage, int& res,
-            int width, int row, int xdelta, int height, int col, int ydelta );
+        ddjvu_page_t *loadPage( int page );
+        void releasePages( qulonglong maxMemory, int pageToKeep );
+        void removeImage( int index );
+        void cleanupImages( qulonglong maxMemory );
+        QImage renderRect( ddjvu_page_t *djvupage, int& res,
+            int width, int height, const QRect &rect );
 
         void readBookmarks();
         void fillBookmarksRecurse( QDomDocument& maindoc, QDomNode& curnode,
@@ -452,8 +533,20 @@ class KDjVu::Private
 
         QVector<KDjVu::Page*> m_pages;
         QVector<ddjvu_page_t *> m_pages_cache;
-
+        // renders the parts of the large page images
+        QThreadPool m_renderPool;
+        // the pages in m_pages_cache, the most recently used first
+        QLinkedList<int> m_pagesLru;
+        QHash<int, QLinkedList<int>::iterator> m_pagesLruIndex;
+        // the memory accounted for each page in m_pages_cache
+        QVector<qulonglong> m_pagesCacheMemory;
+        qulonglong m_pagesMemory;
+        qulonglong m_maxPagesMemory;
+
+        // the most recently used first
         QList<ImageCacheItem*> mImgCache;
+        qulonglong m_imagesMemory;
+        qulonglong m_maxImagesMemory;
 
         QHash<QString, QVariant> m_metaData;
         QDomDocument * m_docBookmarks;
@@ -462,42 +555,89 @@ class KDjVu::Private
 
         bool m_cacheEnabled;
 
+        static const qulonglong DefaultCacheMemory;
         static unsigned int s_formatmask[4];
 };
 
+const qulonglong KDjVu::Private::DefaultCacheMemory = 64 * 1024 * 1024;
+
 unsigned int KDjVu::Private::s_formatmask[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
 
-QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
-    int width, int row, int xdelta, int height, int col, int ydelta )
+ddjvu_page_t *KDjVu::Private::loadPage( int page )
+{
+    ddjvu_page_t *djvupage = m_pages_cache.at( page );
+    if ( djvupage )
+    {
+        QLinkedList<int>::iterator &it = m_pagesLruIndex[page];
+        if ( it != m_pagesLru.begin() )
+        {
+            m_pagesLru.erase( it );
+            it = m_pagesLru.insert( m_pagesLru.begin(), page );
+        }
+        return djvupage;
+    }
+
+    djvupage = ddjvu_page_create_by_pageno( m_djvu_document, page );
+    // wait for the new page to be loaded
+    ddjvu_status_t sts;
+    while ( ( sts = ddjvu_page_decoding_status( djvupage ) ) < DDJVU_JOB_OK )
+        handle_ddjvu_messages( m_djvu_cxt, true );
+    m_pages_cache[page] = djvupage;
+    m_pagesLruIndex.insert( page, m_pagesLru.insert( m_pagesLru.begin(), page ) );
+
+    // djvulibre does not tell how much memory a decoded page takes; it
+    // keeps the page at its full resolution whatever it is rendered at,
+    // so account a byte per pixel of the page as stored in the file
+    const qulonglong memory = (qulonglong)qMax( ddjvu_page_get_width( djvupage ), 1 ) * qMax( ddjvu_page_get_height( djvupage ), 1 );
+    m_pagesCacheMemory[page] = memory;
+    m_pagesMemory += memory;
+
+    releasePages( m_maxPagesMemory, page );
+    return djvupage;
+}
+
+void KDjVu::Private::releasePages( qulonglong maxMemory, int pageToKeep )
+{
+    // release the least recently used decoded pages until they fit
+    QLinkedList<int>::iterator it = m_pagesLru.end();
+    while ( it != m_pagesLru.begin() && m_pagesMemory > maxMemory )
+    {
+        --it;
+        const int page = *it;
+        if ( page == pageToKeep )
+            continue;
+
+        ddjvu_page_release( m_pages_cache.at( page ) );
+        m_pages_cache[page] = 0;
+        m_pagesMemory -= m_pagesCacheMemory.at( page );
+        m_pagesCacheMemory[page] = 0;
+        m_pagesLruIndex.remove( page );
+        it = m_pagesLru.erase( it );
+    }
+}
+
+void KDjVu::Private::removeImage( int index )
+{
+    ImageCacheItem* item = mImgCache.takeAt( index );
+    m_imagesMemory -= qMin( m_imagesMemory, (qulonglong)item->img.byteCount() );
+    delete item;
+}
+
+void KDjVu::Private::cleanupImages( qulonglong maxMemory )
+{
+    while ( !mImgCache.isEmpty() && m_imagesMemory > maxMemory )
+        removeImage( mImgCache.count() - 1 );
+}
+
+QImage KDjVu::Private::renderRect( ddjvu_page_t *djvupage, int& res,
+    int width, int height, const QRect &rect )
 {
-    ddjvu_rect_t renderrect;
-    renderrect.x = row * xdelta;
-    renderrect.y = col * ydelta;
-    int realwidth = qMin( width - renderrect.x, xdelta );
-    int realheight = qMin( height - renderrect.y, ydelta );
-    renderrect.w = realwidth;
-    renderrect.h = realheight;
-#ifdef KDJVU_DEBUG
-    kDebug() << "renderrect:" << renderrect;
-#endif
-    ddjvu_rect_t pagerect;
-    pagerect.x = 0;
-    pagerect.y = 0;
-    pagerect.w = width;
-    pagerect.h = height;
-#ifdef KDJVU_DEBUG
-    kDebug() << "pagerect:" << pagerect;
-#endif
     handle_ddjvu_messages( m_djvu_cxt, false );
-    QImage res_img( realwidth, realheight, QImage::Format_RGB32 );
+    QImage res_img( rect.width(), rect.height(), QImage::Format_RGB32 );
     // the following line workarounds a rare crash in djvulibre;
     // it should be fixed with >= 3.5.21
     ddjvu_page_get_width( djvupage );
-    res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR,
-                  &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char *)res_img.bits() );
-#ifdef KDJVU_DEBUG
-    kDebug() << "rendering result:" << res;
-#endif
+    res = renderInto( m_format, djvupage, width, height, rect, &res_img );
     handle_ddjvu_messages( m_djvu_cxt, false );
 
     return res_img;
@@ -685,6 +825,11 @@ bool KDjVu::openFile( const QString & fileName )
     d->m_pages.resize( numofpages );
     d->m_pages_cache.clear();
     d->m_pages_cache.resize( numofpages );
+    d->m_pagesCacheMemory.clear();
+    d->m_pagesCacheMemory.resize( numofpages );
+    d->m_pagesLru.clear();
+    d->m_pagesLruIndex.clear();
+    d->m_pagesMemory = 0;
 
     // get the document type
     QString doctype;
@@ -757,11 +902,15 @@ void KDjVu::closeFile()
     // releasing the djvu pages
     QVector<ddjvu_page_t *>::Iterator it = d->m_pages_cache.begin(), itEnd = d->m_pages_cache.end();
     for ( ; it != itEnd; ++it )
-        ddjvu_page_release( *it );
+        if ( *it )
+            ddjvu_page_release( *it );
     d->m_pages_cache.clear();
+    d->m_pagesCacheMemory.clear();
+    d->m_pagesLru.clear();
+    d->m_pagesLruIndex.clear();
+    d->m_pagesMemory = 0;
     // clearing the image cache
-    qDeleteAll( d->mImgCache );
-    d->mImgCache.clear();
+    d->cleanupImages( 0 );
     // clearing the old metadata
     d->m_metaData.clear();
     // cleaing the page names mapping
@@ -933,16 +1082,7 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
     }
     }
 
-    if ( !d->m_pages_cache.at( page ) )
-    {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( d->m_djvu_document, page );
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
-            handle_ddjvu_messages( d->m_djvu_cxt, true );
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
+    ddjvu_page_t *djvupage = d->loadPage( page );
 
 /*
     if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
@@ -965,31 +1105,40 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
     if ( ( xparts == 1 ) && ( yparts == 1 ) )
     {
          // only one part -- render at once with no need to auxiliary image
-         newimg = d->generateImageTile( djvupage, res,
-                 width, 0, xdelta, height, 0, ydelta );
+         newimg = d->renderRect( djvupage, res, width, height, QRect( 0, 0, width, height ) );
     }
     else
     {
-        // more than one part -- need to render piece-by-piece and to compose
-        // the results
+        // more than one part -- render them all at the same time, each
+        // one straight into its area of the image; djvulibre can render
+        // the same page from several threads, as long as only one of them
+        // handles the messages
         newimg = QImage( width, height, QImage::Format_RGB32 );
-        QPainter p;
-        p.begin( &newimg );
+        handle_ddjvu_messages( d->m_djvu_cxt, false );
+        // the following line workarounds a rare crash in djvulibre;
+        // it should be fixed with >= 3.5.21
+        ddjvu_page_get_width( djvupage );
+
+        QList<RenderPartJob*> jobs;
         int parts = xparts * yparts;
         for ( int i = 0; i < parts; ++i )
         {
             int row = i % xparts;
             int col = i / xparts;
-            int tmpres = 0;
-            QImage tempp = d->generateImageTile( djvupage, tmpres,
-                    width, row, xdelta, height, col, ydelta );
-            if ( tmpres )
-            {
-                p.drawImage( row * xdelta, col * ydelta, tempp );
-            }
-            res = qMin( tmpres, res );
+            const QRect rect = QRect( row * xdelta, col * ydelta, xdelta, ydelta ) & newimg.rect();
+            if ( rect.isEmpty() )
+                continue;
+
+            RenderPartJob *job = new RenderPartJob( d->m_format, djvupage, width, height, rect, &newimg );
+            jobs.append( job );
+            d->m_renderPool.start( job );
         }
-        p.end();
+        d->m_renderPool.waitForDone();
+        handle_ddjvu_messages( d->m_djvu_cxt, false );
+
+        foreach ( RenderPartJob *job, jobs )
+            res = qMin( job->result(), res );
+        qDeleteAll( jobs );
     }
 
     if ( res && d->m_cacheEnabled )
@@ -1004,28 +1153,45 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
                 ImageCacheItem* cur = d->mImgCache.at(i);
                 if ( ( cur->page == page ) &&
                      ( abs( cur->img.width() * cur->img.height() - imgsize ) < imgsize * 0.35 ) )
-                {
-                    d->mImgCache.removeAt( i );
-                    delete cur;
-                }
+                    d->removeImage( i );
                 else
                     ++i;
             }
         }
 
-        // the image cache has too many elements, remove the last
-        if ( d->mImgCache.size() >= 10 )
+        // make room for the new image, removing the least recently used ones
+        const qulonglong imgmemory = newimg.byteCount();
+        if ( imgmemory <= d->m_maxImagesMemory )
         {
-            delete d->mImgCache.last();
-            d->mImgCache.removeLast();
+            d->cleanupImages( d->m_maxImagesMemory - imgmemory );
+            ImageCacheItem* ich = new ImageCacheItem( page, width, height, newimg );
+            d->mImgCache.push_front( ich );
+            d->m_imagesMemory += imgmemory;
         }
-        ImageCacheItem* ich = new ImageCacheItem( page, width, height, newimg );
-        d->mImgCache.push_front( ich );
     }
 
     return newimg;
 }
 
+QImage KDjVu::tile( int page, int width, int height, const QRect &rect )
+{
+    const QRect pageRect( 0, 0, width, height );
+    const QRect renderRect = rect & pageRect;
+    if ( renderRect.isEmpty() )
+        return QImage();
+
+    // a tile is rendered straight from the decoded page, asking djvulibre
+    // for the tile area only; tiles are not kept in the image cache, as
+    // they are already cached as tiles by the document
+    ddjvu_page_t *djvupage = d->loadPage( page );
+    int res = 0;
+    QImage img = d->renderRect( djvupage, res, width, height, renderRect );
+    if ( !res )
+        return QImage();
+
+    return img;
+}
+
 bool KDjVu::exportAsPostScript( const QString & fileName, const QList<int>& pageList ) const
 {
     if ( !d->m_djvu_document || fileName.trimmed().isEmpty() || pageList.isEmpty() )
@@ -1139,10 +1305,19 @@ void KDjVu::setCacheEnabled( bool enable )
 
     d->m_cacheEnabled = enable;
     if ( !d->m_cacheEnabled )
-    {
-        qDeleteAll( d->mImgCache );
-        d->mImgCache.clear();
-    }
+        d->cleanupImages( 0 );
+}
+
+void KDjVu::setCacheLimits( qulonglong pagesMemory, qulonglong imagesMemory )
+{
+    d->m_maxPagesMemory = pagesMemory;
+    d->m_maxImagesMemory = imagesMemory;
+
+    // the pages released by us are kept by djvulibre in its own cache
+    ddjvu_cache_set_size( d->m_djvu_cxt, (unsigned long)qMin< qulonglong >( pagesMemory, ULONG_MAX ) );
+
+    d->releasePages( d->m_maxPagesMemory, -1 );
+    d->cleanupImages( d->m_maxImagesMemory );
 }
 
 bool KDjVu::isCacheEnabled() const
@@ -257,6 +257,13 @@ class KDjVu
          */
         QImage image( int page, int width, int height, int rotation );
 
+        /**
+         * Renders the \p rect area of the specified \p page scaled to
+         * \p width x \p height, without rendering the rest of the page.
+         * Tiles are not cached.
+         */
+        QImage tile( int page, int width, int height, const QRect &rect );
+
         /**
          * Export the currently open document as PostScript file \p fileName.
          * \returns whether the exporting was successful
@@ -284,6 +291,13 @@ class KDjVu
          */
         bool isCacheEnabled() const;
 
+        /**
+         * Limit the memory, in bytes, used by the decoded pages and by the
+         * internal rendered pages cache; the least recently used ones are
+         * released first.
+         */
+        void setCacheLimits( qulonglong pagesMemory, qulonglong imagesMemory );
+
         /**
          * Return the page number of the page whose title is \p name.
          */
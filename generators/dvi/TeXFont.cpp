@@ -2,7 +2,24 @@
 #include <config.h>
 
 #include "TeXFont.h"
+#include "fontpool.h"
 
 
 TeXFont::~TeXFont()
-{}
+{
+  parent->font_pool->glyphCache.removeFont(this);
+}
+
+
+GlyphCache::Glyph TeXFont::getShrunkenGlyph(quint16 character)
+{
+  GlyphCache &cache = parent->font_pool->glyphCache;
+
+  GlyphCache::Glyph g;
+  if (cache.find(this, character, parent->displayResolution_in_dpi, &g))
+    return g;
+
+  short x2 = 0, y2 = 0;
+  const QImage mask = renderGlyph(character, &x2, &y2);
+  return cache.insert(this, character, parent->displayResolution_in_dpi, mask, x2, y2);
+}
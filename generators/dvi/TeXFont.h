@@ -10,6 +10,7 @@
 #define _TEXFONT_H
 
 #include "glyph.h"
+#include "glyphcache.h"
 #include "TeXFontDefinition.h"
 
 
@@ -23,13 +24,12 @@ class TeXFont {
 
   virtual ~TeXFont();
 
-  void setDisplayResolution()
-    {
-      for(unsigned int i=0; i<TeXFontDefinition::max_num_of_chars_in_font; i++)
-        glyphtable[i].shrunkenCharacter = QImage();
-    }
+  virtual glyph* getGlyph(quint16 character) = 0;
 
-  virtual glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black) = 0;
+  // Returns the shrunken glyph of the character at the current
+  // display resolution, from the glyph cache of the font pool. The
+  // glyph is rendered if it is not in the cache yet.
+  GlyphCache::Glyph getShrunkenGlyph(quint16 character);
 
   // Checksum of the font. Used e.g. by PK fonts. This field is filled
   // in by the constructor, or set to 0.0, if the font format does not
@@ -41,6 +41,11 @@ class TeXFont {
   QString            errorMessage;
 
  protected:
+  // Renders the alpha mask of the character at the current display
+  // resolution into an 8 bit image, and sets the offset of its hot
+  // point. A null image is an empty glyph.
+  virtual QImage renderGlyph(quint16 character, short *x2, short *y2) = 0;
+
   glyph              glyphtable[TeXFontDefinition::max_num_of_chars_in_font];
   TeXFontDefinition *parent;
 };
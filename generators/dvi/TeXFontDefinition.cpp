@@ -204,9 +204,8 @@ void TeXFontDefinition::reset()
 
 void TeXFontDefinition::setDisplayResolution(double _displayResolution_in_dpi)
 {
+  // The glyphs are cached per resolution, see GlyphCache
   displayResolution_in_dpi = _displayResolution_in_dpi;
-  if (font != 0)
-    font->setDisplayResolution();
 }
 
 
@@ -63,6 +63,7 @@
 #include <QImage>
 
 #include <cmath>
+#include <cstring>
 #include <math.h>
 
 //#define DEBUG_PK
@@ -116,10 +117,10 @@ TeXFont_PK::~TeXFont_PK()
 }
 
 
-glyph* TeXFont_PK::getGlyph(quint16 ch, bool generateCharacterPixmap, const QColor& color)
+glyph* TeXFont_PK::getGlyph(quint16 ch)
 {
 #ifdef DEBUG_PK
-  qCDebug(OkularDviDebug) << "TeXFont_PK::getGlyph( ch=" << ch << ", generateCharacterPixmap=" << generateCharacterPixmap << " )";
+  qCDebug(OkularDviDebug) << "TeXFont_PK::getGlyph( ch=" << ch << " )";
 #endif
 
   // Paranoia checks
@@ -157,163 +158,136 @@ glyph* TeXFont_PK::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCol
     }
   }
 
-  // At this point, g points to a properly loaded character. Generate
-  // a smoothly scaled QPixmap if the user asks for it.
-  if ((generateCharacterPixmap == true) &&
-      ((g->shrunkenCharacter.isNull()) || (color != g->color)) &&
-      (characterBitmaps[ch]->w != 0)) {
-    g->color = color;
-    double shrinkFactor = 1200 / parent->displayResolution_in_dpi;
-
-    // All is fine? Then we rescale the bitmap in order to produce the
-    // required pixmap.  Rescaling a character, however, is an art
-    // that requires some explanation...
-    //
-    // If we would just divide the size of the character and the
-    // coordinates by the shrink factor, then the result would look
-    // quite ugly: due to the ineviatable rounding errors in the
-    // integer arithmetic, the characters would be displaced by up to
-    // a pixel. That doesn't sound much, but on low-resolution
-    // devices, such as a notebook screen, the effect would be a
-    // "dancing line" of characters, which looks really bad.
-
-    // Calculate the coordinates of the hot point in the shrunken
-    // bitmap. For simplicity, let us consider the x-coordinate
-    // first. In principle, the hot point should have an x-coordinate
-    // of (g->x/shrinkFactor). That, however, will generally NOT be an
-    // integral number. The cure is to translate the source image
-    // somewhat, so that the x-coordinate of the hot point falls onto
-    // the round-up of this number, i.e.
-    g->x2 = (int)ceil(g->x/shrinkFactor);
-
-    // Translating and scaling then means that the pixel in the scaled
-    // image which covers the range [x,x+1) corresponds to the range
-    // [x*shrinkFactor+srcXTrans, (x+1)*shrinkFactor+srcXTrans), where
-    // srcXTrans is the following NEGATIVE number
-    double srcXTrans = shrinkFactor * (g->x/shrinkFactor - ceil(g->x/shrinkFactor));
-
-    // How big will the shrunken bitmap then become? If shrunk_width
-    // denotes that width of the scaled image, and
-    // characterBitmaps[ch]->w the width of the orininal image, we
-    // need to make sure that the following inequality holds:
-    //
-    // shrunk_width*shrinkFactor+srcXTrans >= characterBitmaps[ch]->w
-    //
-    // in other words,
-    int shrunk_width  = (int)ceil( (characterBitmaps[ch]->w - srcXTrans)/shrinkFactor );
-
-    // Now do the same for the y-coordinate
-    g->y2 = (int)ceil(g->y/shrinkFactor);
-    double srcYTrans = shrinkFactor * (g->y/shrinkFactor - ceil(g->y/shrinkFactor ));
-    int shrunk_height = (int)ceil( (characterBitmaps[ch]->h - srcYTrans)/shrinkFactor );
-
-    // Turn the image into 8 bit
-    QByteArray translated(characterBitmaps[ch]->w * characterBitmaps[ch]->h, '\0');
-    quint8 *data = (quint8 *)translated.data();
-    for(int x=0; x<characterBitmaps[ch]->w; x++)
-      for(int y=0; y<characterBitmaps[ch]->h; y++) {
-        quint8 bit = *(characterBitmaps[ch]->bits + characterBitmaps[ch]->bytes_wide*y + (x >> 3));
-        bit = bit >> (x & 7);
-        bit = bit & 1;
-        data[characterBitmaps[ch]->w*y + x] = bit;
-      }
+  return g;
+}
 
-    // Now shrink the image. We shrink the X-direction first
-    QByteArray xshrunk(shrunk_width*characterBitmaps[ch]->h, '\0');
-    quint8 *xdata = (quint8 *)xshrunk.data();
-
-    // Do the shrinking. The pixel (x,y) that we want to calculate
-    // corresponds to the line segment from
-    //
-    // [shrinkFactor*x+srcXTrans, shrinkFactor*(x+1)+srcXTrans)
-    //
-    // The trouble is, these numbers are in general no integers.
-
-    for(int y=0; y<characterBitmaps[ch]->h; y++)
-      for(int x=0; x<shrunk_width; x++) {
-        quint32 value = 0;
-        double destStartX = shrinkFactor*x+srcXTrans;
-        double destEndX   = shrinkFactor*(x+1)+srcXTrans;
-        for(int srcX=(int)ceil(destStartX); srcX<floor(destEndX); srcX++)
-          if ((srcX >= 0) && (srcX < characterBitmaps[ch]->w))
-            value += data[characterBitmaps[ch]->w*y + srcX] * 255;
-
-        if (destStartX >= 0.0)
-          value += (quint32) (255.0*(ceil(destStartX)-destStartX) * data[characterBitmaps[ch]->w*y + (int)floor(destStartX)]);
-        if (floor(destEndX) < characterBitmaps[ch]->w)
-          value += (quint32) (255.0*(destEndX-floor(destEndX)) * data[characterBitmaps[ch]->w*y + (int)floor(destEndX)]);
-
-        xdata[shrunk_width*y + x] = (int)(value/shrinkFactor + 0.5);
-      }
 
-    // Now shrink the Y-direction
-    QByteArray xyshrunk(shrunk_width*shrunk_height, '\0');
-    quint8 *xydata = (quint8 *)xyshrunk.data();
-    for(int x=0; x<shrunk_width; x++)
-      for(int y=0; y<shrunk_height; y++) {
-        quint32 value = 0;
-        double destStartY = shrinkFactor*y+srcYTrans;
-        double destEndY   = shrinkFactor*(y+1)+srcYTrans;
-        for(int srcY=(int)ceil(destStartY); srcY<floor(destEndY); srcY++)
-          if ((srcY >= 0) && (srcY < characterBitmaps[ch]->h))
-            value += xdata[shrunk_width*srcY + x];
-
-        if (destStartY >= 0.0)
-          value += (quint32) ((ceil(destStartY)-destStartY) * xdata[shrunk_width*(int)floor(destStartY) + x]);
-        if (floor(destEndY) < characterBitmaps[ch]->h)
-          value += (quint32) ((destEndY-floor(destEndY)) * xdata[shrunk_width*(int)floor(destEndY) + x]);
-
-        xydata[shrunk_width*y + x] = (int)(value/shrinkFactor);
-      }
+QImage TeXFont_PK::renderGlyph(quint16 ch, short *x2, short *y2)
+{
+#ifdef DEBUG_PK
+  qCDebug(OkularDviDebug) << "TeXFont_PK::renderGlyph( ch=" << ch << " )";
+#endif
 
-    QImage im32(shrunk_width, shrunk_height, QImage::Format_ARGB32);
-    // Do QPixmaps fully support the alpha channel? If yes, we use
-    // that. Otherwise, use other routines as a fallback
-    if (parent->font_pool->QPixmapSupportsAlpha) {
-      // If the alpha channel is properly supported, we set the
-      // character glyph to a colored rectangle, and define the
-      // character outline only using the alpha channel. That ensures
-      // good quality rendering for overlapping characters.
-      im32.fill(qRgb(color.red(), color.green(), color.blue()));
-      for(quint16 y=0; y<shrunk_height; y++) {
-        quint8 *destScanLine = (quint8 *)im32.scanLine(y);
-        for(quint16 col=0; col<shrunk_width; col++)
-          destScanLine[4*col+3] = xydata[shrunk_width*y + col];
-      }
-    } else {
-      // If the alpha channel is not supported... QT seems to turn the
-      // alpha channel into a crude bitmap which is used to mask the
-      // resulting QPixmap. In this case, we define the character
-      // outline using the image data, and use the alpha channel only
-      // to store "maximally opaque" or "completely transparent"
-      // values. When characters are rendered, overlapping characters
-      // are no longer correctly drawn, but quality is still
-      // sufficient for most purposes. One notable exception is output
-      // from the gftodvi program, which will be partially unreadable.
-      quint16 rInv = 0xFF - color.red();
-      quint16 gInv = 0xFF - color.green();
-      quint16 bInv = 0xFF - color.blue();
-
-      quint8 *srcScanLine = xydata;
-      for(quint16 y=0; y<shrunk_height; y++) {
-        unsigned int *destScanLine = (unsigned int *)im32.scanLine(y);
-        for(quint16 col=0; col<shrunk_width; col++) {
-          quint16 data =  *srcScanLine;
-          // The value stored in "data" now has the following meaning:
-          // data = 0 -> white; data = 0xff -> use "color"
-          *destScanLine = qRgba(0xFF - (rInv*data + 0x7F) / 0xFF,
-                                0xFF - (gInv*data + 0x7F) / 0xFF,
-                                0xFF - (bInv*data + 0x7F) / 0xFF,
-                                (data > 0x03) ? 0xff : 0x00);
-          destScanLine++;
-          srcScanLine++;
-        }
-      }
+  if (ch >= TeXFontDefinition::max_num_of_chars_in_font)
+    return QImage();
+
+  class glyph *g = getGlyph(ch);
+
+  // Empty or missing characters have no image
+  if ((characterBitmaps[ch] == 0) || (characterBitmaps[ch]->bits == 0) || (characterBitmaps[ch]->w == 0))
+    return QImage();
+
+  // At this point, g points to a properly loaded character. Generate
+  // a smoothly scaled alpha mask.
+  double shrinkFactor = 1200 / parent->displayResolution_in_dpi;
+
+  // All is fine? Then we rescale the bitmap in order to produce the
+  // required pixmap.  Rescaling a character, however, is an art
+  // that requires some explanation...
+  //
+  // If we would just divide the size of the character and the
+  // coordinates by the shrink factor, then the result would look
+  // quite ugly: due to the ineviatable rounding errors in the
+  // integer arithmetic, the characters would be displaced by up to
+  // a pixel. That doesn't sound much, but on low-resolution
+  // devices, such as a notebook screen, the effect would be a
+  // "dancing line" of characters, which looks really bad.
+
+  // Calculate the coordinates of the hot point in the shrunken
+  // bitmap. For simplicity, let us consider the x-coordinate
+  // first. In principle, the hot point should have an x-coordinate
+  // of (g->x/shrinkFactor). That, however, will generally NOT be an
+  // integral number. The cure is to translate the source image
+  // somewhat, so that the x-coordinate of the hot point falls onto
+  // the round-up of this number, i.e.
+  *x2 = (int)ceil(g->x/shrinkFactor);
+
+  // Translating and scaling then means that the pixel in the scaled
+  // image which covers the range [x,x+1) corresponds to the range
+  // [x*shrinkFactor+srcXTrans, (x+1)*shrinkFactor+srcXTrans), where
+  // srcXTrans is the following NEGATIVE number
+  double srcXTrans = shrinkFactor * (g->x/shrinkFactor - ceil(g->x/shrinkFactor));
+
+  // How big will the shrunken bitmap then become? If shrunk_width
+  // denotes that width of the scaled image, and
+  // characterBitmaps[ch]->w the width of the orininal image, we
+  // need to make sure that the following inequality holds:
+  //
+  // shrunk_width*shrinkFactor+srcXTrans >= characterBitmaps[ch]->w
+  //
+  // in other words,
+  int shrunk_width  = (int)ceil( (characterBitmaps[ch]->w - srcXTrans)/shrinkFactor );
+
+  // Now do the same for the y-coordinate
+  *y2 = (int)ceil(g->y/shrinkFactor);
+  double srcYTrans = shrinkFactor * (g->y/shrinkFactor - ceil(g->y/shrinkFactor ));
+  int shrunk_height = (int)ceil( (characterBitmaps[ch]->h - srcYTrans)/shrinkFactor );
+
+  // Turn the image into 8 bit
+  QByteArray translated(characterBitmaps[ch]->w * characterBitmaps[ch]->h, '\0');
+  quint8 *data = (quint8 *)translated.data();
+  for(int x=0; x<characterBitmaps[ch]->w; x++)
+    for(int y=0; y<characterBitmaps[ch]->h; y++) {
+      quint8 bit = *(characterBitmaps[ch]->bits + characterBitmaps[ch]->bytes_wide*y + (x >> 3));
+      bit = bit >> (x & 7);
+      bit = bit & 1;
+      data[characterBitmaps[ch]->w*y + x] = bit;
     }
 
-    g->shrunkenCharacter = im32;
-  }
-  return g;
+  // Now shrink the image. We shrink the X-direction first
+  QByteArray xshrunk(shrunk_width*characterBitmaps[ch]->h, '\0');
+  quint8 *xdata = (quint8 *)xshrunk.data();
+
+  // Do the shrinking. The pixel (x,y) that we want to calculate
+  // corresponds to the line segment from
+  //
+  // [shrinkFactor*x+srcXTrans, shrinkFactor*(x+1)+srcXTrans)
+  //
+  // The trouble is, these numbers are in general no integers.
+
+  for(int y=0; y<characterBitmaps[ch]->h; y++)
+    for(int x=0; x<shrunk_width; x++) {
+      quint32 value = 0;
+      double destStartX = shrinkFactor*x+srcXTrans;
+      double destEndX   = shrinkFactor*(x+1)+srcXTrans;
+      for(int srcX=(int)ceil(destStartX); srcX<floor(destEndX); srcX++)
+        if ((srcX >= 0) && (srcX < characterBitmaps[ch]->w))
+          value += data[characterBitmaps[ch]->w*y + srcX] * 255;
+
+      if (destStartX >= 0.0)
+        value += (quint32) (255.0*(ceil(destStartX)-destStartX) * data[characterBitmaps[ch]->w*y + (int)floor(destStartX)]);
+      if (floor(destEndX) < characterBitmaps[ch]->w)
+        value += (quint32) (255.0*(destEndX-floor(destEndX)) * data[characterBitmaps[ch]->w*y + (int)floor(destEndX)]);
+
+      xdata[shrunk_width*y + x] = (int)(value/shrinkFactor + 0.5);
+    }
+
+  // Now shrink the Y-direction
+  QByteArray xyshrunk(shrunk_width*shrunk_height, '\0');
+  quint8 *xydata = (quint8 *)xyshrunk.data();
+  for(int x=0; x<shrunk_width; x++)
+    for(int y=0; y<shrunk_height; y++) {
+      quint32 value = 0;
+      double destStartY = shrinkFactor*y+srcYTrans;
+      double destEndY   = shrinkFactor*(y+1)+srcYTrans;
+      for(int srcY=(int)ceil(destStartY); srcY<floor(destEndY); srcY++)
+        if ((srcY >= 0) && (srcY < characterBitmaps[ch]->h))
+          value += xdata[shrunk_width*srcY + x];
+
+      if (destStartY >= 0.0)
+        value += (quint32) ((ceil(destStartY)-destStartY) * xdata[shrunk_width*(int)floor(destStartY) + x]);
+      if (floor(destEndY) < characterBitmaps[ch]->h)
+        value += (quint32) ((destEndY-floor(destEndY)) * xdata[shrunk_width*(int)floor(destEndY) + x]);
+
+      xydata[shrunk_width*y + x] = (int)(value/shrinkFactor);
+    }
+
+  // The colors are only applied when the glyph is drawn, see
+  // GlyphCache::draw()
+  QImage mask(shrunk_width, shrunk_height, QImage::Format_Indexed8);
+  for(quint16 y=0; y<shrunk_height; y++)
+    memcpy(mask.scanLine(y), xydata + shrunk_width*y, shrunk_width);
+  return mask;
 }
 
 
@@ -484,7 +458,7 @@ void TeXFont_PK::read_PK_char(unsigned int ch)
   int        rows_left, h_bit, count;
 
   g = glyphtable + ch;
-  PK_flag_byte = g->x2;
+  PK_flag_byte = g->pk_flag_byte;
   PK_dyn_f = PK_flag_byte >> 4;
   paint_switch = ((PK_flag_byte & 8) != 0);
   PK_flag_byte &= 0x7;
@@ -763,7 +737,7 @@ void TeXFont_PK::read_PK_index()
       }
 
     glyphtable[ch].addr = ftell(file);
-    glyphtable[ch].x2 = PK_flag_byte;
+    glyphtable[ch].pk_flag_byte = PK_flag_byte;
     fseek(file, (long) bytes_left, SEEK_CUR);
 #ifdef DEBUG_PK
     qCDebug(OkularDviDebug) << "Scanning pk char " << ch << "at " << glyphtable[ch].addr;
@@ -13,7 +13,10 @@ class TeXFont_PK : public TeXFont {
   TeXFont_PK(TeXFontDefinition *parent);
   ~TeXFont_PK();
 
-  glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black);
+  glyph* getGlyph(quint16 character);
+
+ protected:
+  QImage renderGlyph(quint16 character, short *x2, short *y2);
 
  private:
   // open font file or NULL
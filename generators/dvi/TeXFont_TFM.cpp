@@ -120,10 +120,10 @@ TeXFont_TFM::~TeXFont_TFM()
 }
 
 
-glyph* TeXFont_TFM::getGlyph(quint16 characterCode, bool generateCharacterPixmap, const QColor& color)
+glyph* TeXFont_TFM::getGlyph(quint16 characterCode)
 {
 #ifdef DEBUG_TFM
-  qCDebug(OkularDviDebug) << "TeXFont_TFM::getGlyph( ch=" << ch << ", generateCharacterPixmap=" << generateCharacterPixmap << " )";
+  qCDebug(OkularDviDebug) << "TeXFont_TFM::getGlyph( ch=" << characterCode << " )";
 #endif
 
   // Paranoia checks
@@ -133,29 +133,33 @@ glyph* TeXFont_TFM::getGlyph(quint16 characterCode, bool generateCharacterPixmap
   }
 
   // This is the address of the glyph that will be returned.
-  class glyph *g = glyphtable+characterCode;
-
-  if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) ) {
-    g->color = color;
-    quint16 pixelWidth = (quint16)(parent->displayResolution_in_dpi *
-                                     design_size_in_TeX_points.toDouble() *
-                                     characterWidth_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
-    quint16 pixelHeight = (quint16)(parent->displayResolution_in_dpi *
-                                      design_size_in_TeX_points.toDouble() *
-                                      characterHeight_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
-
-    // Just make sure that weired TFM files never lead to giant
-    // pixmaps that eat all system memory...
-    if (pixelWidth > 50)
-      pixelWidth = 50;
-    if (pixelHeight > 50)
-      pixelHeight = 50;
-
-    g->shrunkenCharacter = QImage(pixelWidth, pixelHeight, QImage::Format_RGB32);
-    g->shrunkenCharacter.fill(color.rgba());
-    g->x2 = 0;
-    g->y2 = pixelHeight;
-  }
+  return glyphtable+characterCode;
+}
 
-  return g;
+
+QImage TeXFont_TFM::renderGlyph(quint16 characterCode, short *x2, short *y2)
+{
+  if (characterCode >= TeXFontDefinition::max_num_of_chars_in_font)
+    return QImage();
+
+  quint16 pixelWidth = (quint16)(parent->displayResolution_in_dpi *
+                                   design_size_in_TeX_points.toDouble() *
+                                   characterWidth_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
+  quint16 pixelHeight = (quint16)(parent->displayResolution_in_dpi *
+                                    design_size_in_TeX_points.toDouble() *
+                                    characterHeight_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
+
+  // Just make sure that weired TFM files never lead to giant
+  // pixmaps that eat all system memory...
+  if (pixelWidth > 50)
+    pixelWidth = 50;
+  if (pixelHeight > 50)
+    pixelHeight = 50;
+
+  // Without the shapes of the characters, draw filled rectangles
+  QImage mask(pixelWidth, pixelHeight, QImage::Format_Indexed8);
+  mask.fill(0xff);
+  *x2 = 0;
+  *y2 = pixelHeight;
+  return mask;
 }
@@ -26,7 +26,10 @@ class TeXFont_TFM : public TeXFont {
   TeXFont_TFM(TeXFontDefinition *parent);
   ~TeXFont_TFM();
 
-  glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black);
+  glyph* getGlyph(quint16 character);
+
+ protected:
+  QImage renderGlyph(quint16 character, short *x2, short *y2);
 
  private:
   fix_word characterWidth_in_units_of_design_size[256];
@@ -81,22 +81,22 @@ void dviRenderer::set_char(unsigned int cmd, unsigned int ch)
   qCDebug(OkularDviDebug) << "set_char #" << ch;
 #endif
 
-  glyph *g;
-  if (colorStack.isEmpty())
-    g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
-  else
-    g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, colorStack.top());
+  TeXFont *font = (TeXFont *)(currinf.fontp->font);
+  glyph *g = font->getGlyph(ch);
   if (g == NULL)
     return;
 
   long dvi_h_sav = currinf.data.dvi_h;
 
-  QImage pix = g->shrunkenCharacter;
-  int x = ((int) ((currinf.data.dvi_h) / (shrinkfactor * 65536))) - g->x2;
-  int y = currinf.data.pxl_v - g->y2;
+  const GlyphCache::Glyph shrunken = font->getShrunkenGlyph(ch);
+  const QSize pix = shrunken.rect.size();
+  int x = ((int) ((currinf.data.dvi_h) / (shrinkfactor * 65536))) - shrunken.x2;
+  int y = currinf.data.pxl_v - shrunken.y2;
 
-  // Draw the character.
-  foreGroundPainter->drawImage(x, y, pix);
+  // Draw the character, in the current color.
+  font_pool.glyphCache.draw(foreGroundPainter, shrunken, x, y,
+                            colorStack.isEmpty() ? globalColor : colorStack.top(),
+                            font_pool.QPixmapSupportsAlpha);
 
   // Are we drawing text for a hyperlink? And are hyperlinks
   // enabled?
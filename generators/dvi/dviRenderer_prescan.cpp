@@ -599,7 +599,7 @@ void dviRenderer::prescan_setChar(unsigned int ch)
     return;
 
   if (currinf.set_char_p == &dviRenderer::set_char) {
-    glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
+    glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch);
     if (g == NULL)
       return;
     currinf.data.dvi_h += (int)(currinf.fontp->scaled_size_in_DVI_units * dviFile->getCmPerDVIunit() *
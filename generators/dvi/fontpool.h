@@ -9,6 +9,7 @@
 
 #include "fontEncodingPool.h"
 #include "fontMap.h"
+#include "glyphcache.h"
 #include "TeXFontDefinition.h"
 
 #include <QList>
@@ -122,6 +123,10 @@ public:
       drawing routines for the different setups. */
   bool QPixmapSupportsAlpha;
 
+  /** The shrunken glyphs of all the fonts, for all the display
+      resolutions used recently. */
+  GlyphCache glyphCache;
+
 signals:
   /** Passed through to the top-level kpart. */
   void error( const QString &message, int duration );
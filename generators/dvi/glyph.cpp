@@ -31,6 +31,7 @@ glyph::glyph()
   addr                     = 0;
   x                        = 0;
   y                        = 0;
+  pk_flag_byte             = 0;
   dvi_advance_in_units_of_design_size_by_2e20 = 0;
 }
 
@@ -3,8 +3,7 @@
 #ifndef _GLYPH_H
 #define _GLYPH_H
 
-#include <QColor>
-#include <QImage>
+#include <QtGlobal>
 
 
 struct bitmap {
@@ -27,18 +26,14 @@ class glyph {
   // address of bitmap in font file
   long    addr;
 
-  QColor color;
-
   // DVI units to move reference point
   qint32 dvi_advance_in_units_of_design_size_by_2e20;
 
   // x and y offset in pixels
   short   x, y;
 
-  QImage shrunkenCharacter;
-
-  // x and y offset in pixels (shrunken bitmap)
-  short   x2, y2;
+  // flag byte of the character in a PK font file, until it is loaded
+  short   pk_flag_byte;
 };
 
 #endif //ifndef _GLYPH_H
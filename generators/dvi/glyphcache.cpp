@@ -0,0 +1,218 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+//
+// glyphcache.cpp
+//
+// Copyright (C) 2026 by agent <agent@local>
+// Distributed under the GPL
+
+#include <config.h>
+
+#include "glyphcache.h"
+#include "debug_dvi.h"
+
+#include <QColor>
+#include <QPainter>
+
+#include <cstring>
+
+//#define DEBUG_GLYPHCACHE
+
+// Size of the atlases, in pixels. Larger glyphs get an atlas of their own.
+static const int atlasSize = 512;
+
+// Memory used by the atlases at most, in bytes
+static const qulonglong maxMemory = 16 * 1024 * 1024;
+
+
+uint qHash(const GlyphCache::Key &key)
+{
+  return qHash(key.font) ^ (uint(key.character) << 16) ^ key.resolution;
+}
+
+
+GlyphCache::GlyphCache()
+  : currentAtlas(-1), memory(0), useCount(0)
+{
+}
+
+
+GlyphCache::Key GlyphCache::key(const TeXFont *font, quint16 character, double resolution_in_dpi)
+{
+  Key k;
+  k.font = font;
+  k.character = character;
+  k.resolution = (quint32)(resolution_in_dpi * 100.0 + 0.5);
+  return k;
+}
+
+
+bool GlyphCache::find(const TeXFont *font, quint16 character, double resolution_in_dpi, Glyph *glyph)
+{
+  QHash<Key, Glyph>::const_iterator it = glyphs.constFind(key(font, character, resolution_in_dpi));
+  if (it == glyphs.constEnd())
+    return false;
+
+  *glyph = it.value();
+  if (glyph->page != -1)
+    atlases[glyph->page].lastUse = ++useCount;
+  return true;
+}
+
+
+GlyphCache::Glyph GlyphCache::insert(const TeXFont *font, quint16 character, double resolution_in_dpi,
+                                     const QImage &mask, short x2, short y2)
+{
+  const Key k = key(font, character, resolution_in_dpi);
+
+  Glyph glyph;
+  glyph.x2 = x2;
+  glyph.y2 = y2;
+
+  if (!mask.isNull()) {
+    QPoint position;
+    glyph.page = allocate(mask.size(), &position);
+    glyph.rect = QRect(position, mask.size());
+
+    Atlas &atlas = atlases[glyph.page];
+    for(int row=0; row<mask.height(); row++)
+      memcpy(atlas.image.scanLine(position.y() + row) + position.x(), mask.constScanLine(row), mask.width());
+    atlas.keys.append(k);
+    atlas.lastUse = ++useCount;
+  }
+
+  glyphs.insert(k, glyph);
+  return glyph;
+}
+
+
+int GlyphCache::allocate(const QSize &size, QPoint *position)
+{
+  // Glyphs are put next to each other in rows, a glyph that does not
+  // fit into the current row starts a new one.
+  if (currentAtlas != -1) {
+    Atlas &atlas = atlases[currentAtlas];
+    if (atlas.x + size.width() > atlas.image.width()) {
+      atlas.x = 0;
+      atlas.y += atlas.rowHeight;
+      atlas.rowHeight = 0;
+    }
+    if (atlas.x + size.width() <= atlas.image.width() && atlas.y + size.height() <= atlas.image.height()) {
+      *position = QPoint(atlas.x, atlas.y);
+      atlas.x += size.width();
+      atlas.rowHeight = qMax(atlas.rowHeight, size.height());
+      return currentAtlas;
+    }
+  }
+
+  // The current atlas is full. Make room for a new one, dropping the
+  // glyphs of the atlases used least recently.
+  const int width = qMax(atlasSize, size.width());
+  const int height = qMax(atlasSize, size.height());
+  const qulonglong atlasMemory = (qulonglong)width * height;
+  while (memory + atlasMemory > maxMemory) {
+    int oldest = -1;
+    for(int i=0; i<atlases.size(); i++)
+      if (!atlases[i].image.isNull() && (oldest == -1 || atlases[i].lastUse < atlases[oldest].lastUse))
+        oldest = i;
+    if (oldest == -1)
+      break;
+    evict(oldest);
+  }
+
+  // Reuse the slot of an evicted atlas, so that the other glyphs keep
+  // their atlas number
+  int page = 0;
+  while (page < atlases.size() && !atlases[page].image.isNull())
+    page++;
+  if (page == atlases.size())
+    atlases.append(Atlas());
+
+  Atlas &atlas = atlases[page];
+  atlas = Atlas();
+  atlas.image = QImage(width, height, QImage::Format_Indexed8);
+  atlas.x = size.width();
+  atlas.rowHeight = size.height();
+  memory += atlasMemory;
+  currentAtlas = page;
+
+#ifdef DEBUG_GLYPHCACHE
+  qCDebug(OkularDviDebug) << "GlyphCache::allocate(): new atlas" << page << "memory" << memory;
+#endif
+
+  *position = QPoint(0, 0);
+  return page;
+}
+
+
+void GlyphCache::evict(int page)
+{
+  Atlas &atlas = atlases[page];
+  foreach(const Key &k, atlas.keys)
+    glyphs.remove(k);
+
+  memory -= (qulonglong)atlas.image.width() * atlas.image.height();
+  atlas = Atlas();
+  if (page == currentAtlas)
+    currentAtlas = -1;
+}
+
+
+void GlyphCache::removeFont(const TeXFont *font)
+{
+  QHash<Key, Glyph>::iterator it = glyphs.begin();
+  while (it != glyphs.end()) {
+    if (it.key().font == font)
+      it = glyphs.erase(it);
+    else
+      ++it;
+  }
+
+  // The space in the atlases is only given back with the whole atlas
+  for(int i=0; i<atlases.size(); i++) {
+    QList<Key> &keys = atlases[i].keys;
+    for(int k=keys.size()-1; k>=0; k--)
+      if (keys.at(k).font == font)
+        keys.removeAt(k);
+  }
+}
+
+
+void GlyphCache::draw(QPainter *painter, const Glyph &glyph, int x, int y, const QColor &color, bool useAlpha)
+{
+  if (glyph.page == -1)
+    return;
+
+  const QImage &atlas = atlases[glyph.page].image;
+  const int width = glyph.rect.width();
+  const int height = glyph.rect.height();
+  if (tinted.width() < width || tinted.height() < height)
+    tinted = QImage(qMax(tinted.width(), width), qMax(tinted.height(), height), QImage::Format_ARGB32_Premultiplied);
+
+  const quint16 red = color.red();
+  const quint16 green = color.green();
+  const quint16 blue = color.blue();
+  for(int row=0; row<height; row++) {
+    const quint8 *srcScanLine = atlas.constScanLine(glyph.rect.y() + row) + glyph.rect.x();
+    QRgb *destScanLine = (QRgb *)tinted.scanLine(row);
+    if (useAlpha) {
+      // The glyph is a colored rectangle, with the character outline
+      // in the alpha channel, premultiplied
+      for(int col=0; col<width; col++) {
+        const quint16 data = srcScanLine[col];
+        destScanLine[col] = qRgba((red*data + 0x7F) / 0xFF, (green*data + 0x7F) / 0xFF,
+                                  (blue*data + 0x7F) / 0xFF, data);
+      }
+    } else {
+      // The character outline is in the colors, blended with white,
+      // and the alpha channel is only opaque or transparent
+      for(int col=0; col<width; col++) {
+        const quint16 data = srcScanLine[col];
+        destScanLine[col] = (data > 0x03) ? qRgb(0xFF - ((0xFF - red)*data + 0x7F) / 0xFF,
+                                                 0xFF - ((0xFF - green)*data + 0x7F) / 0xFF,
+                                                 0xFF - ((0xFF - blue)*data + 0x7F) / 0xFF) : 0;
+      }
+    }
+  }
+
+  painter->drawImage(QPoint(x, y), tinted, QRect(0, 0, width, height));
+}
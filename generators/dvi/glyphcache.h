@@ -0,0 +1,106 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+//
+// glyphcache.h
+//
+// Copyright (C) 2026 by agent <agent@local>
+// Distributed under the GPL
+
+#ifndef _GLYPHCACHE_H
+#define _GLYPHCACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QVector>
+
+class QColor;
+class QPainter;
+class TeXFont;
+
+
+/**
+ * Shrunken glyphs of all the fonts of a fontPool
+ *
+ * The glyphs are stored as alpha masks, packed in rows into a few
+ * large atlas images, and are looked up by font, character and
+ * display resolution. Since a glyph is only colored when it is drawn,
+ * a glyph is rendered once whatever the colors of the text, and the
+ * glyphs of a few zoom levels stay around together. When the atlases
+ * use too much memory, the one used least recently is dropped.
+ */
+
+class GlyphCache {
+ public:
+  struct Glyph {
+    Glyph() : page(-1), x2(0), y2(0) {}
+
+    // atlas holding the glyph, or -1 for an empty glyph
+    int page;
+    // area of the glyph in the atlas
+    QRect rect;
+    // x and y offset of the hot point in pixels
+    short x2, y2;
+  };
+
+  GlyphCache();
+
+  /** Looks the glyph of @p character up; returns false if it is not
+      in the cache. */
+  bool find(const TeXFont *font, quint16 character, double resolution_in_dpi, Glyph *glyph);
+
+  /** Adds the glyph of @p character, whose alpha mask is the 8 bit
+      image @p mask, and returns it. A null mask is an empty glyph. */
+  Glyph insert(const TeXFont *font, quint16 character, double resolution_in_dpi,
+               const QImage &mask, short x2, short y2);
+
+  /** Draws @p glyph in @p color, with its top left corner at (x, y). If
+      @p useAlpha is false, the glyph is drawn opaque on white, with a
+      1-bit mask. */
+  void draw(QPainter *painter, const Glyph &glyph, int x, int y, const QColor &color, bool useAlpha);
+
+  /** Removes the glyphs of @p font, which is going away. */
+  void removeFont(const TeXFont *font);
+
+ private:
+  struct Key {
+    const TeXFont *font;
+    quint16 character;
+    // display resolution, in 1/100 dpi
+    quint32 resolution;
+
+    bool operator==(const Key &other) const
+      {
+        return font == other.font && character == other.character && resolution == other.resolution;
+      }
+  };
+  friend uint qHash(const Key &key);
+
+  struct Atlas {
+    Atlas() : x(0), y(0), rowHeight(0), lastUse(0) {}
+
+    QImage image;
+    // free position in the current row of glyphs, and the height of that row
+    int x, y, rowHeight;
+    qulonglong lastUse;
+    QList<Key> keys;
+  };
+
+  static Key key(const TeXFont *font, quint16 character, double resolution_in_dpi);
+
+  // Returns the atlas to put a glyph of the given size into, and its position there
+  int allocate(const QSize &size, QPoint *position);
+  void evict(int page);
+
+  QVector<Atlas> atlases;
+  // atlas glyphs are currently added to
+  int currentAtlas;
+  qulonglong memory;
+  qulonglong useCount;
+  QHash<Key, Glyph> glyphs;
+
+  // the glyph being drawn, colored
+  QImage tinted;
+};
+
+#endif //ifndef _GLYPHCACHE_H
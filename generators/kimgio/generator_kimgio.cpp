@@ -28,6 +28,7 @@
 #include <kexiv2/kexiv2.h>
 
 #include <core/page.h>
+#include <core/utils.h>
 
 static KAboutData createAboutData()
 {
@@ -48,10 +49,11 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN( KIMGIOGenerator, createAboutData() )
 
 KIMGIOGenerator::KIMGIOGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), m_exifOrientation( KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED )
 {
     setFeature( ReadRawData );
     setFeature( Threaded );
+    setFeature( ThreadedMultiple );
     setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
@@ -73,11 +75,14 @@ bool KIMGIOGenerator::loadDocument( const QString & fileName, QVector<Okular::Pa
         return false;
     }
     docInfo.set( Okular::DocumentInfo::MimeType, mime );
+    m_fileName = fileName;
+    m_format = type;
 
     // Apply transformations dictated by Exif metadata
     KExiv2Iface::KExiv2 exifMetadata;
     if ( exifMetadata.load( fileName ) ) {
-        exifMetadata.rotateExifQImage( m_img, exifMetadata.getImageOrientation() );
+        m_exifOrientation = exifMetadata.getImageOrientation();
+        exifMetadata.rotateExifQImage( m_img, (KExiv2Iface::KExiv2::ImageOrientation)m_exifOrientation );
     }
 
     pagesVector.resize( 1 );
@@ -105,11 +110,14 @@ bool KIMGIOGenerator::loadDocumentFromData( const QByteArray & fileData, QVector
         return false;
     }
     docInfo.set( Okular::DocumentInfo::MimeType, mime );
+    m_fileData = fileData;
+    m_format = type;
 
     // Apply transformations dictated by Exif metadata
     KExiv2Iface::KExiv2 exifMetadata;
     if ( exifMetadata.loadFromData( fileData ) ) {
-        exifMetadata.rotateExifQImage( m_img, exifMetadata.getImageOrientation() );
+        m_exifOrientation = exifMetadata.getImageOrientation();
+        exifMetadata.rotateExifQImage( m_img, (KExiv2Iface::KExiv2::ImageOrientation)m_exifOrientation );
     }
 
     pagesVector.resize( 1 );
@@ -123,6 +131,10 @@ bool KIMGIOGenerator::loadDocumentFromData( const QByteArray & fileData, QVector
 bool KIMGIOGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_fileName.clear();
+    m_fileData.clear();
+    m_format.clear();
+    m_exifOrientation = KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED;
 
     return true;
 }
@@ -151,10 +163,48 @@ QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
         if ( request->page()->rotation() % 2 == 1 )
             qSwap( width, height );
 
-        return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+        return scaledImage( width, height );
     }
 }
 
+QImage KIMGIOGenerator::scaledImage( int width, int height )
+{
+    // decoding again at a fraction of the size is cheaper than scaling
+    // down the whole image, for thumbnails and zoomed out views, but only
+    // for the formats whose codec can decode at a reduced size
+    if ( width * 2 <= m_img.width() && height * 2 <= m_img.height() )
+    {
+        QByteArray data = m_fileData;
+        QBuffer buffer( &data );
+        QImageReader reader;
+        reader.setFormat( m_format );
+        if ( m_fileName.isEmpty() )
+        {
+            buffer.open( QIODevice::ReadOnly );
+            reader.setDevice( &buffer );
+        }
+        else
+        {
+            reader.setFileName( m_fileName );
+        }
+
+        if ( reader.supportsOption( QImageIOHandler::ScaledSize ) )
+        {
+            // the image is decoded before the Exif transformation
+            const bool transposed = m_exifOrientation >= KExiv2Iface::KExiv2::ORIENTATION_ROT_90_HFLIP;
+            QImage image = Okular::Utils::scaledImage( &reader, transposed ? QSize( height, width ) : QSize( width, height ) );
+            if ( !image.isNull() )
+            {
+                KExiv2Iface::KExiv2 exifMetadata;
+                exifMetadata.rotateExifQImage( image, (KExiv2Iface::KExiv2::ImageOrientation)m_exifOrientation );
+                return image;
+            }
+        }
+    }
+
+    return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+}
+
 bool KIMGIOGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
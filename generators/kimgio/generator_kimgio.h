@@ -39,7 +39,14 @@ class KIMGIOGenerator : public Okular::Generator
         QImage image( Okular::PixmapRequest * request );
 
     private:
+        QImage scaledImage( int width, int height );
+
         QImage m_img;
+        // the encoded image, to decode it again at a reduced size
+        QString m_fileName;
+        QByteArray m_fileData;
+        QByteArray m_format;
+        int m_exifOrientation;
         Okular::DocumentInfo docInfo;
 };
 
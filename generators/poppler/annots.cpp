@@ -121,6 +121,7 @@ void PopplerAnnotationProxy::notifyAddition( Okular::Annotation *okl_ann, int pa
     Poppler::Page *ppl_page = ppl_doc->page( page );
     ppl_page->addAnnotation( ppl_ann );
     delete ppl_page;
+    modifiedPages.insert( page );
 
     // Set pointer to poppler annotation as native Id
     okl_ann->setNativeId( qVariantFromValue( ppl_ann ) );
@@ -131,7 +132,6 @@ void PopplerAnnotationProxy::notifyAddition( Okular::Annotation *okl_ann, int pa
 
 void PopplerAnnotationProxy::notifyModification( const Okular::Annotation *okl_ann, int page, bool appearanceChanged )
 {
-    Q_UNUSED( page );
     Q_UNUSED( appearanceChanged );
 
     Poppler::Annotation *ppl_ann = qvariant_cast<Poppler::Annotation*>( okl_ann->nativeId() );
@@ -140,6 +140,7 @@ void PopplerAnnotationProxy::notifyModification( const Okular::Annotation *okl_a
         return;
 
     QMutexLocker ml(mutex);
+    modifiedPages.insert( page );
 
     if ( okl_ann->flags() & Okular::Annotation::BeingMoved )
     {
@@ -241,6 +242,11 @@ void PopplerAnnotationProxy::notifyModification( const Okular::Annotation *okl_a
     qCDebug(OkularPdfDebug) << okl_ann->uniqueName();
 }
 
+bool PopplerAnnotationProxy::isPageModified( int page ) const
+{
+    return modifiedPages.contains( page );
+}
+
 void PopplerAnnotationProxy::notifyRemoval( Okular::Annotation *okl_ann, int page )
 {
     Poppler::Annotation *ppl_ann = qvariant_cast<Poppler::Annotation*>( okl_ann->nativeId() );
@@ -253,6 +259,7 @@ void PopplerAnnotationProxy::notifyRemoval( Okular::Annotation *okl_ann, int pag
     Poppler::Page *ppl_page = ppl_doc->page( page );
     ppl_page->removeAnnotation( ppl_ann ); // Also destroys ppl_ann
     delete ppl_page;
+    modifiedPages.insert( page );
 
     okl_ann->setNativeId( qVariantFromValue(0) ); // So that we don't double-free in disposeAnnotation
 
@@ -14,6 +14,7 @@
 #include <poppler-qt5.h>
 
 #include <qmutex.h>
+#include <qset.h>
 
 #include "core/annotations.h"
 #include "config-okular-poppler.h"
@@ -30,9 +31,13 @@ class PopplerAnnotationProxy : public Okular::AnnotationProxy
         void notifyAddition( Okular::Annotation *annotation, int page );
         void notifyModification( const Okular::Annotation *annotation, int page, bool appearanceChanged );
         void notifyRemoval( Okular::Annotation *annotation, int page );
+
+        // whether annotations of the page were changed in memory; call with the mutex locked
+        bool isPageModified( int page ) const;
     private:
         Poppler::Document *ppl_doc;
         QMutex *mutex;
+        QSet<int> modifiedPages;
 };
 
 #endif
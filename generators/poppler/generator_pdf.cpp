@@ -23,6 +23,7 @@
 #include <qstack.h>
 #include <qtemporaryfile.h>
 #include <qtextstream.h>
+#include <qthread.h>
 #include <QPrinter>
 #include <QPainter>
 #include <QtCore/QDebug>
@@ -63,6 +64,8 @@ Q_DECLARE_METATYPE(const Poppler::LinkRendition*)
 
 static const int defaultPageWidth = 595;
 static const int defaultPageHeight = 842;
+// the most render documents loaded at once
+static const int MaxRenderDocuments = 4;
 
 class PDFOptionsPage : public QWidget
 {
@@ -368,6 +371,9 @@ static QLinkedList<Okular::ObjectRect*> generateLinks( const QList<Poppler::Link
  *           mutex is needed only because we have the asynchronous thread; else
  *           the operations are all within the 'gui' thread, scheduled by the
  *           Qt scheduler and no mutex is needed.
+ *           pages not modified in memory are rendered (and their text is
+ *           extracted) using a pool of private Poppler::Document instances,
+ *           one per worker, so those don't need the mutex and run in parallel.
  * external: dangerous operations are all locked via mutex internally, and the
  *           only needed external thing is the 'canGeneratePixmap' method
  *           that tells if the generator is free (since we don't want an
@@ -401,11 +407,13 @@ static void PDFGeneratorPopplerDebugFunction(const QString &message, const QVari
 
 PDFGenerator::PDFGenerator( QObject *parent, const QVariantList &args )
     : Generator( parent, args ), pdfdoc( 0 ),
+    maxRenderDocs( 1 ), renderDocsFailed( false ),
     docSynopsisDirty( true ),
     docEmbeddedFilesDirty( true ), nextFontPage( 0 ),
     annotProxy( 0 )
 {
     setFeature( Threaded );
+    setFeature( ThreadedMultiple );
     setFeature( TextExtraction );
     setFeature( FontInfo );
 #ifdef Q_OS_WIN32
@@ -440,6 +448,7 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentWithPassword( const QStri
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::load( filePath, 0, 0 );
+    docFilePath = filePath;
     return init(pagesVector, password);
 }
 
@@ -454,6 +463,7 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentFromDataWithPassword( con
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::loadFromData( fileData, 0, 0 );
+    docFileData = fileData;
     return init(pagesVector, password);
 }
 
@@ -482,6 +492,7 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page*> & pagesVe
     }
     pagesVector.resize(pageCount);
     rectsGenerated.fill(false, pageCount);
+    docPassword = password.toLatin1();
 
     annotationsHash.clear();
 
@@ -499,6 +510,13 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page*> & pagesVe
 
 bool PDFGenerator::doCloseDocument()
 {
+    // no worker is running at this point, so all the render documents are free
+    clearRenderDocuments();
+    renderDocsFailed = false;
+    docFilePath.clear();
+    docFileData.clear();
+    docPassword.clear();
+
     // remove internal objects
     userMutex()->lock();
     delete annotProxy;
@@ -798,15 +816,28 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
     qreal fakeDpiX = request->width() / pageWidth * dpi().width();
     qreal fakeDpiY = request->height() / pageHeight * dpi().height();
 
-    // generate links rects only the first time
-    bool genObjectRects = !rectsGenerated.at( page->number() );
-
     // 0. LOCK [waits for the thread end]
     userMutex()->lock();
 
+    // generate links rects only the first time
+    const bool genObjectRects = !rectsGenerated.at( page->number() );
+
+    // the object rects, form fields and annotations changed in memory all
+    // need the main document; other pages can be rendered by a private
+    // document without keeping everybody else waiting
+    Poppler::Document *renderDoc = 0;
+    if ( !genObjectRects && page->formFields().isEmpty() && !( annotProxy && annotProxy->isPageModified( page->number() ) ) )
+    {
+        userMutex()->unlock();
+        renderDoc = acquireRenderDocument();
+        // could not load a private copy, go on with the main one
+        if ( !renderDoc )
+            userMutex()->lock();
+    }
+
     // 1. Set OutputDev parameters and Generate contents
     // note: thread safety is set on 'false' for the GUI (this) thread
-    Poppler::Page *p = pdfdoc->page(page->number());
+    Poppler::Page *p = renderDoc ? renderDoc->page(page->number()) : pdfdoc->page(page->number());
 
     // 2. Take data from outputdev and attach it to the Page
     QImage img;
@@ -839,6 +870,13 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
         resolveMediaLinkReferences( page );
     }
 
+    if ( renderDoc )
+    {
+        delete p;
+        releaseRenderDocument( renderDoc );
+        return img;
+    }
+
     // 3. UNLOCK [re-enables shared access]
     userMutex()->unlock();
 
@@ -847,6 +885,93 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
     return img;
 }
 
+Poppler::Document *PDFGenerator::acquireRenderDocument( bool wait )
+{
+    QMutexLocker locker( &renderDocsMutex );
+
+    if ( renderDocsFailed )
+        return 0;
+
+    // wait for a document to be given back when there are enough of them,
+    // unless the caller rather goes on with the main one
+    while ( freeRenderDocs.isEmpty() && busyRenderDocs.count() >= maxRenderDocs )
+    {
+        if ( !wait )
+            return 0;
+        renderDocsCondition.wait( &renderDocsMutex );
+    }
+
+    Poppler::Document *doc = 0;
+    if ( !freeRenderDocs.isEmpty() )
+    {
+        doc = freeRenderDocs.takeLast();
+    }
+    else
+    {
+        if ( !docFileData.isEmpty() )
+            doc = Poppler::Document::loadFromData( docFileData, docPassword, docPassword );
+        else if ( !docFilePath.isEmpty() )
+            doc = Poppler::Document::load( docFilePath, docPassword, docPassword );
+
+        if ( doc && doc->isLocked() )
+        {
+            delete doc;
+            doc = 0;
+        }
+
+        if ( !doc )
+        {
+            renderDocsFailed = true;
+            return 0;
+        }
+
+        // render exactly like the main document does
+        userMutex()->lock();
+        const Poppler::Document::RenderHints hints = pdfdoc->renderHints();
+        doc->setPaperColor( pdfdoc->paperColor() );
+        userMutex()->unlock();
+
+        const Poppler::Document::RenderHint knownHints[] = {
+            Poppler::Document::Antialiasing,
+            Poppler::Document::TextAntialiasing,
+            Poppler::Document::TextHinting,
+#ifdef HAVE_POPPLER_0_24
+            Poppler::Document::ThinLineSolid,
+            Poppler::Document::ThinLineShape,
+#endif
+        };
+        for ( uint i = 0; i < sizeof( knownHints ) / sizeof( knownHints[0] ); ++i )
+            doc->setRenderHint( knownHints[i], hints.testFlag( knownHints[i] ) );
+    }
+
+    busyRenderDocs.insert( doc );
+    return doc;
+}
+
+void PDFGenerator::releaseRenderDocument( Poppler::Document *doc )
+{
+    QMutexLocker locker( &renderDocsMutex );
+
+    busyRenderDocs.remove( doc );
+    // the pool may have been made smaller meanwhile
+    if ( staleRenderDocs.remove( doc ) || busyRenderDocs.count() + freeRenderDocs.count() >= maxRenderDocs )
+        delete doc;
+    else
+        freeRenderDocs.append( doc );
+
+    renderDocsCondition.wakeOne();
+}
+
+void PDFGenerator::clearRenderDocuments()
+{
+    QMutexLocker locker( &renderDocsMutex );
+
+    qDeleteAll( freeRenderDocs );
+    freeRenderDocs.clear();
+    // the ones being used are deleted when given back
+    staleRenderDocs = busyRenderDocs;
+}
+
 template <typename PopplerLinkType, typename OkularLinkType, typename PopplerAnnotationType, typename OkularAnnotationType>
 void resolveMediaLinks( Okular::Action *action, enum Okular::Annotation::SubType subType, QHash<Okular::Annotation*, Poppler::Annotation*> &annotationsHash )
 {
@@ -920,12 +1045,22 @@ Okular::TextPage* PDFGenerator::textPage( Okular::Page *page )
     // build a TextList...
     QList<Poppler::TextBox*> textList;
     double pageWidth, pageHeight;
-    Poppler::Page *pp = pdfdoc->page( page->number() );
+    // the text page is not worth waiting for a render document to be free,
+    // the main one is used then
+    Poppler::Document *renderDoc = acquireRenderDocument( false );
+    Poppler::Page *pp = renderDoc ? renderDoc->page( page->number() ) : pdfdoc->page( page->number() );
     if (pp)
     {
-        userMutex()->lock();
-        textList = pp->textList();
-        userMutex()->unlock();
+        if ( renderDoc )
+        {
+            textList = pp->textList();
+        }
+        else
+        {
+            userMutex()->lock();
+            textList = pp->textList();
+            userMutex()->unlock();
+        }
 
         QSizeF s = pp->pageSizeF();
         pageWidth = s.width();
@@ -939,6 +1074,9 @@ Okular::TextPage* PDFGenerator::textPage( Okular::Page *page )
         pageHeight = defaultPageHeight;
     }
 
+    if ( renderDoc )
+        releaseRenderDocument( renderDoc );
+
     Okular::TextPage *tp = abstractTextPage(textList, pageHeight, pageWidth, (Poppler::Page::Rotation)page->orientation());
     qDeleteAll(textList);
     return tp;
@@ -1152,6 +1290,16 @@ bool PDFGenerator::reparseConfig()
     }
     bool aaChanged = setDocumentRenderHints();
     somethingchanged = somethingchanged || aaChanged;
+
+    // one document per pixmap worker and one for the text page worker, but
+    // each keeps its own copy of the file data and caches
+    renderDocsMutex.lock();
+    maxRenderDocs = qMin( maxPixmapGenerationThreads() + 1, MaxRenderDocuments );
+    renderDocsMutex.unlock();
+
+    // render documents will be reloaded with the new settings
+    if ( somethingchanged )
+        clearRenderDocuments();
     return somethingchanged;
 }
 
@@ -17,7 +17,10 @@
 
 
 #include <qbitarray.h>
+#include <qmutex.h>
 #include <qpointer.h>
+#include <qset.h>
+#include <qwaitcondition.h>
 
 #include <core/document.h>
 #include <core/generator.h>
@@ -125,9 +128,29 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
 
         bool setDocumentRenderHints();
 
+        // pool of read-only documents used to render and extract text from
+        // unmodified pages without holding the user mutex
+        Poppler::Document *acquireRenderDocument( bool wait = true );
+        void releaseRenderDocument( Poppler::Document *doc );
+        void clearRenderDocuments();
+
         // poppler dependant stuff
         Poppler::Document *pdfdoc;
 
+        // what is needed to load the pooled render documents
+        QString docFilePath;
+        QByteArray docFileData;
+        QByteArray docPassword;
+        QMutex renderDocsMutex;
+        QWaitCondition renderDocsCondition;
+        QList<Poppler::Document*> freeRenderDocs;
+        QSet<Poppler::Document*> busyRenderDocs;
+        QSet<Poppler::Document*> staleRenderDocs;
+        // how many render documents there may be, set from the GUI thread
+        int maxRenderDocs;
+        // a private copy of the document could not be loaded, don't try again
+        bool renderDocsFailed;
+
 
         // misc variables for document info and synopsis caching
         bool docSynopsisDirty;
@@ -192,6 +192,7 @@ void GSGenerator::slotImageGenerated(QImage *img, Okular::PixmapRequest *request
 
     if ( !request->page()->isBoundingBoxKnown() )
         updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( img ) );
+    request->applyColors( img );
 
     m_request = 0;
     QPixmap *pix = new QPixmap(QPixmap::fromImage(*img));
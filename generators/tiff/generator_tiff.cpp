@@ -10,6 +10,7 @@
 #include "generator_tiff.h"
 
 #include <qbuffer.h>
+#include <qcache.h>
 #include <qdatetime.h>
 #include <qfile.h>
 #include <qfileinfo.h>
@@ -23,16 +24,43 @@
 #include <kglobal.h>
 #include <KLocalizedString>
 
+#include <core/area.h>
 #include <core/document.h>
 #include <core/page.h>
 #include <core/fileprinter.h>
 #include <core/utils.h>
 
+#include "settings_core.h"
+
 #include <tiff.h>
 #include <tiffio.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define TiffDebug 4714
 
+/**
+ * Returns how much memory the decoded directories can use, in KiB,
+ * according to the memory level of the core.
+ */
+static int decodedDirectoriesCacheSize()
+{
+    switch ( Okular::SettingsCore::memoryLevel() )
+    {
+        case Okular::SettingsCore::EnumMemoryLevel::Low:
+            return 16 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Aggressive:
+            return 256 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Greedy:
+            return 1024 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Normal:
+        default:
+            return 64 * 1024;
+    }
+}
+
 tsize_t okular_tiffReadProc( thandle_t handle, tdata_t buf, tsize_t size )
 {
     QIODevice * device = static_cast< QIODevice * >( handle );
@@ -92,11 +120,156 @@ class TIFFGenerator::Private
         Private()
           : tiff( 0 ), dev( 0 ) {}
 
+        QImage readDirectory( int dir, const QSize &size, const QRect &rect, uint32 orientation );
+        QImage readRgbaImage( const QRect &rect, uint32 orientation );
+        QImage readBilevelImage( const QSize &size );
+
         TIFF* tiff;
         QByteArray data;
         QIODevice* dev;
+        // directory -> its decoded image, with the cost in KiB
+        QCache< int, QImage > decodedDirectories;
 };
 
+/**
+ * Swaps the red and blue channels of the @p count pixels at @p data, as
+ * TIFFRGBAImage gives ABGR pixels and QImage wants ARGB ones.
+ */
+static void abgrToArgb( uint32 *data, uint32 count )
+{
+    uint32 i = 0;
+#ifdef __SSE2__
+    const __m128i agMask = _mm_set1_epi32( (int)0xFF00FF00 );
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i *pixels = reinterpret_cast< __m128i * >( data + i );
+        const __m128i abgr = _mm_loadu_si128( pixels );
+        const __m128i ag = _mm_and_si128( abgr, agMask );
+        const __m128i br = _mm_andnot_si128( agMask, abgr );
+        const __m128i rb = _mm_or_si128( _mm_slli_epi32( br, 16 ), _mm_srli_epi32( br, 16 ) );
+        _mm_storeu_si128( pixels, _mm_or_si128( ag, rb ) );
+    }
+#endif
+    for ( ; i < count; ++i )
+    {
+        uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
+        uint32 blue = ( data[i] & 0x000000FF ) << 16;
+        data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
+    }
+}
+
+/**
+ * Whether the current directory is a black and white image stored in strips,
+ * like the G3/G4 fax images, that can be read without TIFFRGBAImage.
+ */
+static bool isBilevel( TIFF *tiff )
+{
+    uint16 bitsPerSample = 1;
+    uint16 samplesPerPixel = 1;
+    uint16 photometric = 0;
+    TIFFGetFieldDefaulted( tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample );
+    TIFFGetFieldDefaulted( tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel );
+    if ( !TIFFGetField( tiff, TIFFTAG_PHOTOMETRIC, &photometric ) )
+        return false;
+
+    return bitsPerSample == 1 && samplesPerPixel == 1 && !TIFFIsTiled( tiff )
+           && ( photometric == PHOTOMETRIC_MINISWHITE || photometric == PHOTOMETRIC_MINISBLACK );
+}
+
+/**
+ * Reads the @p rect area of the current directory, which is @p size large,
+ * keeping the whole decoded directory in the cache when it is read.
+ */
+QImage TIFFGenerator::Private::readDirectory( int dir, const QSize &size, const QRect &rect, uint32 orientation )
+{
+    const QRect fullRect( QPoint( 0, 0 ), size );
+    QImage image;
+    if ( isBilevel( tiff ) )
+    {
+        // a bilevel page takes 1 bit per pixel, so it is cheap to decode
+        // and to cache as a whole even when only a tile of it is needed
+        image = readBilevelImage( size );
+        if ( image.isNull() )
+            return image;
+    }
+    else
+    {
+        image = readRgbaImage( rect, orientation );
+        if ( image.isNull() || rect != fullRect )
+            return image;
+    }
+
+    // a directory larger than the whole cache is not kept, rather than
+    // evicting all the other ones for nothing
+    const int cost = qMax( 1, image.byteCount() / 1024 );
+    if ( cost <= decodedDirectories.maxCost() )
+        decodedDirectories.insert( dir, new QImage( image ), cost );
+    return rect == fullRect ? image : image.copy( rect );
+}
+
+QImage TIFFGenerator::Private::readRgbaImage( const QRect &rect, uint32 orientation )
+{
+    char emsg[1024];
+    if ( !TIFFRGBAImageOK( tiff, emsg ) )
+        return QImage();
+
+    TIFFRGBAImage img;
+    if ( !TIFFRGBAImageBegin( &img, tiff, 0, emsg ) )
+        return QImage();
+
+    // decode a band of strips (or tiles) at a time straight into the image,
+    // swapping the channels of each band while it is still in the CPU cache;
+    // the bands are aligned to the strips, so that no strip is decoded twice
+    uint32 stripRows = 0;
+    if ( TIFFIsTiled( tiff ) )
+        TIFFGetField( tiff, TIFFTAG_TILELENGTH, &stripRows );
+    else
+        TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &stripRows );
+    stripRows = qMax< uint32 >( 1, stripRows );
+    const uint32 bandRows = stripRows < 64 ? ( 64 + stripRows - 1 ) / stripRows * stripRows : stripRows;
+
+    QImage image( rect.size(), QImage::Format_RGB32 );
+    img.req_orientation = orientation;
+    img.col_offset = rect.x();
+    bool ok = true;
+    for ( int y = 0; ok && y < rect.height(); )
+    {
+        const uint32 row = rect.y() + y;
+        const int rows = qMin< uint32 >( bandRows - row % bandRows, rect.height() - y );
+        uint32 * data = (uint32 *)image.scanLine( y );
+        img.row_offset = row;
+        ok = TIFFRGBAImageGet( &img, data, rect.width(), rows ) != 0;
+        abgrToArgb( data, rect.width() * rows );
+        y += rows;
+    }
+    TIFFRGBAImageEnd( &img );
+
+    return ok ? image : QImage();
+}
+
+QImage TIFFGenerator::Private::readBilevelImage( const QSize &size )
+{
+    uint16 photometric = PHOTOMETRIC_MINISWHITE;
+    TIFFGetField( tiff, TIFFTAG_PHOTOMETRIC, &photometric );
+
+    // the scanlines of a bilevel image are already packed like the ones of
+    // a QImage::Format_Mono, most significant bit first
+    QImage image( size, QImage::Format_Mono );
+    if ( image.isNull() || TIFFScanlineSize( tiff ) > image.bytesPerLine() )
+        return QImage();
+
+    image.setColorCount( 2 );
+    image.setColor( 0, photometric == PHOTOMETRIC_MINISWHITE ? qRgb( 255, 255, 255 ) : qRgb( 0, 0, 0 ) );
+    image.setColor( 1, photometric == PHOTOMETRIC_MINISWHITE ? qRgb( 0, 0, 0 ) : qRgb( 255, 255, 255 ) );
+    for ( int row = 0; row < size.height(); ++row )
+    {
+        if ( TIFFReadScanline( tiff, image.scanLine( row ), row, 0 ) < 0 )
+            return QImage();
+    }
+
+    return image;
+}
+
 static QDateTime convertTIFFDateTime( const char* tiffdate )
 {
     if ( !tiffdate )
@@ -180,6 +353,7 @@ TIFFGenerator::TIFFGenerator( QObject *parent, const QVariantList &args )
       d( new Private )
 {
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( ReadRawData );
@@ -216,6 +390,9 @@ bool TIFFGenerator::loadDocumentFromData( const QByteArray & fileData, QVector<
 
 bool TIFFGenerator::loadTiff( QVector< Okular::Page * > & pagesVector, const char *name )
 {
+    // read the settings here, as the directories are decoded in a thread
+    d->decodedDirectories.setMaxCost( decodedDirectoriesCacheSize() );
+
     d->tiff = TIFFClientOpen( name, "r", d->dev,
                   okular_tiffReadProc, okular_tiffWriteProc, okular_tiffSeekProc,
                   okular_tiffCloseProc, okular_tiffSizeProc,
@@ -244,6 +421,8 @@ bool TIFFGenerator::doCloseDocument()
         d->dev = 0;
         d->data.clear();
         m_pageMapping.clear();
+        m_reducedImageMapping.clear();
+        d->decodedDirectories.clear();
     }
 
     return true;
@@ -254,46 +433,67 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
     bool generated = false;
     QImage img;
 
-    if ( TIFFSetDirectory( d->tiff, mapPage( request->page()->number() ) ) )
+    int rotation = request->page()->rotation();
+    int reqwidth = request->width();
+    int reqheight = request->height();
+    if ( rotation % 2 == 1 )
+        qSwap( reqwidth, reqheight );
+
+    // the decoded directory may be cached already, from a previous request
+    // for the page at another zoom level or for another tile of it
+    const int dir = mapPage( request->page()->number(), reqwidth, reqheight );
+    QImage * decoded = d->decodedDirectories.object( dir );
+    QSize size;
+    uint32 orientation = 0;
+    if ( decoded )
+    {
+        size = decoded->size();
+    }
+    else if ( TIFFSetDirectory( d->tiff, dir ) )
     {
-        int rotation = request->page()->rotation();
         uint32 width = 1;
         uint32 height = 1;
-        uint32 orientation = 0;
         TIFFGetField( d->tiff, TIFFTAG_IMAGEWIDTH, &width );
         TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height );
+        size = QSize( width, height );
 
         if ( !TIFFGetField( d->tiff, TIFFTAG_ORIENTATION, &orientation ) )
             orientation = ORIENTATION_TOPLEFT;
+    }
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
+    if ( size.isValid() )
+    {
+        // for a tile, read only the area of the image it covers
+        QRect rect( QPoint( 0, 0 ), size );
+        QSize targetSize( reqwidth, reqheight );
+        if ( request->isTile() )
+        {
+            rect = request->normalizedRect().geometry( size.width(), size.height() ) & rect;
+            targetSize = request->normalizedRect().geometry( request->width(), request->height() ).size();
+        }
 
-        // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, orientation ) != 0 )
+        if ( !rect.isEmpty() )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
+            QImage image;
+            if ( decoded )
+                image = rect.size() == size ? *decoded : decoded->copy( rect );
+            else
+                image = d->readDirectory( dir, size, rect, orientation );
+
+            if ( !image.isNull() )
             {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
+                img = image.scaled( targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+                generated = true;
             }
-
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if ( rotation % 2 == 1 )
-                qSwap( reqwidth, reqheight );
-            img = image.scaled( reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
-
-            generated = true;
         }
     }
 
     if ( !generated )
     {
-        img = QImage( request->width(), request->height(), QImage::Format_RGB32 );
+        const QSize size = request->isTile()
+            ? request->normalizedRect().geometry( request->width(), request->height() ).size()
+            : QSize( request->width(), request->height() );
+        img = QImage( size, QImage::Format_RGB32 );
         img.fill( qRgb( 255, 255, 255 ) );
     }
 
@@ -372,6 +572,15 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
              TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
             continue;
 
+        // a reduced resolution version of the previous page, not a page
+        uint32 subfileType = 0;
+        if ( realdirs > 0 && TIFFGetField( d->tiff, TIFFTAG_SUBFILETYPE, &subfileType ) == 1
+             && ( subfileType & FILETYPE_REDUCEDIMAGE ) )
+        {
+            m_reducedImageMapping[ realdirs - 1 ].append( qMakePair( (int)i, QSize( width, height ) ) );
+            continue;
+        }
+
         adaptSizeToResolution( d->tiff, TIFFTAG_XRESOLUTION, dpiX, &width );
         adaptSizeToResolution( d->tiff, TIFFTAG_YRESOLUTION, dpiY, &height );
 
@@ -413,13 +622,7 @@ bool TIFFGenerator::print( QPrinter& printer )
         if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, ORIENTATION_TOPLEFT ) != 0 )
         {
             // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
-            {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
-            }
+            abgrToArgb( data, width * height );
         }
 
         if ( i != 0 )
@@ -451,6 +654,28 @@ int TIFFGenerator::mapPage( int page ) const
     return it.value();
 }
 
+int TIFFGenerator::mapPage( int page, int width, int height ) const
+{
+    // the smallest version of the page at least as large as the requested
+    // size, so that decoding it and scaling it down is the cheapest
+    int dir = mapPage( page );
+    QSize dirSize;
+    const QList< QPair< int, QSize > > reducedImages = m_reducedImageMapping.value( page );
+    for ( int i = 0; i < reducedImages.count(); ++i )
+    {
+        const QSize size = reducedImages.at( i ).second;
+        if ( size.width() < width || size.height() < height )
+            continue;
+
+        if ( !dirSize.isValid() || size.width() < dirSize.width() )
+        {
+            dir = reducedImages.at( i ).first;
+            dirSize = size;
+        }
+    }
+    return dir;
+}
+
 Q_LOGGING_CATEGORY(OkularTiffDebug, "org.kde.okular.generators.tiff")
 
 #include "generator_tiff.moc"
@@ -14,6 +14,8 @@
 
 #include <QtCore/qloggingcategory.h>
 #include <qhash.h>
+#include <qpair.h>
+#include <qsize.h>
 
 class TIFFGenerator : public Okular::Generator
 {
@@ -41,8 +43,11 @@ class TIFFGenerator : public Okular::Generator
         bool loadTiff( QVector< Okular::Page * > & pagesVector, const char *name );
         void loadPages( QVector<Okular::Page*> & pagesVector );
         int mapPage( int page ) const;
+        int mapPage( int page, int width, int height ) const;
 
         QHash< int, int > m_pageMapping;
+        // page -> directories and sizes of its reduced resolution versions
+        QHash< int, QList< QPair< int, QSize > > > m_reducedImageMapping;
 };
 
 Q_DECLARE_LOGGING_CATEGORY(OkularTiffDebug)
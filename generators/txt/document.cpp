@@ -42,6 +42,17 @@ Document::~Document()
 }
 
 QString Document::toUnicode( const QByteArray &array )
+{
+    QTextCodec *codec = detectCodec( array );
+    if ( !codec )
+    {
+        return QString();
+    }
+
+    return codec->toUnicode( array );
+}
+
+QTextCodec *Document::detectCodec( const QByteArray &array )
 {
     QByteArray encoding;
     KEncodingProber prober(KEncodingProber::Universal);
@@ -63,12 +74,12 @@ QString Document::toUnicode( const QByteArray &array )
 
     if ( encoding.isEmpty() )
     {
-        return QString();
+        return 0;
     }
 
     qCDebug(OkularTxtDebug) << "Detected" << prober.encoding() << "encoding"
              << "based on" << charsFeeded << "chars";
-    return QTextCodec::codecForName( encoding )->toUnicode( array );
+    return QTextCodec::codecForName( encoding );
 }
 
 Q_LOGGING_CATEGORY(OkularTxtDebug, "org.kde.okular.generators.txt")
@@ -10,6 +10,8 @@
 
 #include <QtGui/QTextDocument>
 
+class QTextCodec;
+
 namespace Txt
 {
     class Document : public QTextDocument
@@ -18,6 +20,12 @@ namespace Txt
             Document( const QString &fileName );
             ~Document();
 
+            /**
+             * Returns the codec of the text in @p array, or 0 if its
+             * encoding can't be detected.
+             */
+            static QTextCodec *detectCodec( const QByteArray &array );
+
         private:
             QString toUnicode( const QByteArray &array );
     };
@@ -10,11 +10,27 @@
 
 #include "generator_txt.h"
 #include "converter.h"
+#include "largedocument.h"
+
+#include <core/page.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QPainter>
+#include <QPrinter>
+#include <QTimer>
 
 #include <KAboutData>
 #include <klocalizedstring.h>
 #include <KConfigDialog>
 
+// files from this size on are shown without laying them out as a QTextDocument
+static const qint64 LargeFileThreshold = 32 * 1024 * 1024;
+// milliseconds between the appends of the pages indexed in the background
+// at first; the interval doubles after each append, up to the maximum
+static const int IndexAppendInterval = 1000;
+static const int MaxIndexAppendInterval = 8000;
+
 static KAboutData createAboutData()
 {
     KAboutData aboutData(
@@ -32,8 +48,181 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN(TxtGenerator, createAboutData())
 
 TxtGenerator::TxtGenerator(QObject *parent, const QVariantList &args)
-    : Okular::TextDocumentGenerator(new Txt::Converter, "okular_txt_generator_settings" , parent, args)
+    : Okular::TextDocumentGenerator(new Txt::Converter, "okular_txt_generator_settings" , parent, args),
+      m_largeDocument( 0 ), m_pageCount( 0 )
+{
+    m_indexTimer = new QTimer( this );
+    m_indexTimer->setInterval( IndexAppendInterval );
+    connect( m_indexTimer, SIGNAL(timeout()), this, SLOT(appendIndexedPages()) );
+}
+
+TxtGenerator::~TxtGenerator()
+{
+    delete m_largeDocument;
+}
+
+Okular::Document::OpenResult TxtGenerator::loadDocumentWithPassword( const QString & fileName, QVector<Okular::Page*> & pagesVector, const QString &password )
+{
+    if ( QFileInfo( fileName ).size() >= LargeFileThreshold )
+    {
+        Txt::LargeDocument *largeDocument = new Txt::LargeDocument;
+        if ( largeDocument->open( fileName ) )
+        {
+            m_largeDocument = largeDocument;
+            m_pageCount = 0;
+            createPages( &pagesVector );
+            if ( !m_largeDocument->isIndexed() )
+            {
+                m_indexTimer->setInterval( IndexAppendInterval );
+                m_indexTimer->start();
+            }
+            return Okular::Document::OpenSuccess;
+        }
+        delete largeDocument;
+    }
+
+    return Okular::TextDocumentGenerator::loadDocumentWithPassword( fileName, pagesVector, password );
+}
+
+bool TxtGenerator::doCloseDocument()
+{
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::doCloseDocument();
+
+    m_indexTimer->stop();
+    delete m_largeDocument;
+    m_largeDocument = 0;
+    m_pageCount = 0;
+
+    return true;
+}
+
+void TxtGenerator::createPages( QVector<Okular::Page*> *pages )
+{
+    const int pageCount = m_largeDocument->pageCount();
+    for ( ; m_pageCount < pageCount; ++m_pageCount )
+        pages->append( new Okular::Page( m_pageCount, Txt::LargeDocument::PageWidth, Txt::LargeDocument::PageHeight, Okular::Rotation0 ) );
+}
+
+void TxtGenerator::appendIndexedPages()
+{
+    if ( !m_largeDocument )
+        return;
+
+    // checked first, so that no page indexed after the check is missed
+    const bool indexed = m_largeDocument->isIndexed();
+
+    QVector<Okular::Page*> pages;
+    createPages( &pages );
+    if ( !pages.isEmpty() )
+    {
+        appendPages( pages );
+        m_indexTimer->setInterval( qMin( m_indexTimer->interval() * 2, MaxIndexAppendInterval ) );
+    }
+
+    if ( indexed )
+        m_indexTimer->stop();
+}
+
+QImage TxtGenerator::image( Okular::PixmapRequest *request )
+{
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::image( request );
+
+    QImage image( request->width(), request->height(), QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+
+    QPainter p;
+    p.begin( &image );
+    p.scale( request->width() / (qreal)Txt::LargeDocument::PageWidth, request->height() / (qreal)Txt::LargeDocument::PageHeight );
+    m_largeDocument->paintPage( &p, request->pageNumber(), generalSettings()->font() );
+    p.end();
+
+    return image;
+}
+
+Okular::TextPage* TxtGenerator::textPage( Okular::Page *page )
+{
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::textPage( page );
+
+    return m_largeDocument->textPage( page->number(), generalSettings()->font() );
+}
+
+bool TxtGenerator::print( QPrinter& printer )
+{
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::print( printer );
+
+    // waiting for the index would block, so the pages indexed so far are
+    // printed; exportTo() makes sure they are all there
+    const int pageCount = m_largeDocument->pageCount();
+    const int firstPage = printer.fromPage() > 0 ? printer.fromPage() - 1 : 0;
+    const int lastPage = printer.toPage() > 0 ? qMin( printer.toPage(), pageCount ) - 1 : pageCount - 1;
+
+    QPainter p;
+    if ( !p.begin( &printer ) )
+        return false;
+
+    const QRect viewport = p.viewport();
+    const qreal scale = qMin( viewport.width() / (qreal)Txt::LargeDocument::PageWidth, viewport.height() / (qreal)Txt::LargeDocument::PageHeight );
+    for ( int page = firstPage; page <= lastPage; ++page )
+    {
+        if ( page > firstPage )
+            printer.newPage();
+
+        p.save();
+        p.scale( scale, scale );
+        m_largeDocument->paintPage( &p, page, generalSettings()->font() );
+        p.restore();
+    }
+
+    return p.end();
+}
+
+Okular::ExportFormat::List TxtGenerator::exportFormats() const
+{
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::exportFormats();
+
+    Okular::ExportFormat::List formats;
+    formats.append( Okular::ExportFormat::standardFormat( Okular::ExportFormat::PlainText ) );
+    formats.append( Okular::ExportFormat::standardFormat( Okular::ExportFormat::PDF ) );
+    return formats;
+}
+
+bool TxtGenerator::exportTo( const QString &fileName, const Okular::ExportFormat &format )
 {
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::exportTo( fileName, format );
+
+    if ( format.mimeType().name() == QLatin1String( "application/pdf" ) ) {
+        // the pages still being indexed would be missing
+        if ( !m_largeDocument->isIndexed() )
+            return false;
+
+        QPrinter printer( QPrinter::HighResolution );
+        printer.setOutputFormat( QPrinter::PdfFormat );
+        printer.setOutputFileName( fileName );
+        return print( printer );
+    } else if ( format.mimeType().name() == QLatin1String( "text/plain" ) ) {
+        QFile file( fileName );
+        if ( !file.open( QIODevice::WriteOnly ) )
+            return false;
+
+        return m_largeDocument->exportText( &file );
+    }
+    return false;
+}
+
+Okular::DocumentInfo TxtGenerator::generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const
+{
+    if ( !m_largeDocument )
+        return Okular::TextDocumentGenerator::generateDocumentInfo( keys );
+
+    Okular::DocumentInfo info;
+    info.set( Okular::DocumentInfo::MimeType, QStringLiteral( "text/plain" ) );
+    return info;
 }
 
 void TxtGenerator::addPages( KConfigDialog* dlg )
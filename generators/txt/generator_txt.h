@@ -14,6 +14,13 @@
 
 #include <core/textdocumentgenerator.h>
 
+class QTimer;
+
+namespace Txt
+{
+    class LargeDocument;
+}
+
 class TxtGenerator : public Okular::TextDocumentGenerator
 {
     Q_OBJECT
@@ -21,9 +28,34 @@ class TxtGenerator : public Okular::TextDocumentGenerator
 
 public:
     TxtGenerator(QObject *parent, const QVariantList &args);
-    ~TxtGenerator() {}
+    ~TxtGenerator();
+
+    Okular::Document::OpenResult loadDocumentWithPassword( const QString & fileName, QVector<Okular::Page*> & pagesVector, const QString &password ) Q_DECL_OVERRIDE;
+
+    bool print( QPrinter& printer ) Q_DECL_OVERRIDE;
+
+    Okular::ExportFormat::List exportFormats() const Q_DECL_OVERRIDE;
+    bool exportTo( const QString &fileName, const Okular::ExportFormat &format ) Q_DECL_OVERRIDE;
+
+    Okular::DocumentInfo generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const Q_DECL_OVERRIDE;
 
     void addPages( KConfigDialog* dlg ) Q_DECL_OVERRIDE;
+
+protected:
+    bool doCloseDocument() Q_DECL_OVERRIDE;
+    QImage image( Okular::PixmapRequest *request ) Q_DECL_OVERRIDE;
+    Okular::TextPage* textPage( Okular::Page *page ) Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void appendIndexedPages();
+
+private:
+    void createPages( QVector<Okular::Page*> *pages );
+
+    // the file shown instead of a QTextDocument, if it is too large for one
+    Txt::LargeDocument *m_largeDocument;
+    QTimer *m_indexTimer;
+    int m_pageCount;
 };
 
 #endif
@@ -0,0 +1,345 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "largedocument.h"
+
+#include <QtCore/QIODevice>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QTextCodec>
+#include <QtCore/QTextDecoder>
+#include <QtGui/QFont>
+#include <QtGui/QFontMetricsF>
+#include <QtGui/QPainter>
+
+#include <core/area.h>
+#include <core/textpage.h>
+
+#include <cstring>
+
+#include "document.h"
+#include "debug_txt.h"
+
+using namespace Txt;
+
+static const int LinesPerPage = 60;
+static const int Margin = 20;
+static const int TabWidth = 8;
+// the lines are wrapped at this many columns
+static const int WrapColumns = 80;
+// the encoding is detected from this many bytes at the start of the file
+static const int EncodingPrefixSize = 64 * 1024;
+// bytes of the file indexed at once, between checks for abort
+static const qint64 IndexChunkSize = 4 * 1024 * 1024;
+
+static double lineHeight()
+{
+    return ( LargeDocument::PageHeight - 2 * Margin ) / double( LinesPerPage );
+}
+
+/* Returns @p font sized to fit the fixed height of the lines. */
+static QFont pageFont( const QFont &font )
+{
+    QFont result( font );
+    result.setPixelSize( qRound( lineHeight() * 0.8 ) );
+    return result;
+}
+
+static QString expandTabs( const QString &line )
+{
+    if ( !line.contains( QLatin1Char( '\t' ) ) )
+        return line;
+
+    QString expanded;
+    expanded.reserve( line.length() + TabWidth );
+    for ( int i = 0; i < line.length(); ++i )
+    {
+        if ( line.at( i ) == QLatin1Char( '\t' ) )
+            expanded += QString( TabWidth - expanded.length() % TabWidth, QLatin1Char( ' ' ) );
+        else
+            expanded += line.at( i );
+    }
+    return expanded;
+}
+
+/* Returns the factor that fits @p line, painted with @p metrics, in the page. */
+static double lineScale( const QString &line, const QFontMetricsF &metrics )
+{
+    // wide characters may not fit in the columns of a line, they are
+    // squeezed then
+    const double width = metrics.width( line );
+    const double available = LargeDocument::PageWidth - 2 * Margin;
+    return width > available ? available / width : 1.0;
+}
+
+LargeDocument::LargeDocument()
+    : m_data( 0 ), m_size( 0 ), m_start( 0 ), m_codec( 0 ), m_utf8( false ), m_indexed( false ),
+      m_indexPosition( 0 ), m_indexLines( 0 ), m_indexColumn( 0 )
+{
+}
+
+LargeDocument::~LargeDocument()
+{
+    m_abort.store( 1 );
+    wait();
+}
+
+bool LargeDocument::open( const QString &fileName )
+{
+    m_file.setFileName( fileName );
+    if ( !m_file.open( QIODevice::ReadOnly ) )
+    {
+        qCDebug(OkularTxtDebug) << "Can't open file" << fileName;
+        return false;
+    }
+
+    // an empty file can't be mapped, there is nothing to map either
+    m_size = m_file.size();
+    m_data = m_size > 0 ? reinterpret_cast< const char * >( m_file.map( 0, m_size ) ) : "";
+    if ( !m_data )
+    {
+        qCDebug(OkularTxtDebug) << "Can't map file" << fileName;
+        return false;
+    }
+
+    const QByteArray prefix = QByteArray::fromRawData( m_data, qMin( m_size, qint64( EncodingPrefixSize ) ) );
+    m_codec = Document::detectCodec( prefix );
+    if ( !m_codec )
+        m_codec = QTextCodec::codecForLocale();
+
+    // lines are found by their '\n' bytes
+    const QByteArray codecName = m_codec->name();
+    if ( codecName.startsWith( "UTF-16" ) || codecName.startsWith( "UTF-32" ) || codecName.startsWith( "ISO-10646" ) )
+    {
+        qCDebug(OkularTxtDebug) << "Can't index" << codecName << "text";
+        return false;
+    }
+    m_utf8 = codecName == "UTF-8";
+
+    if ( m_size >= 3 && memcmp( m_data, "\xef\xbb\xbf", 3 ) == 0 )
+        m_start = 3;
+
+    m_pageOffsets.append( m_start );
+    m_indexPosition = m_start;
+    while ( !indexChunk() && pageCount() == 0 )
+        ;
+
+    if ( !isIndexed() )
+        start( QThread::LowPriority );
+
+    return true;
+}
+
+int LargeDocument::pageCount() const
+{
+    QMutexLocker locker( &m_mutex );
+    // the last page may still get more lines
+    return m_indexed ? m_pageOffsets.count() : m_pageOffsets.count() - 1;
+}
+
+bool LargeDocument::isIndexed() const
+{
+    QMutexLocker locker( &m_mutex );
+    return m_indexed;
+}
+
+void LargeDocument::run()
+{
+    while ( !m_abort.load() && !indexChunk() )
+        ;
+}
+
+bool LargeDocument::indexChunk()
+{
+    const qint64 end = qMin( m_size, m_indexPosition + IndexChunkSize );
+
+    QVector< qint64 > offsets;
+    const char *pos = m_data + m_indexPosition;
+    const char *chunkEnd = m_data + end;
+    while ( pos < chunkEnd )
+    {
+        const char *newline = static_cast< const char * >( memchr( pos, '\n', chunkEnd - pos ) );
+        const char *lineEnd = newline ? newline : chunkEnd;
+
+        // the line may go on in the next chunk, at the column reached
+        const char *wrap;
+        while ( ( wrap = wrapLine( pos, lineEnd, &m_indexColumn ) ) != lineEnd )
+        {
+            m_indexColumn = 0;
+            pos = wrap;
+            if ( ++m_indexLines == LinesPerPage )
+            {
+                m_indexLines = 0;
+                offsets.append( pos - m_data );
+            }
+        }
+        if ( !newline )
+            break;
+
+        m_indexColumn = 0;
+        pos = newline + 1;
+        if ( ++m_indexLines == LinesPerPage )
+        {
+            m_indexLines = 0;
+            // no empty page after the last line
+            if ( pos < m_data + m_size )
+                offsets.append( pos - m_data );
+        }
+    }
+    m_indexPosition = end;
+
+    QMutexLocker locker( &m_mutex );
+    m_pageOffsets += offsets;
+    m_indexed = end == m_size;
+    return m_indexed;
+}
+
+QStringList LargeDocument::pageLines( int page ) const
+{
+    qint64 begin, end;
+    {
+        QMutexLocker locker( &m_mutex );
+        if ( page < 0 || page >= m_pageOffsets.count() )
+            return QStringList();
+
+        begin = m_pageOffsets.at( page );
+        end = page + 1 < m_pageOffsets.count() ? m_pageOffsets.at( page + 1 ) : m_size;
+    }
+
+    QStringList lines;
+    const char *pos = m_data + begin;
+    const char *pageEnd = m_data + end;
+    while ( pos < pageEnd && lines.count() < LinesPerPage )
+    {
+        const char *newline = static_cast< const char * >( memchr( pos, '\n', pageEnd - pos ) );
+        const char *lineEnd = newline ? newline : pageEnd;
+
+        int column = 0;
+        const char *wrap = wrapLine( pos, lineEnd, &column );
+        int length = wrap - pos;
+        if ( length > 0 && pos[ length - 1 ] == '\r' )
+            --length;
+        lines.append( expandTabs( m_codec->toUnicode( pos, length ) ) );
+
+        if ( wrap != lineEnd )
+            pos = wrap;
+        else
+            pos = newline ? newline + 1 : pageEnd;
+    }
+    return lines;
+}
+
+/*
+ * Returns where the line ending at @p lineEnd is wrapped, if it goes on from
+ * @p pos at @p column, or @p lineEnd if the rest of it fits. Advances @p column
+ * past the characters before the returned position.
+ */
+const char *LargeDocument::wrapLine( const char *pos, const char *lineEnd, int *column ) const
+{
+    for ( ; pos < lineEnd; ++pos )
+    {
+        // the bytes following the first one of a character take no column
+        int width = 1;
+        if ( *pos == '\t' )
+            width = TabWidth - *column % TabWidth;
+        else if ( *pos == '\r' || ( m_utf8 && ( *pos & 0xc0 ) == 0x80 ) )
+            width = 0;
+
+        if ( width > 0 && *column > 0 && *column + width > WrapColumns )
+            return pos;
+        *column += width;
+    }
+    return lineEnd;
+}
+
+void LargeDocument::paintPage( QPainter *painter, int page, const QFont &font ) const
+{
+    const QFont linesFont = pageFont( font );
+    const QFontMetricsF metrics( linesFont );
+    const double baseline = ( lineHeight() - metrics.height() ) / 2 + metrics.ascent();
+
+    painter->save();
+    painter->setFont( linesFont );
+    painter->setPen( Qt::black );
+    painter->setClipRect( QRectF( Margin, Margin, PageWidth - 2 * Margin, PageHeight - 2 * Margin ), Qt::IntersectClip );
+
+    const QStringList lines = pageLines( page );
+    for ( int i = 0; i < lines.count(); ++i )
+    {
+        const double scale = lineScale( lines.at( i ), metrics );
+        painter->save();
+        painter->translate( Margin, Margin + i * lineHeight() + baseline );
+        painter->scale( scale, 1.0 );
+        painter->drawText( QPointF( 0, 0 ), lines.at( i ) );
+        painter->restore();
+    }
+
+    painter->restore();
+}
+
+Okular::TextPage *LargeDocument::textPage( int page, const QFont &font ) const
+{
+    Okular::TextPage *textPage = new Okular::TextPage;
+
+    const QFontMetricsF metrics( pageFont( font ) );
+    const QStringList lines = pageLines( page );
+    for ( int i = 0; i < lines.count(); ++i )
+    {
+        const QString &line = lines.at( i );
+        const double scale = lineScale( line, metrics );
+        const double top = ( Margin + i * lineHeight() ) / PageHeight;
+        const double bottom = top + lineHeight() / PageHeight;
+
+        // a word is appended once the next one is known, so that the last
+        // word of the line ends it
+        QString pendingText;
+        Okular::NormalizedRect *pendingArea = 0;
+        double x = Margin;
+        int measured = 0;
+        int pos = 0;
+        while ( pos < line.length() )
+        {
+            const int wordStart = pos;
+            while ( pos < line.length() && !line.at( pos ).isSpace() )
+                ++pos;
+            const int wordEnd = pos;
+            while ( pos < line.length() && line.at( pos ).isSpace() )
+                ++pos;
+            if ( wordStart == wordEnd )
+                continue;
+
+            const double x1 = x + scale * metrics.width( line.mid( measured, wordStart - measured ) );
+            const double x2 = x1 + scale * metrics.width( line.mid( wordStart, wordEnd - wordStart ) );
+            x = x2;
+            measured = wordEnd;
+
+            if ( pendingArea )
+                textPage->append( pendingText + QLatin1Char( ' ' ), pendingArea );
+            pendingText = line.mid( wordStart, wordEnd - wordStart );
+            pendingArea = new Okular::NormalizedRect( x1 / PageWidth, top, x2 / PageWidth, bottom );
+        }
+        if ( pendingArea )
+            textPage->append( pendingText + QLatin1Char( '\n' ), pendingArea );
+    }
+
+    return textPage;
+}
+
+bool LargeDocument::exportText( QIODevice *device ) const
+{
+    QScopedPointer< QTextDecoder > decoder( m_codec->makeDecoder() );
+    for ( qint64 pos = m_start; pos < m_size; pos += IndexChunkSize )
+    {
+        const int length = qMin( m_size - pos, IndexChunkSize );
+        if ( device->write( decoder->toUnicode( m_data + pos, length ).toUtf8() ) == -1 )
+            return false;
+    }
+    return true;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
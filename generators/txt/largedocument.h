@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef TXT_LARGEDOCUMENT_H
+#define TXT_LARGEDOCUMENT_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+class QFont;
+class QIODevice;
+class QPainter;
+class QTextCodec;
+
+namespace Okular
+{
+    class TextPage;
+}
+
+namespace Txt
+{
+    /**
+     * A plain text file too large to be laid out by a QTextDocument.
+     *
+     * The file is memory mapped and never decoded as a whole: its encoding is
+     * detected from its first bytes, and every page shows a fixed number of
+     * lines of it, whose offsets are indexed by the thread in the background.
+     * Lines longer than the width of the page are wrapped at a fixed number
+     * of columns.
+     */
+    class LargeDocument : public QThread
+    {
+        public:
+            static const int PageWidth = 600;
+            static const int PageHeight = 800;
+
+            LargeDocument();
+            ~LargeDocument();
+
+            /**
+             * Maps @p fileName and indexes the lines of its first page, and
+             * starts indexing the rest of it in the background. Fails if the
+             * file can't be mapped, or if its encoding is not a superset of
+             * ASCII.
+             */
+            bool open( const QString &fileName );
+
+            /**
+             * Returns the number of pages indexed so far.
+             */
+            int pageCount() const;
+
+            /**
+             * Returns whether all the pages of the file are indexed.
+             */
+            bool isIndexed() const;
+
+            /**
+             * Returns the lines of @p page, which must be indexed.
+             */
+            QStringList pageLines( int page ) const;
+
+            /**
+             * Paints @p page with @p font, in page coordinates.
+             */
+            void paintPage( QPainter *painter, int page, const QFont &font ) const;
+
+            /**
+             * Returns the text of @p page painted with @p font.
+             */
+            Okular::TextPage *textPage( int page, const QFont &font ) const;
+
+            /**
+             * Writes the whole text to @p device as UTF-8.
+             */
+            bool exportText( QIODevice *device ) const;
+
+        protected:
+            void run() Q_DECL_OVERRIDE;
+
+        private:
+            bool indexChunk();
+            const char *wrapLine( const char *pos, const char *lineEnd, int *column ) const;
+
+            QFile m_file;
+            const char *m_data;
+            qint64 m_size;
+            qint64 m_start;
+            QTextCodec *m_codec;
+            bool m_utf8;
+
+            // offsets of the first line of each page, guarded by m_mutex
+            // as the index thread appends to them
+            mutable QMutex m_mutex;
+            QVector< qint64 > m_pageOffsets;
+            bool m_indexed;
+
+            // touched by the indexing only
+            qint64 m_indexPosition;
+            int m_indexLines;
+            int m_indexColumn;
+            QAtomicInt m_abort;
+    };
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
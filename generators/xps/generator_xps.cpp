@@ -737,9 +737,38 @@ static QString unicodeString( const QString &raw )
 }
 
 
+/**
+    A QPicture with one point per drawing unit, like the images pages are
+    rendered to, so that the fonts and their metrics are the same as when
+    drawing the page directly
+*/
+class XpsPicture : public QPicture
+{
+protected:
+    int metric( PaintDeviceMetric metric ) const Q_DECL_OVERRIDE
+    {
+        switch ( metric ) {
+        case PdmDpiX:
+        case PdmDpiY:
+        case PdmPhysicalDpiX:
+        case PdmPhysicalDpiY:
+            return 72;
+        default:
+            return QPicture::metric( metric );
+        }
+    }
+};
+
+static bool isImageBrush( const QBrush &brush )
+{
+    return brush.style() == Qt::TexturePattern;
+}
+
 XpsHandler::XpsHandler(XpsPage *page): m_page(page)
 {
     m_painter = NULL;
+    m_displayList = NULL;
+    m_picture = NULL;
 }
 
 XpsHandler::~XpsHandler()
@@ -794,6 +823,81 @@ bool XpsHandler::endElement( const QString &nameSpace,
     return true;
 }
 
+void XpsHandler::saveState()
+{
+    m_states.push( painterState() );
+    m_painter->save();
+}
+
+void XpsHandler::restoreState()
+{
+    m_states.pop();
+    m_painter->restore();
+}
+
+XpsPainterState XpsHandler::painterState() const
+{
+    XpsPainterState state;
+    state.transform = m_painter->worldTransform();
+    state.opacity = m_painter->opacity();
+    state.clipped = m_painter->hasClipping();
+    if ( state.clipped ) {
+        state.clipPath = m_painter->clipPath();
+    }
+    state.pen = m_painter->pen();
+    state.brush = m_painter->brush();
+    state.font = m_painter->font();
+    state.layoutDirection = m_painter->layoutDirection();
+    return state;
+}
+
+void XpsHandler::setPainterState( const XpsPainterState &state )
+{
+    // the clip path is in the coordinates of the transform it was read with
+    m_painter->setWorldTransform( state.transform );
+    m_painter->setOpacity( state.opacity );
+    if ( state.clipped ) {
+        m_painter->setClipPath( state.clipPath );
+    } else {
+        m_painter->setClipping( false );
+    }
+    m_painter->setPen( state.pen );
+    m_painter->setBrush( state.brush );
+    m_painter->setFont( state.font );
+    m_painter->setLayoutDirection( state.layoutDirection );
+}
+
+void XpsHandler::drawImage( const QPainterPath &path, const QBrush &brush, const QPen &pen )
+{
+    const XpsPainterState currentState = painterState();
+
+    XpsImageDrawing drawing;
+    drawing.transform = currentState.transform;
+    drawing.opacity = currentState.opacity;
+    drawing.clipped = currentState.clipped;
+    drawing.clipPath = currentState.clipPath;
+    drawing.path = path;
+    drawing.brush = brush;
+    drawing.pen = pen;
+
+    // end the picture here, balancing its saved states...
+    for ( int i = 0; i < m_states.count(); ++i ) {
+        m_painter->restore();
+    }
+    m_painter->end();
+    m_displayList->pictures.append( *m_picture );
+    m_displayList->images.append( drawing );
+
+    // ...and go on in a new one, from the same painter state
+    *m_picture = XpsPicture();
+    m_painter->begin( m_picture );
+    for ( int i = 0; i < m_states.count(); ++i ) {
+        setPainterState( m_states.at( i ) );
+        m_painter->save();
+    }
+    setPainterState( currentState );
+}
+
 void XpsHandler::processGlyph( XpsRenderNode &node )
 {
     //TODO Currently ignored attributes: CaretStops, DeviceFontName, IsSideways, OpacityMask, Name, FixedPage.NavigateURI, xml:lang, x:key
@@ -803,7 +907,7 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
 
     QString att;
 
-    m_painter->save();
+    saveState();
 
     // Get font (doesn't work well because qt doesn't allow to load font from file)
     // This works despite the fact that font size isn't specified in points as required by qt. It's because I set point size to be equal to drawing unit.
@@ -811,7 +915,7 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     // qCWarning(OkularXpsDebug) << "Font Rendering EmSize:" << fontSize;
     // a value of 0.0 means the text is not visible (see XPS specs, chapter 12, "Glyphs")
     if ( fontSize < 0.1 ) {
-        m_painter->restore();
+        restoreState();
         return;
     }
     QFont font = m_page->m_file->getFontByName( node.attributes.value("FontUri"), fontSize );
@@ -841,14 +945,14 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         } else {
             // no "Fill" attribute and no "Glyphs.Fill" child, so show nothing
             // (see XPS specs, 5.10)
-            m_painter->restore();
+            restoreState();
             return;
         }
     } else {
         brush = parseRscRefColorForBrush( att );
         if ( brush.style() > Qt::NoBrush && brush.style() < Qt::LinearGradientPattern
              && brush.color().alpha() == 0 ) {
-            m_painter->restore();
+            restoreState();
             return;
         }
     }
@@ -863,7 +967,7 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         if ( ok && value >= 0.1 ) {
             m_painter->setOpacity( value );
         } else {
-            m_painter->restore();
+            restoreState();
             return;
         }
     }
@@ -925,9 +1029,16 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     QString stringToDraw( unicodeString( node.attributes.value( "UnicodeString" ) ) );
     QPointF originAdvance(0, 0);
     QFontMetrics metrics = m_painter->fontMetrics();
+    // glyphs filled with an image are drawn at once, as the outline of the text
+    const bool imageFill = isImageBrush( brush );
+    QPainterPath imagePath;
     for ( int i = 0; i < stringToDraw.size(); ++i ) {
         QChar thisChar = stringToDraw.at( i );
-        m_painter->drawText( origin + originAdvance, QString( thisChar ) );
+        if ( imageFill ) {
+            imagePath.addText( origin + originAdvance, m_painter->font(), QString( thisChar ) );
+        } else {
+            m_painter->drawText( origin + originAdvance, QString( thisChar ) );
+        }
 	const qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
         if ( advanceWidth > 0.0 ) {
             originAdvance.rx() += advanceWidth;
@@ -938,8 +1049,11 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
     // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
+    if ( imageFill ) {
+        drawImage( imagePath, brush, Qt::NoPen );
+    }
 
-    m_painter->restore();
+    restoreState();
 }
 
 void XpsHandler::processFill( XpsRenderNode &node )
@@ -1007,7 +1121,7 @@ void XpsHandler::processPath( XpsRenderNode &node )
     //TODO Ignored attributes: Clip, OpacityMask, StrokeEndLineCap, StorkeStartLineCap, Name, FixedPage.NavigateURI, xml:lang, x:key, AutomationProperties.Name, AutomationProperties.HelpText, SnapsToDevicePixels
     //TODO Ignored child elements: RenderTransform, Clip, OpacityMask
     // Handled separately: RenderTransform
-    m_painter->save();
+    saveState();
 
     QString att;
     QVariant data;
@@ -1023,7 +1137,7 @@ void XpsHandler::processPath( XpsRenderNode &node )
     }
     if ( !pathdata ) {
         // nothing to draw
-        m_painter->restore();
+        restoreState();
         return;
     }
 
@@ -1135,13 +1249,18 @@ void XpsHandler::processPath( XpsRenderNode &node )
     }
 
     Q_FOREACH ( XpsPathFigure *figure, pathdata->paths ) {
-        m_painter->setBrush( figure->isFilled ? brush : QBrush() );
-        m_painter->drawPath( figure->path );
+        const QBrush figureBrush = figure->isFilled ? brush : QBrush();
+        if ( isImageBrush( figureBrush ) || isImageBrush( pen.brush() ) ) {
+            drawImage( figure->path, figureBrush, pen );
+        } else {
+            m_painter->setBrush( figureBrush );
+            m_painter->drawPath( figure->path );
+        }
     }
 
     delete pathdata;
 
-    m_painter->restore();
+    restoreState();
 }
 
 void XpsHandler::processPathData( XpsRenderNode &node )
@@ -1282,7 +1401,7 @@ void XpsHandler::processPathFigure( XpsRenderNode &node )
 void XpsHandler::processStartElement( XpsRenderNode &node )
 {
     if (node.name == "Canvas") {
-        m_painter->save();
+        saveState();
         QString att = node.attributes.value( "RenderTransform" );
         if ( !att.isEmpty() ) {
             m_painter->setWorldTransform( parseRscRefMatrix( att ), true );
@@ -1316,7 +1435,7 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
             m_painter->setWorldTransform( data.value<QTransform>(), true );
         }
     } else if (node.name == "Canvas") {
-        m_painter->restore();
+        restoreState();
     } else if ((node.name == "Path.Fill") || (node.name == "Glyphs.Fill")) {
         processFill( node );
     } else if (node.name == "Path.Stroke") {
@@ -1394,10 +1513,8 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
 }
 
 XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
-    m_fileName( fileName ), m_pageIsRendered(false)
+    m_fileName( fileName )
 {
-    m_pageImage = NULL;
-
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
 
     const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( fileName ));
@@ -1423,49 +1540,85 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
+    m_file->displayListCache().remove( this );
 }
 
 bool XpsPage::renderToImage( QImage *p )
 {
+    // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
+    p->setDotsPerMeterX( 2835 );
+    p->setDotsPerMeterY( 2835 );
+    p->fill( qRgba( 255, 255, 255, 255 ) );
 
-    if ((m_pageImage == NULL) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage( p->size(), QImage::Format_ARGB32 );
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX( 2835 );
-        m_pageImage->setDotsPerMeterY( 2835 );
+    QPainter painter( p );
+    return renderToPainter( &painter );
+}
 
-        m_pageIsRendered = false;
-    }
-    if (! m_pageIsRendered) {
-        m_pageImage->fill( qRgba( 255, 255, 255, 255 ) );
-        QPainter painter( m_pageImage );
-        renderToPainter( &painter );
-        m_pageIsRendered = true;
-    }
+bool XpsPage::renderToPainter( QPainter *painter )
+{
+    const XpsDisplayList list = displayList();
 
-    *p = *m_pageImage;
+    painter->save();
+    painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    for ( int i = 0; i < list.images.count(); ++i ) {
+        painter->drawPicture( 0, 0, list.pictures.at( i ) );
+
+        const XpsImageDrawing &drawing = list.images.at( i );
+        painter->save();
+        painter->setWorldTransform( drawing.transform, true );
+        painter->setOpacity( drawing.opacity );
+        if ( drawing.clipped ) {
+            painter->setClipPath( drawing.clipPath );
+        }
+        painter->setBrush( drawing.brush );
+        painter->setPen( drawing.pen );
+        painter->drawPath( drawing.path );
+        painter->restore();
+    }
+    painter->drawPicture( 0, 0, list.pictures.last() );
+    painter->restore();
 
     return true;
 }
 
-bool XpsPage::renderToPainter( QPainter *painter )
+XpsDisplayList XpsPage::displayList()
 {
-    XpsHandler handler( this );
-    handler.m_painter = painter;
-    handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
-    QXmlSimpleReader parser;
-    parser.setContentHandler( &handler );
-    parser.setErrorHandler( &handler );
-    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
-    QByteArray data = readFileOrDirectoryParts( pageFile );
-    QBuffer buffer( &data );
-    QXmlInputSource source( &buffer );
-    bool ok = parser.parse( source );
-    qCWarning(OkularXpsDebug) << "Parse result: " << ok;
+    QCache< const XpsPage *, XpsDisplayList > &cache = m_file->displayListCache();
+    if ( const XpsDisplayList *list = cache.object( this ) ) {
+        return *list;
+    }
 
-    return true;
+    // parse the page only once, recording what it draws
+    XpsDisplayList list;
+    XpsPicture picture;
+    {
+        QPainter painter( &picture );
+        XpsHandler handler( this );
+        handler.m_painter = &painter;
+        handler.m_displayList = &list;
+        handler.m_picture = &picture;
+        QXmlSimpleReader parser;
+        parser.setContentHandler( &handler );
+        parser.setErrorHandler( &handler );
+        const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
+        QByteArray data = readFileOrDirectoryParts( pageFile );
+        QBuffer buffer( &data );
+        QXmlInputSource source( &buffer );
+        bool ok = parser.parse( source );
+        qCWarning(OkularXpsDebug) << "Parse result: " << ok;
+    }
+
+    list.pictures.append( picture );
+
+    qint64 memory = 0;
+    foreach ( const QPicture &p, list.pictures ) {
+        memory += p.size();
+    }
+    foreach ( const XpsImageDrawing &drawing, list.images ) {
+        memory += drawing.brush.textureImage().byteCount() + drawing.pen.brush().textureImage().byteCount();
+    }
+    cache.insert( this, new XpsDisplayList( list ), qMax( 1, (int)( memory / 1024 ) ) );
+    return list;
 }
 
 QSizeF XpsPage::size() const
@@ -1886,6 +2039,7 @@ XpsPage* XpsDocument::page(int pageNum) const
 }
 
 XpsFile::XpsFile()
+    : m_displayListCache( 64 * 1024 ) // 64 MiB
 {
 }
 
@@ -2045,6 +2199,8 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
 
 bool XpsFile::closeDocument()
 {
+    m_displayListCache.clear();
+
     qDeleteAll( m_documents );
     m_documents.clear();
 
@@ -2068,6 +2224,11 @@ XpsDocument* XpsFile::document(int documentNum) const
     return m_documents.at( documentNum );
 }
 
+QCache< const XpsPage *, XpsDisplayList > &XpsFile::displayListCache()
+{
+    return m_displayListCache;
+}
+
 XpsPage* XpsFile::page(int pageNum) const
 {
     return m_pages.at( pageNum );
@@ -2206,6 +2367,8 @@ bool XpsGenerator::print( QPrinter &printer )
 
     QPainter painter( &printer );
 
+    // the pages share their display list cache with the rendering thread
+    QMutexLocker lock( userMutex() );
     for ( int i = 0; i < pageList.count(); ++i )
     {
         if ( i != 0 )
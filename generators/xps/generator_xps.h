@@ -23,10 +23,14 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QCache>
 #include <QColor>
 #include <QDomDocument>
 #include <QFontDatabase>
 #include <QImage>
+#include <QPainterPath>
+#include <QPen>
+#include <QPicture>
 #include <QXmlStreamReader>
 #include <QXmlDefaultHandler>
 #include <QStack>
@@ -104,8 +108,60 @@ struct XpsPathGeometry
     XpsMatrixTransform transform;
 };
 
+/**
+    The state of the painter of a page, saved to paint the next picture of its
+    display list from where the previous one ended
+*/
+struct XpsPainterState
+{
+    XpsPainterState()
+        : opacity( 1.0 ), clipped( false ), layoutDirection( Qt::LeftToRight )
+    {}
+
+    QTransform transform;
+    qreal opacity;
+    bool clipped;
+    QPainterPath clipPath;
+    QPen pen;
+    QBrush brush;
+    QFont font;
+    Qt::LayoutDirection layoutDirection;
+};
+
+/**
+    A path filled or stroked with an image brush, drawn out of the pictures of
+    a display list, which would store its image encoded as PNG
+*/
+struct XpsImageDrawing
+{
+    XpsImageDrawing()
+        : opacity( 1.0 ), clipped( false )
+    {}
+
+    QTransform transform;
+    qreal opacity;
+    bool clipped;
+    QPainterPath clipPath;
+    QPainterPath path;
+    QBrush brush;
+    QPen pen;
+};
+
+/**
+    The drawing of a page: the pictures of its vector drawing, between which
+    its image drawings are made, keeping their images decoded
+*/
+struct XpsDisplayList
+{
+    // there is always one picture more than image drawings: images[i]
+    // is drawn after pictures[i]
+    QList< QPicture > pictures;
+    QList< XpsImageDrawing > images;
+};
+
 class XpsPage;
 class XpsFile;
+class XpsPicture;
 
 class XpsHandler: public QXmlDefaultHandler
 {
@@ -138,8 +194,20 @@ protected:
     void processPathGeometry( XpsRenderNode &node );
     void processPathFigure( XpsRenderNode &node );
 
+    void saveState();
+    void restoreState();
+    XpsPainterState painterState() const;
+    void setPainterState( const XpsPainterState &state );
+    void drawImage( const QPainterPath &path, const QBrush &brush, const QPen &pen );
+
     QPainter *m_painter;
 
+    // the display list being recorded, and its picture being painted
+    XpsDisplayList *m_displayList;
+    XpsPicture *m_picture;
+    // the painter states saved by saveState()
+    QStack< XpsPainterState > m_states;
+
     QImage m_image;
 
     QStack<XpsRenderNode> m_nodes;
@@ -161,6 +229,11 @@ public:
     QImage loadImageFromFile( const QString &filename );
 
 private:
+    /**
+       the page drawing recorded once in page units, replayed at any scale
+    */
+    XpsDisplayList displayList();
+
     XpsFile *m_file;
     const QString m_fileName;
 
@@ -172,9 +245,6 @@ private:
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
-
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
 };
@@ -275,6 +345,12 @@ public:
 
     KZip* xpsArchive();
 
+    /**
+       the display lists of the recently rendered pages, bounded by the
+       memory they use (in KiB)
+    */
+    QCache< const XpsPage *, XpsDisplayList > &displayListCache();
+
 
 private:
     int loadFontByName( const QString &fontName );
@@ -295,6 +371,8 @@ private:
 
     QMap<QString, int> m_fontCache;
     QFontDatabase m_fontDatabase;
+
+    QCache< const XpsPage *, XpsDisplayList > m_displayListCache;
 };
 
 
@@ -312,12 +312,14 @@ void PageItem::paint(QPainter *painter)
 
     if (m_intentionalDraw) {
         QLinkedList<Okular::PixmapRequest *> requestedPixmaps;
-        requestedPixmaps.push_back(new Okular::PixmapRequest(observer, m_viewPort.pageNumber, width(), height(), priority, Okular::PixmapRequest::Asynchronous));
+        Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Asynchronous;
+        requestFeatures |= Okular::PixmapRequest::Accessibility;
+        requestedPixmaps.push_back(new Okular::PixmapRequest(observer, m_viewPort.pageNumber, width(), height(), priority, requestFeatures));
         const Okular::Document::PixmapRequestFlag prf = m_isThumbnail ? Okular::Document::NoOption : Okular::Document::RemoveAllPrevious;
         m_documentItem.data()->document()->requestPixmaps(requestedPixmaps, prf);
         m_intentionalDraw = false;
     }
-    const int flags = PagePainter::Accessibility | PagePainter::Highlights | PagePainter::Annotations;
+    const int flags = PagePainter::Highlights | PagePainter::Annotations;
     PagePainter::paintPageOnPainter(painter, m_page, observer, flags, width(), height(), QRect(QPoint(0,0), contentsSize()));
 
     if (setAA) {
@@ -108,7 +108,16 @@ AnnotationModelPrivate::~AnnotationModelPrivate()
 void AnnotationModelPrivate::notifySetup( const QVector< Okular::Page * > &pages, int setupFlags )
 {
     if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    {
+        // the annotations of appended pages, some restored from the docdata file
+        if ( setupFlags & Okular::DocumentObserver::PagesAdded )
+        {
+            for ( int i = 0; i < pages.count(); ++i )
+                if ( !pages.at( i )->annotations().isEmpty() && !findItem( i ) )
+                    notifyPageChanged( i, Okular::DocumentObserver::Annotations );
+        }
         return;
+    }
 
     qDeleteAll( root->children );
     root->children.clear();
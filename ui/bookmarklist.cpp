@@ -170,7 +170,12 @@ void BookmarkList::notifySetup( const QVector< Okular::Page * > & pages, int set
 {
     Q_UNUSED( pages );
     if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    {
+        // bookmarks may point to the pages appended
+        if ( setupFlags & Okular::DocumentObserver::PagesAdded )
+            rebuildTree( m_showBoomarkOnlyAction->isChecked() );
         return;
+    }
 
     // clear contents
     m_searchLine->clear();
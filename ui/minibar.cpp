@@ -73,7 +73,7 @@ int MiniBarLogic::currentPage() const
 void MiniBarLogic::notifySetup( const QVector< Okular::Page * > & pageVector, int setupFlags )
 {
     // only process data when document changes
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    if ( !( setupFlags & ( Okular::DocumentObserver::DocumentChanged | Okular::DocumentObserver::PagesAdded ) ) )
         return;
 
     // if document is closed or has no pages, hide widget
@@ -90,7 +90,7 @@
 #include "url_utils.h"
 #include "magnifierview.h"
 
-static const int pageflags = PagePainter::Accessibility | PagePainter::EnhanceLinks |
+static const int pageflags = PagePainter::EnhanceLinks |
                        PagePainter::EnhanceImages | PagePainter::Highlights |
                        PagePainter::TextSelection | PagePainter::Annotations;
 
@@ -923,21 +923,37 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
             return;
     }
 
-    // delete all widgets (one for each page in pageSet)
-    QVector< PageViewItem * >::const_iterator dIt = d->items.constBegin(), dEnd = d->items.constEnd();
-    for ( ; dIt != dEnd; ++dIt )
-        delete *dIt;
-    d->items.clear();
-    d->visibleItems.clear();
-    d->pagesWithTextSelection.clear();
-    toggleFormWidgets( false );
-    if ( d->formsWidgetController )
-        d->formsWidgetController->dropRadioButtons();
+    // when pages were only appended, keep the widgets of the previous ones
+    bool pagesAdded = ( setupFlags & Okular::DocumentObserver::PagesAdded ) && !documentChanged
+                      && !( setupFlags & Okular::DocumentObserver::NewLayoutForPages ) && pageSet.count() > d->items.count();
+    for ( int i = 0; pagesAdded && i < d->items.count(); i++ )
+        if ( pageSet[i] != d->items[i]->page() )
+            pagesAdded = false;
 
-    bool haspages = !pageSet.isEmpty();
     bool hasformwidgets = false;
+    if ( pagesAdded )
+    {
+        QVector< PageViewItem * >::const_iterator iIt = d->items.constBegin(), iEnd = d->items.constEnd();
+        for ( ; iIt != iEnd && !hasformwidgets; ++iIt )
+            hasformwidgets = !(*iIt)->formWidgets().isEmpty();
+    }
+    else
+    {
+        // delete all widgets (one for each page in pageSet)
+        QVector< PageViewItem * >::const_iterator dIt = d->items.constBegin(), dEnd = d->items.constEnd();
+        for ( ; dIt != dEnd; ++dIt )
+            delete *dIt;
+        d->items.clear();
+        d->visibleItems.clear();
+        d->pagesWithTextSelection.clear();
+        toggleFormWidgets( false );
+        if ( d->formsWidgetController )
+            d->formsWidgetController->dropRadioButtons();
+    }
+
+    bool haspages = !pageSet.isEmpty();
     // create children widgets
-    QVector< Okular::Page * >::const_iterator setIt = pageSet.constBegin(), setEnd = pageSet.constEnd();
+    QVector< Okular::Page * >::const_iterator setIt = pageSet.constBegin() + d->items.count(), setEnd = pageSet.constEnd();
     for ( ; setIt != setEnd; ++setIt )
     {
         PageViewItem * item = new PageViewItem( *setIt );
@@ -1019,6 +1035,9 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
 
     updateActionState( haspages, documentChanged, hasformwidgets );
 
+    if ( pagesAdded )
+        return;
+
     // We need to assign it to a different list otherwise slotAnnotationWindowDestroyed
     // will bite us and clear d->m_annowindows
     QHash< Okular::Annotation *, AnnotWindow * > annowindows = d->m_annowindows;
@@ -4352,6 +4371,7 @@ static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const
     {
         Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Preload;
         requestFeatures |= Okular::PixmapRequest::Asynchronous;
+        requestFeatures |= Okular::PixmapRequest::Accessibility;
         const bool pageHasTilesManager = i->page()->hasTilesManager( observer );
         if ( pageHasTilesManager && !preRenderRegion.isNull() )
         {
@@ -4459,7 +4479,9 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
 #ifdef PAGEVIEW_DEBUG
             kWarning() << "rerequesting visible pixmaps for page" << i->pageNumber() << "!";
 #endif
-            Okular::PixmapRequest * p = new Okular::PixmapRequest( this, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous );
+            Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Asynchronous;
+            requestFeatures |= Okular::PixmapRequest::Accessibility;
+            Okular::PixmapRequest * p = new Okular::PixmapRequest( this, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), PAGEVIEW_PRIO, requestFeatures );
             requestedPixmaps.push_back( p );
 
             if ( i->page()->hasTilesManager( this ) )
@@ -305,19 +305,24 @@ void PresentationWidget::notifySetup( const QVector< Okular::Page * > & pageSet,
 {
     // same document, nothing to change - here we assume the document sets up
     // us with the whole document set as first notifySetup()
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    const bool pagesAdded = !( setupFlags & Okular::DocumentObserver::DocumentChanged )
+                            && ( setupFlags & Okular::DocumentObserver::PagesAdded ) && pageSet.count() > m_frames.count();
+    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) && !pagesAdded )
         return;
 
-    // delete previous frames (if any (shouldn't be))
-    QVector< PresentationFrame * >::iterator fIt = m_frames.begin(), fEnd = m_frames.end();
-    for ( ; fIt != fEnd; ++fIt )
-        delete *fIt;
-    if ( !m_frames.isEmpty() )
-        qCWarning(OkularUiDebug) << "Frames setup changed while a Presentation is in progress.";
-    m_frames.clear();
+    if ( !pagesAdded )
+    {
+        // delete previous frames (if any (shouldn't be))
+        QVector< PresentationFrame * >::iterator fIt = m_frames.begin(), fEnd = m_frames.end();
+        for ( ; fIt != fEnd; ++fIt )
+            delete *fIt;
+        if ( !m_frames.isEmpty() )
+            qCWarning(OkularUiDebug) << "Frames setup changed while a Presentation is in progress.";
+        m_frames.clear();
+    }
 
-    // create the new frames
-    QVector< Okular::Page * >::const_iterator setIt = pageSet.begin(), setEnd = pageSet.end();
+    // create the new frames, after the ones of the pages already there
+    QVector< Okular::Page * >::const_iterator setIt = pageSet.begin() + m_frames.count(), setEnd = pageSet.end();
     float screenRatio = (float)m_height / (float)m_width;
     for ( ; setIt != setEnd; ++setIt )
     {
@@ -1056,7 +1061,7 @@ void PresentationWidget::generateContentsPage( int pageNum, QPainter & p )
     geom.translate( -geom.left(), -geom.top() );
 
     // draw the page using the shared PagePainter class
-    int flags = PagePainter::Accessibility | PagePainter::Highlights | PagePainter::Annotations;
+    int flags = PagePainter::Highlights | PagePainter::Annotations;
     PagePainter::paintPageOnPainter( &p, frame->page, this, flags,
                                      geom.width(), geom.height(), geom );
 
@@ -1280,7 +1285,7 @@ void PresentationWidget::requestPixmaps()
     QApplication::setOverrideCursor( QCursor( Qt::BusyCursor ) );
     // request the pixmap
     QLinkedList< Okular::PixmapRequest * > requests;
-    requests.push_back( new Okular::PixmapRequest( this, m_frameIndex, pixW, pixH, PRESENTATION_PRIO, Okular::PixmapRequest::NoFeature ) );
+    requests.push_back( new Okular::PixmapRequest( this, m_frameIndex, pixW, pixH, PRESENTATION_PRIO, Okular::PixmapRequest::Accessibility ) );
     // restore cursor
     QApplication::restoreOverrideCursor();
     // ask for next and previous page if not in low memory usage setting
@@ -1294,6 +1299,7 @@ void PresentationWidget::requestPixmaps()
 
         Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Preload;
         requestFeatures |= Okular::PixmapRequest::Asynchronous;
+        requestFeatures |= Okular::PixmapRequest::Accessibility;
 
         for( int j = 1; j <= pagesToPreload; j++ )
         {
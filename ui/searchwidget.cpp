@@ -52,6 +52,8 @@ SearchWidget::SearchWidget( QWidget * parent, Okular::Document * document )
     m_matchPhraseAction = m_menu->addAction( i18n("Match Phrase") );
     m_marchAllWordsAction = m_menu->addAction( i18n("Match All Words") );
     m_marchAnyWordsAction = m_menu->addAction( i18n("Match Any Word") );
+    m_matchWholeWordsAction = m_menu->addAction( i18n("Match Whole Words") );
+    m_matchRegExpAction = m_menu->addAction( i18n("Match Regular Expression") );
 
     m_caseSensitiveAction->setCheckable( true );
     QActionGroup *actgrp = new QActionGroup( this );
@@ -61,6 +63,10 @@ SearchWidget::SearchWidget( QWidget * parent, Okular::Document * document )
     m_marchAllWordsAction->setActionGroup( actgrp );
     m_marchAnyWordsAction->setCheckable( true );
     m_marchAnyWordsAction->setActionGroup( actgrp );
+    m_matchWholeWordsAction->setCheckable( true );
+    m_matchWholeWordsAction->setActionGroup( actgrp );
+    m_matchRegExpAction->setCheckable( true );
+    m_matchRegExpAction->setActionGroup( actgrp );
 
     m_marchAllWordsAction->setChecked( true );
     connect(m_menu, &QMenu::triggered, this, &SearchWidget::slotMenuChaged);
@@ -99,6 +105,14 @@ void SearchWidget::slotMenuChaged( QAction * act )
     {
         m_lineEdit->setSearchType( Okular::Document::GoogleAny );
     }
+    else if ( act == m_matchWholeWordsAction )
+    {
+        m_lineEdit->setSearchType( Okular::Document::WholeWords );
+    }
+    else if ( act == m_matchRegExpAction )
+    {
+        m_lineEdit->setSearchType( Okular::Document::RegularExpression );
+    }
     else
         return;
 
@@ -39,6 +39,7 @@ class SearchWidget : public QWidget
     private:
         QMenu * m_menu;
         QAction *m_matchPhraseAction, *m_caseSensitiveAction, * m_marchAllWordsAction, *m_marchAnyWordsAction;
+        QAction *m_matchWholeWordsAction, *m_matchRegExpAction;
         SearchLineEdit *m_lineEdit;
 
     private slots:
@@ -228,6 +228,30 @@ ThumbnailList::~ThumbnailList()
 //BEGIN DocumentObserver inherited methods
 void ThumbnailList::notifySetup( const QVector< Okular::Page * > & pages, int setupFlags )
 {
+    // thumbnails of appended pages go after the ones already there, when
+    // all the pages are shown
+    if ( ( setupFlags & Okular::DocumentObserver::PagesAdded ) && !( setupFlags & Okular::DocumentObserver::DocumentChanged )
+         && !d->m_thumbnails.isEmpty() && d->m_thumbnails.last()->pageNumber() == d->m_thumbnails.count() - 1
+         && pages.count() > d->m_thumbnails.count() )
+    {
+        const int width = viewport()->width();
+        int height = widget()->height();
+        for ( int i = d->m_thumbnails.count(); i < pages.count(); ++i )
+        {
+            height += KDialog::spacingHint();
+            ThumbnailWidget * t = new ThumbnailWidget( d, pages.at( i ) );
+            t->move( 0, height );
+            d->m_thumbnails.push_back( t );
+            t->resizeFitWidth( width );
+            height += t->height();
+        }
+
+        widget()->resize( width, height );
+        verticalScrollBar()->setEnabled( viewport()->height() < height );
+        d->delayedRequestVisiblePixmaps( 200 );
+        return;
+    }
+
     // if there was a widget selected, save its pagenumber to restore
     // its selection (if available in the new set of pages)
     int prevPage = -1;
@@ -623,7 +647,9 @@ void ThumbnailListPrivate::slotRequestVisiblePixmaps( int /*newContentsY*/ )
         // if pixmap not present add it to requests
         if ( !t->page()->hasPixmap( q, t->pixmapWidth(), t->pixmapHeight() ) )
         {
-            Okular::PixmapRequest * p = new Okular::PixmapRequest( q, t->pageNumber(), t->pixmapWidth(), t->pixmapHeight(), THUMBNAILS_PRIO, Okular::PixmapRequest::Asynchronous );
+            Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Asynchronous;
+            requestFeatures |= Okular::PixmapRequest::Accessibility;
+            Okular::PixmapRequest * p = new Okular::PixmapRequest( q, t->pageNumber(), t->pixmapWidth(), t->pixmapHeight(), THUMBNAILS_PRIO, requestFeatures );
             requestedPixmaps.push_back( p );
         }
     }
@@ -942,7 +968,7 @@ void ThumbnailWidget::paint( QPainter &p, const QRect &_clipRect )
         clipRect = clipRect.intersect( QRect( 0, 0, m_pixmapWidth, m_pixmapHeight ) );
         if ( clipRect.isValid() )
         {
-            int flags = PagePainter::Accessibility | PagePainter::Highlights |
+            int flags = PagePainter::Highlights |
                         PagePainter::Annotations;
             PagePainter::paintPageOnPainter( &p, m_page, m_parent->q, flags, m_pixmapWidth, m_pixmapHeight, clipRect );
         }
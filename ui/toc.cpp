@@ -59,7 +59,7 @@ TOC::~TOC()
 
 void TOC::notifySetup( const QVector< Okular::Page * > & /*pages*/, int setupFlags )
 {
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    if ( !( setupFlags & ( Okular::DocumentObserver::DocumentChanged | Okular::DocumentObserver::PagesAdded ) ) )
         return;
 
     // clear contents